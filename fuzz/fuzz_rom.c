@@ -0,0 +1,63 @@
+// libFuzzer harness that runs every input as a ROM inside a single long-lived instance
+//
+// build with: make fuzz
+// run with:   out/fuzz_rom -max_len=3583 roms/
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "chirp.h"
+
+#ifndef CHIRP_COVERAGE
+#error "the fuzz harness needs the core built with -DCHIRP_COVERAGE"
+#endif
+
+#define FUZZ_MAX_FRAMES 2400 // 40 seconds of emulated time at the default cpu speed
+
+#ifdef __linux__
+// libFuzzer treats every byte in this section as an extra 8-bit coverage counter
+__attribute__((section("__libfuzzer_extra_counters")))
+#endif
+static uint8_t pc_counters[CHIRP_MEMORY_SIZE];
+
+static ChirpConfig config = {
+  .rom_path = "<fuzz>",
+  .cpu_speed = 500,
+  .xo_chip = true, // reach the XO-CHIP instructions too
+};
+
+static Chirp* chirp = NULL;
+
+int LLVMFuzzerTestOneInput(const uint8_t* data, const size_t size)
+{
+  // the instance is allocated once, every other input only swaps the boot image and resets; an input the core turns
+  // down would otherwise run whatever ROM came before it
+  if (chirp == NULL)
+  {
+    chirp = chirp_new_from_rom(&config, data, size);
+    if (chirp == NULL)
+    {
+      return 0;
+    }
+  }
+  else if (!chirp_load_rom_image(chirp, data, size))
+  {
+    return 0;
+  }
+
+  for (int i = 0; i < FUZZ_MAX_FRAMES; i++)
+  {
+    if (chirp_run_frame(chirp) != CHIRP_FAULT_NONE)
+    {
+      break;
+    }
+  }
+
+  // export the PC coverage bitmap of this run to libFuzzer
+  for (int addr = 0; addr < CHIRP_MEMORY_SIZE; addr++)
+  {
+    pc_counters[addr] = (chirp->coverage[addr >> 3] >> (addr & 7)) & 1;
+  }
+
+  return 0;
+}
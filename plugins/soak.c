@@ -0,0 +1,192 @@
+// plays a ROM with random key presses for a while and reports what it saw, as an example of the plugin interface in
+// src/chirp_plugin.h
+//
+// build with: make plugins
+// or by hand: cc -std=c11 -Isrc -shared -fPIC plugins/soak.c -o out/plugins/soak.so
+// run with:   out/chirp ROM --headless --frames=100000 --plugin=out/plugins/soak.so,frames=3600,watch=2F0-2F4,pc=2D4
+//
+// the arguments are separated by commas, with addresses in hex:
+//
+//   frames=N          stops the emulator after N frames; it runs for as long as it would otherwise without
+//   seed=N            seeds the key presses, which change every 8 frames; 0 presses no keys
+//   watch=START[-END] counts the writes to the addresses from START up to END, just START without one
+//   pc=ADDRESS        counts how often the instruction at ADDRESS runs
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "chirp_plugin.h"
+
+#define SOAK_KEY_INTERVAL 8 // frames between changes to the keys held
+
+typedef struct Soak
+{
+  const ChirpPluginApi* api;
+  uint64_t frames; // 0 to run until the emulator stops on its own
+  uint32_t random_state;
+  int key; // held key, -1 for none
+
+  uint16_t watch_start;
+  uint16_t watch_end;
+  uint64_t writes;
+  uint8_t last_value;
+
+  bool has_pc;
+  uint16_t pc;
+  uint64_t pc_hits;
+} Soak;
+
+// only one instance of the plugin is ever loaded into a process, since dlopen hands back the same library
+static Soak soak;
+
+uint32_t soak_random(Soak* state)
+{
+  uint32_t x = state->random_state;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  state->random_state = x;
+  return x;
+}
+
+void soak_frame(ChirpPluginHost* host, void* user, const uint64_t frame)
+{
+  Soak* state = user;
+  if (state->frames > 0 && frame >= state->frames)
+  {
+    state->api->stop(host);
+    return;
+  }
+
+  if (state->random_state != 0 && frame % SOAK_KEY_INTERVAL == 0)
+  {
+    if (state->key >= 0)
+    {
+      state->api->set_key(host, state->key, false);
+    }
+    // half of the time nothing is held, so that ROMs waiting for a release get one
+    const uint32_t random = soak_random(state);
+    state->key = (random & 0x10) != 0 ? (int)(random & 0xF) : -1;
+    if (state->key >= 0)
+    {
+      state->api->set_key(host, state->key, true);
+    }
+  }
+}
+
+void soak_write(ChirpPluginHost* host, void* user, const uint16_t address, const uint8_t value)
+{
+  Soak* state = user;
+  state->writes++;
+  state->last_value = value;
+}
+
+void soak_pc(ChirpPluginHost* host, void* user, const uint16_t address)
+{
+  Soak* state = user;
+  state->pc_hits++;
+}
+
+// one KEY=VALUE argument; false if it is not one of the above
+bool soak_parse(Soak* state, char* argument)
+{
+  char* value = strchr(argument, '=');
+  if (value == NULL)
+  {
+    return false;
+  }
+  *value++ = '\0';
+
+  char* end;
+  if (strcmp(argument, "frames") == 0)
+  {
+    state->frames = strtoull(value, &end, 10);
+  }
+  else if (strcmp(argument, "seed") == 0)
+  {
+    state->random_state = (uint32_t)strtoul(value, &end, 10);
+  }
+  else if (strcmp(argument, "watch") == 0)
+  {
+    state->watch_start = (uint16_t)strtoul(value, &end, 16);
+    state->watch_end = *end == '-' ? (uint16_t)strtoul(end + 1, &end, 16) : state->watch_start + 1;
+    if (!state->api->on_write(state->api->host, state->watch_start, state->watch_end, soak_write, state))
+    {
+      return false;
+    }
+  }
+  else if (strcmp(argument, "pc") == 0)
+  {
+    state->pc = (uint16_t)strtoul(value, &end, 16);
+    state->has_pc = true;
+    if (!state->api->on_pc(state->api->host, state->pc, soak_pc, state))
+    {
+      return false;
+    }
+  }
+  else
+  {
+    return false;
+  }
+
+  return *end == '\0';
+}
+
+bool chirp_plugin_init(const ChirpPluginApi* api, const char* args)
+{
+  if (api->abi_version != CHIRP_PLUGIN_ABI_VERSION)
+  {
+    fprintf(stderr, "soak: built for version %d of the plugin interface, not %d\n",
+            CHIRP_PLUGIN_ABI_VERSION,
+            api->abi_version);
+    return false;
+  }
+
+  memset(&soak, 0, sizeof(soak));
+  soak.api = api;
+  soak.random_state = 0x2545F491;
+  soak.key = -1;
+
+  char buffer[256];
+  snprintf(buffer, sizeof(buffer), "%s", args);
+  for (char* argument = strtok(buffer, ","); argument != NULL; argument = strtok(NULL, ","))
+  {
+    if (!soak_parse(&soak, argument))
+    {
+      fprintf(stderr, "soak: could not make sense of %s\n", argument);
+      return false;
+    }
+  }
+
+  return api->on_frame(api->host, soak_frame, &soak);
+}
+
+void chirp_plugin_exit(const ChirpPluginApi* api)
+{
+  int lit = 0;
+  for (int y = 0; y < 32; y++)
+  {
+    for (int x = 0; x < 64; x++)
+    {
+      lit += api->read_pixel(api->host, x, y) ? 1 : 0;
+    }
+  }
+
+  printf("soak: %llu frames, %llu instructions, %d pixels lit at the end\n",
+         (unsigned long long)api->frame_count(api->host),
+         (unsigned long long)api->instruction_count(api->host),
+         lit);
+  if (soak.watch_end > soak.watch_start)
+  {
+    printf("soak: %llu writes to %03X-%03X, the last of %02X\n",
+           (unsigned long long)soak.writes,
+           soak.watch_start,
+           soak.watch_end - 1,
+           soak.last_value);
+  }
+  if (soak.has_pc)
+  {
+    printf("soak: %03X ran %llu times\n", soak.pc, (unsigned long long)soak.pc_hits);
+  }
+}
@@ -0,0 +1,243 @@
+#include "analysis.h"
+#include "registers.h"
+
+#include <string.h>
+
+// instructions past this point would be fetched from the wrapped-around start of memory, which the core refuses
+#define CHIRP_ANALYSIS_LAST_ADDRESS (CHIRP_INSTRUCTIONS_ADDR_END - 1)
+
+typedef struct ChirpAnalysisWorklist
+{
+  uint16_t addresses[CHIRP_MEMORY_SIZE]; // every address is queued at most once, so this can never overflow
+  int size;
+} ChirpAnalysisWorklist;
+
+// marks the start of a block, queueing it unless the linear walk has been through it already
+void chirp_analysis_queue(ChirpAnalysis* analysis, ChirpAnalysisWorklist* worklist, const uint16_t address)
+{
+  uint8_t* flags = &analysis->flags[address & 0x0FFF];
+  if ((*flags & CHIRP_BYTE_BLOCK_START) != 0)
+  {
+    return;
+  }
+
+  *flags |= CHIRP_BYTE_BLOCK_START;
+  if ((*flags & CHIRP_BYTE_CODE) == 0)
+  {
+    worklist->addresses[worklist->size++] = address & 0x0FFF;
+  }
+}
+
+// queues and records the target of the BNNN at address, if the register added to NNN is known
+void chirp_analysis_queue_jump(ChirpAnalysis* analysis,
+                               ChirpAnalysisWorklist* worklist,
+                               const uint16_t address,
+                               const uint16_t nnn,
+                               const int offset)
+{
+  if (offset < 0 || nnn + offset >= CHIRP_MEMORY_SIZE)
+  {
+    return;
+  }
+
+  // both registers can hold the same value, which is still a single edge
+  const ChirpAnalysisJump jump = {address, nnn + offset};
+  const ChirpAnalysisJump* last = analysis->jump_count > 0 ? &analysis->jumps[analysis->jump_count - 1] : NULL;
+  if (analysis->jump_count < CHIRP_ANALYSIS_JUMPS && (last == NULL || last->from != jump.from || last->to != jump.to))
+  {
+    analysis->jumps[analysis->jump_count++] = jump;
+  }
+
+  analysis->flags[jump.to] |= CHIRP_BYTE_JUMP_TARGET;
+  chirp_analysis_queue(analysis, worklist, jump.to);
+}
+
+void chirp_analysis_mark(ChirpAnalysis* analysis, const uint16_t address, const int size, const uint8_t flags)
+{
+  for (int i = 0; i < size; i++)
+  {
+    analysis->flags[(address + i) & 0x0FFF] |= flags;
+  }
+}
+
+bool chirp_analysis_ends_block(const ChirpOp op)
+{
+  switch (op)
+  {
+  case CHIRP_OP_INVALID:
+  case CHIRP_OP_JP:
+  case CHIRP_OP_CALL:
+  case CHIRP_OP_RET:
+  case CHIRP_OP_JP_V0:
+    return true;
+  default:
+    return chirp_op_is_skip(op);
+  }
+}
+
+/**
+ * Walks every path from the entry point, one basic block at a time.
+ *
+ * Jumps, calls and both sides of every skip are followed; BNNN only when the block itself set the register its
+ * target depends on. Within a block, I and the registers are tracked from the constants loaded into them, so that
+ * the bytes the block reads or writes through I can be marked as data; anything that changes them in a way that
+ * depends on more than the block forgets them again.
+ */
+void chirp_analyse(const uint8_t* mem, const uint16_t entry, ChirpAnalysis* analysis)
+{
+  ChirpAnalysisWorklist worklist;
+  worklist.size = 0;
+
+  memset(analysis, 0, sizeof(ChirpAnalysis));
+  analysis->entry = entry;
+  chirp_analysis_queue(analysis, &worklist, entry);
+
+  while (worklist.size > 0)
+  {
+    uint16_t pc = worklist.addresses[--worklist.size];
+
+    // values of I and the registers, or -1 when they are not known
+    int index = -1;
+    int registers[CHIRP_REGISTERS_SIZE];
+    for (int i = 0; i < CHIRP_REGISTERS_SIZE; i++)
+    {
+      registers[i] = -1;
+    }
+
+    while (pc >= CHIRP_INSTRUCTIONS_ADDR_START && pc <= CHIRP_ANALYSIS_LAST_ADDRESS)
+    {
+      // falling through into code already walked means this is where two paths meet
+      if ((analysis->flags[pc] & CHIRP_BYTE_CODE) != 0)
+      {
+        analysis->flags[pc] |= CHIRP_BYTE_BLOCK_START;
+        break;
+      }
+
+      analysis->flags[pc] |= CHIRP_BYTE_CODE;
+      analysis->flags[pc + 1] |= CHIRP_BYTE_OPERAND;
+      analysis->instruction_count++;
+
+      const ChirpDecoded d = chirp_decode(chirp_decode_at(mem, pc));
+      const uint16_t next = pc + 2;
+
+      switch (d.op)
+      {
+      case CHIRP_OP_INVALID:
+        analysis->invalid_count++;
+        break;
+      case CHIRP_OP_JP:
+        analysis->flags[d.nnn] |= CHIRP_BYTE_JUMP_TARGET;
+        chirp_analysis_queue(analysis, &worklist, d.nnn);
+        break;
+      case CHIRP_OP_CALL:
+        analysis->flags[d.nnn] |= CHIRP_BYTE_CALL_TARGET;
+        chirp_analysis_queue(analysis, &worklist, d.nnn);
+        chirp_analysis_queue(analysis, &worklist, next);
+        break;
+      case CHIRP_OP_JP_V0:
+        // the target is known when the block set the register itself, as with a jump table indexed by a constant;
+        // either register can be the one added, depending on the jump_with_vx quirk
+        if (registers[0] < 0 && registers[d.x] < 0)
+        {
+          analysis->indirect_jump_count++;
+        }
+        chirp_analysis_queue_jump(analysis, &worklist, pc, d.nnn, registers[0]);
+        chirp_analysis_queue_jump(analysis, &worklist, pc, d.nnn, registers[d.x]);
+        break;
+      case CHIRP_OP_LD_VX_NN:
+        registers[d.x] = d.nn;
+        break;
+      case CHIRP_OP_ADD_VX_NN:
+        registers[d.x] = registers[d.x] < 0 ? -1 : (registers[d.x] + d.nn) & 0xFF;
+        break;
+      case CHIRP_OP_LD_VX_VY:
+        registers[d.x] = registers[d.y];
+        break;
+      case CHIRP_OP_OR:
+      case CHIRP_OP_AND:
+      case CHIRP_OP_XOR:
+      case CHIRP_OP_ADD_VX_VY:
+      case CHIRP_OP_SUB:
+      case CHIRP_OP_SHR:
+      case CHIRP_OP_SUBN:
+      case CHIRP_OP_SHL:
+        // not worth following through the flag and the quirks
+        registers[d.x] = -1;
+        registers[0xF] = -1;
+        break;
+      case CHIRP_OP_RND:
+      case CHIRP_OP_LD_VX_DT:
+      case CHIRP_OP_LD_VX_K:
+        registers[d.x] = -1;
+        break;
+      case CHIRP_OP_LD_I:
+        index = d.nnn;
+        chirp_analysis_mark(analysis, d.nnn, 1, CHIRP_BYTE_DATA);
+        break;
+      case CHIRP_OP_ADD_I_VX:
+      case CHIRP_OP_LD_F_VX:
+        index = -1;
+        break;
+      case CHIRP_OP_DRW:
+        registers[0xF] = -1; // collision flag
+        if (index >= 0)
+        {
+          chirp_analysis_mark(analysis, index, d.n, CHIRP_BYTE_DATA);
+        }
+        break;
+      case CHIRP_OP_AUDIO:
+        if (index >= 0)
+        {
+          chirp_analysis_mark(analysis, index, 16, CHIRP_BYTE_DATA);
+        }
+        break;
+      case CHIRP_OP_LD_B_VX:
+        if (index >= 0)
+        {
+          chirp_analysis_mark(analysis, index, 3, CHIRP_BYTE_DATA | CHIRP_BYTE_WRITTEN);
+        }
+        break;
+      case CHIRP_OP_STORE:
+      case CHIRP_OP_LOAD:
+        if (d.op == CHIRP_OP_LOAD)
+        {
+          for (int i = 0; i <= d.x; i++)
+          {
+            registers[i] = -1;
+          }
+        }
+        if (index >= 0)
+        {
+          const uint8_t flags = d.op == CHIRP_OP_STORE ? CHIRP_BYTE_DATA | CHIRP_BYTE_WRITTEN : CHIRP_BYTE_DATA;
+          chirp_analysis_mark(analysis, index, d.x + 1, flags);
+        }
+
+        // some quirks move I past the registers
+        index = -1;
+        break;
+      default:
+        if (chirp_op_is_skip(d.op))
+        {
+          chirp_analysis_queue(analysis, &worklist, next);
+          chirp_analysis_queue(analysis, &worklist, next + 2);
+        }
+        break;
+      }
+
+      if (chirp_analysis_ends_block(d.op))
+      {
+        break;
+      }
+      pc = next;
+    }
+  }
+
+  for (int i = 0; i < CHIRP_MEMORY_SIZE; i++)
+  {
+    const uint8_t block = CHIRP_BYTE_CODE | CHIRP_BYTE_BLOCK_START;
+    if ((analysis->flags[i] & block) == block)
+    {
+      analysis->block_count++;
+    }
+  }
+}
@@ -0,0 +1,42 @@
+#ifndef CHIRP_ANALYSIS_H
+#define CHIRP_ANALYSIS_H
+
+#include "decode.h"
+
+// static analysis of a memory image: follows every path the ROM can take from the entry point without running it,
+// recovering which bytes are code, which are read as data and where the basic blocks start
+
+// what is known about every address, as flags
+#define CHIRP_BYTE_CODE 0x01        // first byte of a reachable instruction
+#define CHIRP_BYTE_OPERAND 0x02     // second byte of a reachable instruction
+#define CHIRP_BYTE_DATA 0x04        // read as data from a known I (sprites, FX33, FX55, FX65, F002) or pointed at by ANNN
+#define CHIRP_BYTE_BLOCK_START 0x08 // first instruction of a basic block
+#define CHIRP_BYTE_JUMP_TARGET 0x10 // target of a 1NNN, or of a BNNN with a known register
+#define CHIRP_BYTE_CALL_TARGET 0x20 // target of a 2NNN
+#define CHIRP_BYTE_WRITTEN 0x40     // written through a known I (FX33, FX55), so possibly self-modifying if also code
+
+#define CHIRP_ANALYSIS_JUMPS 256 // BNNN targets recorded; any past that are still followed
+
+// a BNNN whose target the analysis worked out, which is one of the edges out of its block
+typedef struct ChirpAnalysisJump
+{
+  uint16_t from; // address of the BNNN
+  uint16_t to;
+} ChirpAnalysisJump;
+
+typedef struct ChirpAnalysis
+{
+  uint8_t flags[CHIRP_MEMORY_SIZE];
+  uint16_t entry;
+  int instruction_count;   // reachable instructions
+  int block_count;         // basic blocks
+  int indirect_jump_count; // BNNN whose targets depend on registers set outside the block and could not be followed
+  int invalid_count;       // reachable words that do not decode to any instruction
+  ChirpAnalysisJump jumps[CHIRP_ANALYSIS_JUMPS];
+  int jump_count;
+} ChirpAnalysis;
+
+void chirp_analyse(const uint8_t* mem, uint16_t entry, ChirpAnalysis* analysis);
+bool chirp_analysis_ends_block(ChirpOp op);
+
+#endif // CHIRP_ANALYSIS_H
@@ -0,0 +1,51 @@
+#include "aot.h"
+
+#include <string.h>
+
+// runs the instance through a translation from now on; false, leaving it interpreted, if its ROM is not the one the
+// translation was made from
+bool chirp_aot_attach(Chirp* chirp, const ChirpAotProgram* program)
+{
+  if (memcmp(&chirp->boot->mem->mem[CHIRP_INSTRUCTIONS_ADDR_START], program->image, program->image_size) != 0)
+  {
+    return false;
+  }
+
+  chirp->aot = program;
+  chirp->engine = CHIRP_ENGINE_AOT;
+  chirp->is_aot_checked = false;
+
+  // translated code never goes through chirp_fetch, so it is put behind the write barrier up front
+  chirp_mem_mark_code(chirp->mem, CHIRP_INSTRUCTIONS_ADDR_START, program->image_size);
+
+  return true;
+}
+
+/**
+ * Whether the code the translation has from address on is still what is in memory.
+ *
+ * The whole image is compared once after every change the write barrier reports, so that until the next one nothing
+ * is compared at all; only ROMs that have rewritten the translated code itself get the code from address on compared
+ * every time.
+ */
+bool chirp_aot_is_intact(Chirp* chirp, const ChirpAotProgram* program, const uint16_t address)
+{
+  if (address >= CHIRP_MEMORY_SIZE || program->extent[address] == 0)
+  {
+    return false;
+  }
+
+  if (!chirp->is_aot_checked)
+  {
+    chirp->is_aot_intact =
+      memcmp(&chirp->mem->mem[CHIRP_INSTRUCTIONS_ADDR_START], program->image, program->image_size) == 0;
+    chirp->is_aot_checked = true;
+  }
+  if (chirp->is_aot_intact)
+  {
+    return true;
+  }
+
+  const uint16_t offset = address - CHIRP_INSTRUCTIONS_ADDR_START;
+  return memcmp(&chirp->mem->mem[address], &program->image[offset], program->extent[address]) == 0;
+}
@@ -0,0 +1,54 @@
+#ifndef CHIRP_AOT_H
+#define CHIRP_AOT_H
+
+#include "chirp.h"
+#include "instructions.h"
+
+// support for ROMs translated ahead of time to C by chirp-aot (tools/chirp_aot.c)
+//
+// a translation is a switch over every reachable address, falling through from one instruction to the next and
+// calling the same handlers as chirp_execute_op, with the operands as constants. It runs straight-line code until
+// control leaves it, memory may have changed or the budget is spent; everything else, from BNNN targets it could not
+// see to code the ROM has rewritten, goes back to the interpreter one instruction at a time
+
+struct ChirpAotProgram
+{
+  const char* name;
+  const uint8_t* image;   // memory the translation was made from, starting at CHIRP_INSTRUCTIONS_ADDR_START
+  uint16_t image_size;    // bytes in image
+  const uint16_t* extent; // for every address, bytes of image the code from there on depends on; 0 when untranslated
+
+  // runs from the PC until control has to go back to chirp_run; false if there is no translation for it
+  bool (*run)(Chirp* chirp, uint64_t end);
+};
+
+bool chirp_aot_attach(Chirp* chirp, const ChirpAotProgram* program);
+bool chirp_aot_is_intact(Chirp* chirp, const ChirpAotProgram* program, uint16_t address);
+
+// whether the translation has anything for the PC at all, cheap enough to ask before every interpreted instruction
+static inline bool chirp_aot_covers(const Chirp* chirp)
+{
+  const uint16_t pc = chirp->program_counter;
+  return chirp->engine == CHIRP_ENGINE_AOT && pc < CHIRP_MEMORY_SIZE && chirp->aot->extent[pc] != 0;
+}
+
+// the translated counterpart of chirp_fetch for the instruction at address
+static inline void chirp_aot_fetch(Chirp* chirp, const uint16_t address)
+{
+#ifdef CHIRP_COVERAGE
+  chirp->coverage[address >> 3] |= (uint8_t)(1 << (address & 7));
+#endif
+
+  chirp->program_counter = address + 2;
+}
+
+// accounts for an instruction like chirp_execute_next; true when control has to go back to chirp_run
+static inline bool chirp_aot_retire(Chirp* chirp, const uint32_t vip_cost, const uint64_t end)
+{
+  chirp->instruction_count++;
+  chirp->cycle_count += chirp->config->vip_timing ? vip_cost : 1;
+
+  return chirp->fault != CHIRP_FAULT_NONE || chirp->idle_wake != 0 || chirp_cycles(chirp) >= end;
+}
+
+#endif // CHIRP_AOT_H
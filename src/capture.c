@@ -0,0 +1,433 @@
+#include "capture.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define CHIRP_CAPTURE_BACKGROUND {44, 78, 138} // same colours as the window
+#define CHIRP_CAPTURE_LIT {147, 180, 237}
+
+#define CHIRP_GIF_MIN_CODE_SIZE 4 // enough bits for every palette index
+#define CHIRP_GIF_CLEAR_CODE (1 << CHIRP_GIF_MIN_CODE_SIZE)
+#define CHIRP_GIF_END_CODE (CHIRP_GIF_CLEAR_CODE + 1)
+#define CHIRP_GIF_MIN_DELAY 2 // centiseconds; browsers slow anything shorter down to a tenth of a second
+
+#define CHIRP_Y4M_LUMA_SIZE (CHIRP_CAPTURE_WIDTH * CHIRP_CAPTURE_HEIGHT)
+#define CHIRP_Y4M_CHROMA_SIZE (CHIRP_Y4M_LUMA_SIZE / 4)
+
+void chirp_capture_put16(FILE* file, const int value)
+{
+  fputc(value & 0xFF, file);
+  fputc(value >> 8 & 0xFF, file);
+}
+
+void chirp_gif_write_header(ChirpCapture* capture)
+{
+  FILE* file = capture->file;
+  fwrite("GIF89a", 1, 6, file);
+  chirp_capture_put16(file, CHIRP_CAPTURE_WIDTH);
+  chirp_capture_put16(file, CHIRP_CAPTURE_HEIGHT);
+  fputc(0xF0 | (CHIRP_GIF_MIN_CODE_SIZE - 1), file); // global colour table of 2^4 entries, 8 bits per channel
+  fputc(0, file);                                     // background colour
+  fputc(0, file);                                     // square pixels
+  fwrite(capture->palette, 1, sizeof(capture->palette), file);
+
+  // loop forever
+  fwrite("\x21\xFF\x0BNETSCAPE2.0\x03\x01\x00\x00\x00", 1, 19, file);
+}
+
+void chirp_gif_put_byte(ChirpCapture* capture, const uint8_t byte)
+{
+  capture->block[++capture->block[0]] = byte;
+  if (capture->block[0] == 255)
+  {
+    fwrite(capture->block, 1, 256, capture->file);
+    capture->block[0] = 0;
+  }
+}
+
+void chirp_gif_put_code(ChirpCapture* capture, const int code, const int size)
+{
+  capture->bits |= (uint32_t)code << capture->bit_count;
+  capture->bit_count += size;
+  while (capture->bit_count >= 8)
+  {
+    chirp_gif_put_byte(capture, capture->bits & 0xFF);
+    capture->bits >>= 8;
+    capture->bit_count -= 8;
+  }
+}
+
+/**
+ * Writes the rows of the frame that differ from the one before it as a GIF image, LZW compressed.
+ *
+ * Frames are never disposed of, so the rows left out keep showing the previous frame. Codes start one bit wider than
+ * the palette indices, grow a bit whenever the dictionary needs it, and the dictionary starts over once it is full.
+ */
+void chirp_gif_write_frame(ChirpCapture* capture, const ChirpCaptureFrame* frame)
+{
+  FILE* file = capture->file;
+
+  int first = 0;
+  int last = DISPLAY_HEIGHT - 1;
+  if (capture->has_previous)
+  {
+    while (first < last && memcmp(frame->pixels[first], capture->previous.pixels[first], DISPLAY_WIDTH) == 0)
+    {
+      first++;
+    }
+    while (last > first && memcmp(frame->pixels[last], capture->previous.pixels[last], DISPLAY_WIDTH) == 0)
+    {
+      last--;
+    }
+  }
+
+  // rounding the end of the frame rather than its length keeps the whole animation in time with the ticks
+  const int end = (int)((capture->ticks_written + frame->ticks) * 100 + 30) / 60;
+  int delay = end - capture->centiseconds_written;
+  if (delay < CHIRP_GIF_MIN_DELAY)
+  {
+    delay = CHIRP_GIF_MIN_DELAY;
+  }
+  capture->centiseconds_written += delay;
+  capture->ticks_written += frame->ticks;
+
+  // graphic control extension: keep the frame when the next one is drawn, then the delay
+  fwrite("\x21\xF9\x04\x04", 1, 4, file);
+  chirp_capture_put16(file, delay);
+  fwrite("\x00\x00", 1, 2, file);
+
+  // image descriptor for the band of rows, no local colour table
+  fputc(0x2C, file);
+  chirp_capture_put16(file, 0);
+  chirp_capture_put16(file, first * CHIRP_CAPTURE_SCALE);
+  chirp_capture_put16(file, CHIRP_CAPTURE_WIDTH);
+  chirp_capture_put16(file, (last - first + 1) * CHIRP_CAPTURE_SCALE);
+  fputc(0, file);
+  fputc(CHIRP_GIF_MIN_CODE_SIZE, file);
+
+  int code_size = CHIRP_GIF_MIN_CODE_SIZE + 1;
+  int next_code = CHIRP_GIF_END_CODE + 1;
+  memset(capture->codes, 0, sizeof(capture->codes[0]) * CHIRP_GIF_MAX_CODES);
+  capture->block[0] = 0;
+  capture->bits = 0;
+  capture->bit_count = 0;
+  chirp_gif_put_code(capture, CHIRP_GIF_CLEAR_CODE, code_size);
+
+  int prefix = -1;
+  for (int y = first * CHIRP_CAPTURE_SCALE; y < (last + 1) * CHIRP_CAPTURE_SCALE; y++)
+  {
+    const uint8_t* row = frame->pixels[y / CHIRP_CAPTURE_SCALE];
+    for (int x = 0; x < CHIRP_CAPTURE_WIDTH; x++)
+    {
+      const uint8_t index = row[x / CHIRP_CAPTURE_SCALE];
+      if (prefix < 0)
+      {
+        prefix = index;
+        continue;
+      }
+
+      const uint16_t code = capture->codes[prefix][index];
+      if (code != 0)
+      {
+        prefix = code;
+        continue;
+      }
+
+      chirp_gif_put_code(capture, prefix, code_size);
+      if (next_code < CHIRP_GIF_MAX_CODES)
+      {
+        if (next_code == 1 << code_size)
+        {
+          code_size++;
+        }
+        capture->codes[prefix][index] = (uint16_t)next_code++;
+      }
+      else
+      {
+        chirp_gif_put_code(capture, CHIRP_GIF_CLEAR_CODE, code_size);
+        memset(capture->codes, 0, sizeof(capture->codes[0]) * CHIRP_GIF_MAX_CODES);
+        code_size = CHIRP_GIF_MIN_CODE_SIZE + 1;
+        next_code = CHIRP_GIF_END_CODE + 1;
+      }
+      prefix = index;
+    }
+  }
+
+  // the decoder adds a code for the last one too, and may need a wider code for the end because of it
+  chirp_gif_put_code(capture, prefix, code_size);
+  if (next_code == 1 << code_size && code_size < 12)
+  {
+    code_size++;
+  }
+  chirp_gif_put_code(capture, CHIRP_GIF_END_CODE, code_size);
+  if (capture->bit_count > 0)
+  {
+    chirp_gif_put_byte(capture, capture->bits & 0xFF);
+  }
+  if (capture->block[0] > 0)
+  {
+    fwrite(capture->block, 1, capture->block[0] + 1, file);
+  }
+  fputc(0, file);
+}
+
+void chirp_y4m_write_header(ChirpCapture* capture)
+{
+  fprintf(capture->file, "YUV4MPEG2 W%d H%d F60:1 Ip A1:1 C420jpeg\n", CHIRP_CAPTURE_WIDTH, CHIRP_CAPTURE_HEIGHT);
+}
+
+/**
+ * Writes the frame once for every tick it lasted. Display pixels are whole blocks of 2x2 chroma samples, so the
+ * subsampling never mixes two of them; the colours are converted with BT.601 in studio range.
+ */
+void chirp_y4m_write_frame(ChirpCapture* capture, const ChirpCaptureFrame* frame)
+{
+  uint8_t yuv[CHIRP_CAPTURE_PALETTE_SIZE][3];
+  for (int i = 0; i < CHIRP_CAPTURE_PALETTE_SIZE; i++)
+  {
+    const int r = capture->palette[i][0];
+    const int g = capture->palette[i][1];
+    const int b = capture->palette[i][2];
+    yuv[i][0] = (uint8_t)(16 + ((66 * r + 129 * g + 25 * b + 128) >> 8));
+    yuv[i][1] = (uint8_t)(128 + ((-38 * r - 74 * g + 112 * b + 128) >> 8));
+    yuv[i][2] = (uint8_t)(128 + ((112 * r - 94 * g - 18 * b + 128) >> 8));
+  }
+
+  uint8_t* luma = capture->image;
+  uint8_t* u = luma + CHIRP_Y4M_LUMA_SIZE;
+  uint8_t* v = u + CHIRP_Y4M_CHROMA_SIZE;
+  for (int y = 0; y < CHIRP_CAPTURE_HEIGHT; y++)
+  {
+    for (int x = 0; x < CHIRP_CAPTURE_WIDTH; x++)
+    {
+      luma[y * CHIRP_CAPTURE_WIDTH + x] = yuv[frame->pixels[y / CHIRP_CAPTURE_SCALE][x / CHIRP_CAPTURE_SCALE]][0];
+    }
+  }
+  for (int y = 0; y < CHIRP_CAPTURE_HEIGHT / 2; y++)
+  {
+    for (int x = 0; x < CHIRP_CAPTURE_WIDTH / 2; x++)
+    {
+      const uint8_t index = frame->pixels[y * 2 / CHIRP_CAPTURE_SCALE][x * 2 / CHIRP_CAPTURE_SCALE];
+      u[y * CHIRP_CAPTURE_WIDTH / 2 + x] = yuv[index][1];
+      v[y * CHIRP_CAPTURE_WIDTH / 2 + x] = yuv[index][2];
+    }
+  }
+
+  for (uint32_t i = 0; i < frame->ticks; i++)
+  {
+    fwrite("FRAME\n", 1, 6, capture->file);
+    fwrite(capture->image, 1, CHIRP_Y4M_LUMA_SIZE + 2 * CHIRP_Y4M_CHROMA_SIZE, capture->file);
+  }
+}
+
+// the encoder thread: writes out queued frames until the queue is empty and nothing else is coming
+int SDLCALL chirp_capture_run(void* data)
+{
+  ChirpCapture* capture = data;
+
+  SDL_LockMutex(capture->lock);
+  while (true)
+  {
+    while (capture->queue_size == 0 && !capture->is_closing)
+    {
+      SDL_WaitCondition(capture->has_frames, capture->lock);
+    }
+    if (capture->queue_size == 0)
+    {
+      break;
+    }
+
+    // the emulator never touches a queued slot, so it can be encoded without holding the lock
+    const ChirpCaptureFrame* frame = &capture->queue[capture->queue_start];
+    SDL_UnlockMutex(capture->lock);
+
+    if (capture->format == CHIRP_CAPTURE_GIF)
+    {
+      chirp_gif_write_frame(capture, frame);
+    }
+    else
+    {
+      chirp_y4m_write_frame(capture, frame);
+    }
+    capture->previous = *frame;
+    capture->has_previous = true;
+
+    SDL_LockMutex(capture->lock);
+    capture->queue_start = (capture->queue_start + 1) % CHIRP_CAPTURE_QUEUE_SIZE;
+    capture->queue_size--;
+    SDL_SignalCondition(capture->has_room);
+  }
+  SDL_UnlockMutex(capture->lock);
+
+  return 0;
+}
+
+// NULL if the path does not end in .y4m or .gif, or cannot be written to
+ChirpCapture* chirp_capture_new(const char* path)
+{
+  const char* extension = strrchr(path, '.');
+  ChirpCaptureFormat format;
+  if (extension != NULL && strcmp(extension, ".y4m") == 0)
+  {
+    format = CHIRP_CAPTURE_Y4M;
+  }
+  else if (extension != NULL && strcmp(extension, ".gif") == 0)
+  {
+    format = CHIRP_CAPTURE_GIF;
+  }
+  else
+  {
+    fprintf(stderr, "captures are written as .y4m or .gif\n");
+    return NULL;
+  }
+
+  FILE* file = fopen(path, "wb");
+  if (file == NULL)
+  {
+    fprintf(stderr, "could not open %s for the capture\n", path);
+    return NULL;
+  }
+
+  ChirpCapture* capture = malloc(sizeof(ChirpCapture));
+  uint8_t* image = malloc(CHIRP_Y4M_LUMA_SIZE + 2 * CHIRP_Y4M_CHROMA_SIZE);
+  uint16_t(*codes)[CHIRP_CAPTURE_PALETTE_SIZE] = malloc(sizeof(codes[0]) * CHIRP_GIF_MAX_CODES);
+  if (capture == NULL || image == NULL || codes == NULL)
+  {
+    fprintf(stderr, "out of memory\n");
+    exit(1);
+  }
+
+  capture->file = file;
+  capture->format = format;
+  capture->has_current = false;
+  capture->version = 0;
+  capture->queue_start = 0;
+  capture->queue_size = 0;
+  capture->is_closing = false;
+  capture->has_previous = false;
+  capture->ticks_written = 0;
+  capture->centiseconds_written = 0;
+  capture->image = image;
+  capture->codes = codes;
+
+  const uint8_t background[3] = CHIRP_CAPTURE_BACKGROUND;
+  const uint8_t lit[3] = CHIRP_CAPTURE_LIT;
+  for (int i = 0; i < CHIRP_CAPTURE_PALETTE_SIZE; i++)
+  {
+    for (int c = 0; c < 3; c++)
+    {
+      capture->palette[i][c] =
+        (uint8_t)(background[c] + (lit[c] - background[c]) * i / (CHIRP_CAPTURE_PALETTE_SIZE - 1));
+    }
+  }
+
+  if (format == CHIRP_CAPTURE_GIF)
+  {
+    chirp_gif_write_header(capture);
+  }
+  else
+  {
+    chirp_y4m_write_header(capture);
+  }
+
+  capture->lock = SDL_CreateMutex();
+  capture->has_frames = SDL_CreateCondition();
+  capture->has_room = SDL_CreateCondition();
+  capture->thread = SDL_CreateThread(chirp_capture_run, "chirp capture", capture);
+  if (capture->lock == NULL || capture->has_frames == NULL || capture->has_room == NULL || capture->thread == NULL)
+  {
+    fprintf(stderr, "could not start the capture thread: %s\n", SDL_GetError());
+    exit(1);
+  }
+
+  return capture;
+}
+
+// hands a frame over to the encoder, waiting for room if it has fallen behind
+void chirp_capture_queue(ChirpCapture* capture, const ChirpCaptureFrame* frame)
+{
+  SDL_LockMutex(capture->lock);
+  while (capture->queue_size == CHIRP_CAPTURE_QUEUE_SIZE)
+  {
+    SDL_WaitCondition(capture->has_room, capture->lock);
+  }
+
+  capture->queue[(capture->queue_start + capture->queue_size) % CHIRP_CAPTURE_QUEUE_SIZE] = *frame;
+  capture->queue_size++;
+  SDL_SignalCondition(capture->has_frames);
+  SDL_UnlockMutex(capture->lock);
+}
+
+/**
+ * Called on every 60Hz tick with the display, or with the anti-flicker if there is one. Nothing is converted while
+ * neither has been written to since the last tick, and a frame is only queued once the next one turns out to be
+ * different, with the number of ticks it lasted.
+ */
+void chirp_capture_tick(ChirpCapture* capture, const ChirpDisplay* display, const ChirpDeflicker* deflicker)
+{
+  const uint64_t version = deflicker != NULL ? deflicker->version : display->version;
+  if (capture->has_current && version == capture->version)
+  {
+    capture->current.ticks++;
+    return;
+  }
+  capture->version = version;
+
+  ChirpCaptureFrame frame;
+  for (int y = 0; y < DISPLAY_HEIGHT; y++)
+  {
+    for (int x = 0; x < DISPLAY_WIDTH; x++)
+    {
+      frame.pixels[y][x] = deflicker != NULL
+                             ? (uint8_t)((deflicker->levels[y][x] * (CHIRP_CAPTURE_PALETTE_SIZE - 1) + 127) / 255)
+                             : display->display[y][x] ? CHIRP_CAPTURE_PALETTE_SIZE - 1 : 0;
+    }
+  }
+
+  // written to, but back the way it was, as when a sprite is erased and drawn again in the same place
+  if (capture->has_current && memcmp(frame.pixels, capture->current.pixels, sizeof(frame.pixels)) == 0)
+  {
+    capture->current.ticks++;
+    return;
+  }
+
+  if (capture->has_current)
+  {
+    chirp_capture_queue(capture, &capture->current);
+  }
+  memcpy(capture->current.pixels, frame.pixels, sizeof(frame.pixels));
+  capture->current.ticks = 1;
+  capture->has_current = true;
+}
+
+// queues the last frame, waits for the encoder to write out everything and finishes the file
+void chirp_capture_free(ChirpCapture* capture)
+{
+  if (capture->has_current)
+  {
+    chirp_capture_queue(capture, &capture->current);
+  }
+
+  SDL_LockMutex(capture->lock);
+  capture->is_closing = true;
+  SDL_SignalCondition(capture->has_frames);
+  SDL_UnlockMutex(capture->lock);
+  SDL_WaitThread(capture->thread, NULL);
+
+  if (capture->format == CHIRP_CAPTURE_GIF)
+  {
+    fputc(0x3B, capture->file);
+  }
+  const bool has_failed = ferror(capture->file) != 0;
+  if (fclose(capture->file) != 0 || has_failed)
+  {
+    fprintf(stderr, "could not write the whole capture\n");
+  }
+
+  SDL_DestroyCondition(capture->has_frames);
+  SDL_DestroyCondition(capture->has_room);
+  SDL_DestroyMutex(capture->lock);
+  free(capture->image);
+  free(capture->codes);
+  free(capture);
+}
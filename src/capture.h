@@ -0,0 +1,76 @@
+#ifndef CHIRP_CAPTURE_H
+#define CHIRP_CAPTURE_H
+
+#include "SDL3/SDL.h"
+#include "deflicker.h"
+#include "display.h"
+
+#include <stdint.h>
+#include <stdio.h>
+
+// records the display on every 60Hz tick into a Y4M video or an animated GIF. The emulator only turns the display
+// into palette indices and queues them, and a frame that did not change only makes the one before it last longer;
+// the encoding and the writing happen on a thread of their own
+
+#define CHIRP_CAPTURE_SCALE 8         // output pixels per display pixel, in both directions
+#define CHIRP_CAPTURE_QUEUE_SIZE 64   // frames the emulator can get ahead of the encoder by before it waits
+#define CHIRP_CAPTURE_PALETTE_SIZE 16 // shades from the background to lit, for the levels of the anti-flicker
+
+#define CHIRP_CAPTURE_WIDTH (DISPLAY_WIDTH * CHIRP_CAPTURE_SCALE)
+#define CHIRP_CAPTURE_HEIGHT (DISPLAY_HEIGHT * CHIRP_CAPTURE_SCALE)
+
+#define CHIRP_GIF_MAX_CODES 4096 // LZW codes are at most 12 bits
+
+typedef enum ChirpCaptureFormat
+{
+  CHIRP_CAPTURE_Y4M, // uncompressed 4:2:0 video at 60 frames per second, for ffmpeg and the like
+  CHIRP_CAPTURE_GIF, // animated, each frame held for as long as the display did not change
+} ChirpCaptureFormat;
+
+// a display's worth of palette indices, shown for a number of ticks
+typedef struct ChirpCaptureFrame
+{
+  uint8_t pixels[DISPLAY_HEIGHT][DISPLAY_WIDTH];
+  uint32_t ticks;
+} ChirpCaptureFrame;
+
+typedef struct ChirpCapture
+{
+  FILE* file;
+  ChirpCaptureFormat format;
+
+  // only ever touched by the emulator
+  ChirpCaptureFrame current; // latest frame, queued once a different one replaces it
+  bool has_current;
+  uint64_t version; // of the display or the anti-flicker the current frame was made from
+
+  // frames waiting for the encoder; the emulator fills the slot after the last and the encoder empties the first
+  ChirpCaptureFrame queue[CHIRP_CAPTURE_QUEUE_SIZE];
+  int queue_start;
+  int queue_size;
+  bool is_closing; // nothing else will be queued
+  SDL_Mutex* lock;
+  SDL_Condition* has_frames;
+  SDL_Condition* has_room;
+  SDL_Thread* thread;
+
+  // only ever touched by the encoder
+  uint8_t palette[CHIRP_CAPTURE_PALETTE_SIZE][3];
+  ChirpCaptureFrame previous; // last frame written, for the rows a GIF frame can leave out
+  bool has_previous;
+  uint64_t ticks_written;
+  int centiseconds_written; // GIF frame delays are in hundredths of a second, so ticks are rounded as they go
+  uint8_t* image;           // one scaled frame as Y4M planes
+
+  // LZW dictionary as a trie: the code for a code followed by a palette index, 0 if there is none yet
+  uint16_t (*codes)[CHIRP_CAPTURE_PALETTE_SIZE];
+  uint8_t block[256]; // GIF data sub-block being filled, length first
+  uint32_t bits;      // LZW output not yet in the sub-block
+  int bit_count;
+} ChirpCapture;
+
+ChirpCapture* chirp_capture_new(const char* path);
+void chirp_capture_free(ChirpCapture* capture);
+void chirp_capture_tick(ChirpCapture* capture, const ChirpDisplay* display, const ChirpDeflicker* deflicker);
+
+#endif // CHIRP_CAPTURE_H
@@ -1,20 +1,135 @@
 #include <SDL3/SDL.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
+#include "analysis.h"
+#include "aot.h"
 #include "chirp.h"
+#include "gdbstub.h"
+#include "idle.h"
 #include "instructions.h"
+#include "log.h"
+#include "plugin.h"
+#include "timing.h"
+
+void chirp_load_fonts(Chirp* chirp)
+{
+  for (int i = 0; i < CHIRP_FONTS_BYTES; i++)
+  {
+    chirp_mem_write(chirp->mem, i + CHIRP_FONTS_ADDR_START, CHIRP_FONTS[i]);
+  }
+}
+
+// an image of all 0s that nothing uses yet
+ChirpBootImage* chirp_boot_new()
+{
+  ChirpBootImage* boot = malloc(sizeof(ChirpBootImage));
+  if (boot == NULL)
+  {
+    fprintf(stderr, "out of memory\n");
+    exit(1);
+  }
+
+  boot->mem = chirp_mem_new();
+  boot->refs = 0;
+  return boot;
+}
+
+void chirp_boot_release(ChirpBootImage* boot)
+{
+  if (boot != NULL && --boot->refs == 0)
+  {
+    chirp_mem_free(boot->mem);
+    free(boot);
+  }
+}
+
+// swaps the instance's boot image for the given one, which it then shares
+void chirp_boot_share(Chirp* chirp, ChirpBootImage* boot)
+{
+  boot->refs++;
+  chirp_boot_release(chirp->boot);
+  chirp->boot = boot;
+}
+
+// replaces the boot image with the fonts and the given ROM, then resets the machine onto it
+bool chirp_load_rom_image(Chirp* chirp, const uint8_t* rom, const size_t rom_size)
+{
+  if (CHIRP_INSTRUCTIONS_REGION_SIZE < rom_size)
+  {
+    return false;
+  }
+
+  chirp_mem_clear(chirp->mem);
+  chirp_load_fonts(chirp);
+  for (size_t i = 0; i < rom_size; i++)
+  {
+    chirp_mem_write(chirp->mem, i + CHIRP_INSTRUCTIONS_ADDR_START, rom[i]);
+  }
+
+  // cache the post-load image so restarts never have to touch the ROM again; clones sharing the old one keep it
+  if (chirp->boot == NULL || chirp->boot->refs > 1)
+  {
+    chirp_boot_share(chirp, chirp_boot_new());
+  }
+  chirp_mem_copy(chirp->boot->mem, chirp->mem);
+  // a translation was made for whatever ROM was there before
+  chirp->aot = NULL;
+  if (chirp->engine == CHIRP_ENGINE_AOT)
+  {
+    chirp->engine = CHIRP_ENGINE_CACHED;
+  }
+  chirp_reset(chirp);
+
+  return true;
+}
+
+/**
+ * Fills in the config from what the ROM database knows about the ROM. The quirk flags on the command line can only
+ * turn quirks on, so the database's are added to them; a speed or keymap given on the command line wins.
+ */
+void chirp_apply_rom_entry(ChirpConfig* config, const ChirpRomEntry* entry)
+{
+  config->rom_entry = entry;
+  if (entry == NULL)
+  {
+    return;
+  }
+
+  config->shift_vx |= (entry->quirks & CHIRP_QUIRK_SHIFT_VX) != 0;
+  config->jump_with_vx |= (entry->quirks & CHIRP_QUIRK_JUMP_WITH_VX) != 0;
+  config->set_registers_increment_index |= (entry->quirks & CHIRP_QUIRK_SET_REGISTERS_INCREMENT_INDEX) != 0;
+  config->load_registers_increment_index |= (entry->quirks & CHIRP_QUIRK_LOAD_REGISTERS_INCREMENT_INDEX) != 0;
+  config->xo_chip |= strcmp(entry->platform, "xo-chip") == 0;
+
+  if (entry->cpu_speed != 0 && (config->given & CHIRP_GIVEN_CPU_SPEED) == 0)
+  {
+    config->cpu_speed = entry->cpu_speed;
+  }
+
+  if (entry->keymap[0] != '\0' && (config->given & CHIRP_GIVEN_KEYMAP) == 0)
+  {
+    // the emulator loop counts on the keymap having been checked already
+    ChirpKeymap keymap;
+    if (chirp_keymap_parse(&keymap, entry->keymap))
+    {
+      config->keymap = entry->keymap;
+    }
+    else
+    {
+      fprintf(stderr, "ignoring the keymap the ROM database has for %s\n", entry->title);
+    }
+  }
+}
 
 void chirp_load_rom(Chirp* chirp)
 {
   FILE* rom = fopen(chirp->config->rom_path, "rb");
   if (rom != NULL)
   {
-    fseek(rom, 0, SEEK_END);
-    const long rom_size = ftell(rom);
-    rewind(rom);
-
-    uint8_t* rom_contents = malloc(sizeof(uint8_t) * rom_size);
+    // reading one byte more than fits is enough to tell a ROM that is too large, whatever the file claims its size is
+    uint8_t* rom_contents = malloc(sizeof(uint8_t) * (CHIRP_INSTRUCTIONS_REGION_SIZE + 1));
     if (rom_contents == NULL)
     {
       fclose(rom);
@@ -22,17 +137,33 @@ void chirp_load_rom(Chirp* chirp)
       exit(1);
     }
 
-    fread(rom_contents, sizeof(uint8_t), rom_size, rom);
-    if (CHIRP_INSTRUCTIONS_REGION_SIZE < rom_size)
+    const size_t rom_size = fread(rom_contents, sizeof(uint8_t), CHIRP_INSTRUCTIONS_REGION_SIZE + 1, rom);
+    if (ferror(rom))
+    {
+      fclose(rom);
+      fprintf(stderr, "could not read the ROM\n");
+      exit(1);
+    }
+
+    // there would be nothing to run but the 0000 that fills empty memory
+    if (rom_size == 0)
+    {
+      fclose(rom);
+      fprintf(stderr, "ROM is empty\n");
+      exit(1);
+    }
+
+    if (!chirp_load_rom_image(chirp, rom_contents, rom_size))
     {
       fclose(rom);
       fprintf(stderr, "ROM too large\n");
       exit(1);
     }
 
-    for (int i = 0; i < rom_size; i++)
+    if (chirp->config->rom_db != NULL)
     {
-      chirp_mem_write(chirp->mem, i + CHIRP_INSTRUCTIONS_ADDR_START, rom_contents[i]);
+      chirp_apply_rom_entry(chirp->config,
+                            chirp_romdb_find(chirp->config->rom_db, chirp_rom_hash(rom_contents, rom_size)));
     }
 
     fclose(rom);
@@ -45,18 +176,22 @@ void chirp_load_rom(Chirp* chirp)
   }
 }
 
-void chirp_load_fonts(Chirp* chirp)
+// write barrier hook of the instance's memory: whatever was derived from the code there has to check itself again
+void chirp_code_written(void* context, const uint16_t start, const uint16_t end)
 {
-  for (int i = 0; i < CHIRP_FONTS_BYTES; i++)
-  {
-    chirp_mem_write(chirp->mem, i + CHIRP_FONTS_ADDR_START, CHIRP_FONTS[i]);
-  }
+  Chirp* chirp = context;
+  chirp->is_aot_checked = false;
 }
 
-// loads all the necessary state for the CHIP-8 emulator
-Chirp* chirp_new(ChirpConfig* config)
+// allocates every component of an instance without loading anything into it
+Chirp* chirp_alloc(ChirpConfig* config)
 {
   Chirp* chirp = malloc(sizeof(Chirp));
+  if (chirp == NULL)
+  {
+    fprintf(stderr, "out of memory\n");
+    exit(1);
+  }
 
   chirp->config = config;
 
@@ -66,6 +201,56 @@ Chirp* chirp_new(ChirpConfig* config)
   chirp->registers = chirp_registers_new();
   chirp->display = chirp_display_new();
   chirp->keyboard = chirp_keyboard_new();
+  chirp->deflicker = config->deflicker > 0 ? chirp_deflicker_new(config->deflicker) : NULL;
+  chirp->boot = NULL;
+  chirp->decode_cache = chirp_decode_cache_new();
+  chirp->capture = NULL;
+  chirp->plugins = NULL;
+  chirp->breakpoints = NULL;
+  chirp->engine = CHIRP_ENGINE_CACHED;
+  chirp->aot = NULL;
+  chirp->is_aot_checked = false;
+  chirp->is_aot_intact = false;
+  chirp_mem_watch(chirp->mem, chirp_code_written, chirp);
+
+  return chirp;
+}
+
+// loads all the necessary state for the CHIP-8 emulator
+Chirp* chirp_new(ChirpConfig* config)
+{
+  Chirp* chirp = chirp_alloc(config);
+  chirp_load_rom(chirp);
+
+  return chirp;
+}
+
+// same as chirp_new but with the ROM already in memory; returns NULL if the ROM is too large
+Chirp* chirp_new_from_rom(ChirpConfig* config, const uint8_t* rom, const size_t rom_size)
+{
+  Chirp* chirp = chirp_alloc(config);
+  if (!chirp_load_rom_image(chirp, rom, rom_size))
+  {
+    chirp_free(chirp);
+    return NULL;
+  }
+
+  return chirp;
+}
+
+// reinitialises the machine in place from the cached post-load image; performs no allocation
+void chirp_reset(Chirp* chirp)
+{
+  chirp_mem_copy(chirp->mem, chirp->boot->mem);
+  memset(&chirp->mem->stats, 0, sizeof(chirp->mem->stats));
+  chirp_stack_clear(chirp->stack);
+  chirp_registers_clear(chirp->registers);
+  chirp_display_clear(chirp->display);
+  chirp_keyboard_clear(chirp->keyboard);
+  if (chirp->deflicker != NULL)
+  {
+    chirp_deflicker_reset(chirp->deflicker);
+  }
 
   chirp->is_running = true;
   chirp->is_paused = false;
@@ -75,68 +260,339 @@ Chirp* chirp_new(ChirpConfig* config)
   chirp->sound_timer = 0;
   chirp->index_register = 0;
   chirp->program_counter = (uint16_t)CHIRP_INSTRUCTIONS_ADDR_START;
+  chirp->random_state = CHIRP_RANDOM_SEED;
 
-  chirp_load_rom(chirp);
-  chirp_load_fonts(chirp);
+  memset(chirp->audio_pattern, 0, sizeof(chirp->audio_pattern));
+  chirp->audio_pitch = CHIRP_AUDIO_DEFAULT_PITCH;
+  chirp->has_audio_pattern = false;
+  chirp->need_update_audio = true; // puts the default beep back if the previous run loaded a pattern
 
-  return chirp;
+  memset(&chirp->loop, 0, sizeof(chirp->loop));
+  chirp->idle_wake = 0;
+  chirp->key_wait = -1;
+
+  chirp->instruction_count = 0;
+  chirp->cycle_count = 0;
+  chirp->frame_count = 0;
+
+  chirp->fault = CHIRP_FAULT_NONE;
+  chirp->fault_address = 0;
+  chirp->fault_instruction = 0;
+
+#ifdef CHIRP_COVERAGE
+  memset(chirp->coverage, 0, sizeof(chirp->coverage));
+#endif
 }
 
-void chirp_update_timers(Chirp* chirp, SDLWindow* window)
+// copies the full state of src into dst, which shares src's boot image from then on; performs no allocation
+void chirp_copy(Chirp* dst, const Chirp* src)
 {
+  dst->config = src->config;
+
+  chirp_mem_copy(dst->mem, src->mem);
+  *dst->stack = *src->stack;
+  *dst->registers = *src->registers;
+  *dst->display = *src->display;
+  *dst->keyboard = *src->keyboard;
+  // instances made from different configs may disagree on having a deflicker; one that has it alone starts over from
+  // the display, and one that lacks it draws the display as it is
+  if (dst->deflicker != NULL && src->deflicker != NULL)
+  {
+    chirp_deflicker_copy(dst->deflicker, src->deflicker);
+  }
+  else if (dst->deflicker != NULL)
+  {
+    chirp_deflicker_show(dst->deflicker, dst->display);
+  }
+  if (dst->boot != src->boot)
+  {
+    chirp_boot_share(dst, src->boot);
+  }
+  dst->engine = src->engine;
+  dst->aot = src->aot;
+
+  dst->program_counter = src->program_counter;
+  dst->index_register = src->index_register;
+  dst->delay_timer = src->delay_timer;
+  dst->sound_timer = src->sound_timer;
+  dst->random_state = src->random_state;
+
+  dst->is_running = src->is_running;
+  dst->is_paused = src->is_paused;
+  dst->need_draw_screen = src->need_draw_screen;
+
+  memcpy(dst->audio_pattern, src->audio_pattern, sizeof(src->audio_pattern));
+  dst->audio_pitch = src->audio_pitch;
+  dst->has_audio_pattern = src->has_audio_pattern;
+  dst->need_update_audio = src->need_update_audio;
+
+  dst->loop = src->loop;
+  dst->idle_wake = src->idle_wake;
+  dst->key_wait = src->key_wait;
+
+  dst->instruction_count = src->instruction_count;
+  dst->cycle_count = src->cycle_count;
+  dst->frame_count = src->frame_count;
+
+  dst->fault = src->fault;
+  dst->fault_address = src->fault_address;
+  dst->fault_instruction = src->fault_instruction;
+
+#ifdef CHIRP_COVERAGE
+  memcpy(dst->coverage, src->coverage, sizeof(src->coverage));
+#endif
+}
+
+// creates a new instance with the exact state of an existing one; the config is shared
+Chirp* chirp_clone(const Chirp* chirp)
+{
+  Chirp* clone = chirp_alloc(chirp->config);
+  chirp_copy(clone, chirp);
+
+  return clone;
+}
+
+// next byte from the instance's own xorshift generator
+uint8_t chirp_random(Chirp* chirp)
+{
+  uint32_t state = chirp->random_state;
+  state ^= state << 13;
+  state ^= state >> 17;
+  state ^= state << 5;
+  chirp->random_state = state;
+
+  return (uint8_t)(state >> 24);
+}
+
+// advances both timers by one 60Hz tick
+void chirp_tick_timers(Chirp* chirp)
+{
+  chirp_idle_catch_up(chirp);
+
   if (chirp->delay_timer > 0)
   {
     chirp->delay_timer--;
+    chirp_idle_wake(chirp, CHIRP_WAKE_TIMER);
   }
 
   if (chirp->sound_timer > 0)
   {
-    if (chirp->config->has_audio)
+    chirp->sound_timer--;
+  }
+
+  chirp_idle_wake(chirp, CHIRP_WAKE_VBLANK);
+  if (chirp->deflicker != NULL)
+  {
+    chirp_deflicker_update(chirp->deflicker, chirp->display);
+  }
+  if (chirp->capture != NULL)
+  {
+    chirp_capture_tick(chirp->capture, chirp->display, chirp->deflicker);
+  }
+  chirp->frame_count++;
+
+  if (chirp->plugins != NULL)
+  {
+    chirp_plugins_end_frame(chirp->plugins);
+  }
+}
+
+// updates a key from the host, waking the machine if it is idle on the keyboard; keys outside 0-F are ignored
+void chirp_set_key(Chirp* chirp, const int key, const bool is_pressed)
+{
+  if (key < 0 || key >= CHIRP_KEYBOARD_SIZE || chirp_keyboard_read(chirp->keyboard, key) == is_pressed)
+  {
+    return;
+  }
+
+  chirp_idle_catch_up(chirp);
+  chirp_keyboard_write(chirp->keyboard, key, is_pressed, chirp_cycles(chirp));
+
+  // a machine blocked on FX0A only ever wakes up for a release, which is also the key it gets
+  if (chirp->key_wait >= 0)
+  {
+    if (!is_pressed)
     {
-      sdl_window_start_beep(window);
+      chirp_registers_write(chirp->registers, chirp->key_wait, (uint8_t)key);
+      chirp->key_wait = -1;
+      chirp_idle_clear(chirp);
     }
-    chirp->sound_timer--;
+    return;
   }
-  else
+
+  // a pass through a loop that read the keys before the change says nothing about the passes after it, so the
+  // snapshot taken at its start goes along with any wait on keys; a machine parked on the timer never read them
+  if (chirp->idle_wake == 0 || (chirp->idle_wake & CHIRP_WAKE_KEY) != 0)
+  {
+    chirp_idle_clear(chirp);
+  }
+}
+
+bool chirp_is_idle(const Chirp* chirp)
+{
+  return chirp->idle_wake != 0;
+}
+
+// samples per second the XO-CHIP audio pattern plays at
+float chirp_audio_rate(const Chirp* chirp)
+{
+  return 4000.0f * SDL_powf(2.0f, ((float)chirp->audio_pitch - CHIRP_AUDIO_DEFAULT_PITCH) / 48.0f);
+}
+
+void chirp_update_timers(Chirp* chirp, SDLWindow* window)
+{
+  if (chirp->config->has_audio)
   {
-    if (chirp->config->has_audio)
+    // the pattern only changes on F002 and FX3A, so only hand it over to the audio thread when it does
+    if (chirp->need_update_audio)
     {
-      sdl_window_stop_beep(window);
+      sdl_window_set_audio_pattern(window, chirp->has_audio_pattern ? chirp->audio_pattern : NULL,
+                                   chirp_audio_rate(chirp));
+      chirp->need_update_audio = false;
     }
+
+    sdl_window_set_beep(window, chirp->sound_timer > 0);
+  }
+
+  chirp_tick_timers(chirp);
+}
+
+// whether the window is out of date, including while the picture is still fading after the display last changed
+bool chirp_needs_draw(const Chirp* chirp, const SDLWindow* window)
+{
+  return chirp->need_draw_screen || sdl_window_is_fading(window)
+         || (chirp->deflicker != NULL && chirp->deflicker->changed_rows != 0);
+}
+
+void chirp_draw_screen(Chirp* chirp, SDLWindow* window)
+{
+  if (chirp->deflicker != NULL)
+  {
+    sdl_window_draw_levels(window, chirp->deflicker);
+  }
+  else
+  {
+    sdl_window_draw_display(window, chirp->display);
   }
 }
 
+// the config is owned by the caller since it can be shared between clones
 void chirp_free(Chirp* chirp)
 {
-  free(chirp->mem);
+  chirp_mem_free(chirp->mem);
   free(chirp->registers);
   free(chirp->stack);
   free(chirp->display);
-  free(chirp->config);
+  free(chirp->keyboard);
+  if (chirp->deflicker != NULL)
+  {
+    chirp_deflicker_free(chirp->deflicker);
+  }
+  chirp_boot_release(chirp->boot);
+  free(chirp->decode_cache);
   free(chirp);
 }
 
+void chirp_halt(Chirp* chirp, const ChirpFault fault, const uint16_t address, const uint16_t instruction)
+{
+  chirp->fault = fault;
+  chirp->fault_address = address;
+  chirp->fault_instruction = instruction;
+}
+
+// halts the machine on the instruction that was just fetched
+void chirp_raise_fault(Chirp* chirp, const ChirpFault fault, const uint16_t instruction)
+{
+  chirp_halt(chirp, fault, chirp->program_counter - 2, instruction);
+}
+
+// lets a machine halted at a breakpoint carry on from there once the host has dealt with it
+void chirp_resume_from_trap(Chirp* chirp)
+{
+  if (chirp->fault != CHIRP_FAULT_TRAP)
+  {
+    return;
+  }
+
+  chirp->program_counter = chirp->fault_address;
+  chirp_halt(chirp, CHIRP_FAULT_NONE, 0, 0);
+}
+
+// every fault besides an infinite loop means the ROM did something it should not have
+bool chirp_fault_is_error(const ChirpFault fault)
+{
+  return fault != CHIRP_FAULT_NONE && fault != CHIRP_FAULT_INFINITE_LOOP;
+}
+
+const char* chirp_fault_name(const ChirpFault fault)
+{
+  switch (fault)
+  {
+  case CHIRP_FAULT_NONE:
+    return "none";
+  case CHIRP_FAULT_INVALID_INSTRUCTION:
+    return "invalid instruction";
+  case CHIRP_FAULT_STACK_OVERFLOW:
+    return "stack overflow";
+  case CHIRP_FAULT_STACK_UNDERFLOW:
+    return "stack underflow";
+  case CHIRP_FAULT_PC_OUT_OF_RANGE:
+    return "program counter out of range";
+  case CHIRP_FAULT_INFINITE_LOOP:
+    return "infinite loop";
+  case CHIRP_FAULT_TRAP:
+    return "trap";
+  default:
+    return "unknown fault";
+  }
+}
+
+const char* chirp_engine_name(const ChirpEngine engine)
+{
+  switch (engine)
+  {
+  case CHIRP_ENGINE_REFERENCE:
+    return "reference";
+  case CHIRP_ENGINE_CACHED:
+    return "cached";
+  case CHIRP_ENGINE_AOT:
+    return "aot";
+  default:
+    return "unknown engine";
+  }
+}
+
 uint16_t chirp_fetch(Chirp* chirp)
 {
-  const uint8_t first_block = chirp_mem_read(chirp->mem, chirp->program_counter++);
-  const uint8_t second_block = chirp_mem_read(chirp->mem, chirp->program_counter++);
+#ifdef CHIRP_COVERAGE
+  const uint16_t addr = chirp->program_counter & 0x0FFF;
+  chirp->coverage[addr >> 3] |= (uint8_t)(1 << (addr & 7));
+#endif
 
-  // create the instruction using bit shifting
-  const uint16_t instruction = ((uint16_t)first_block << 8) | second_block;
+  // executed code goes behind the write barrier before anything can be derived from it; once it is, that costs a test
+  const uint16_t pc = chirp->program_counter;
+  if (!chirp_mem_is_code(chirp->mem, pc) || !chirp_mem_is_code(chirp->mem, pc + 1))
+  {
+    chirp_mem_mark_code(chirp->mem, pc, 2);
+  }
+  const uint16_t instruction = chirp_mem_fetch(chirp->mem, pc);
+  chirp->program_counter += 2;
 
   return instruction;
 }
 
-void chirp_execute(Chirp* chirp, const uint16_t instruction)
+// executes an instruction that has already been decoded, see decode.c
+void chirp_execute_op(Chirp* chirp, const ChirpDecoded* decoded)
 {
-  const uint16_t opcode = instruction & 0xF000;
-  const uint8_t x = (instruction & 0x0F00) >> 8;
-  const uint8_t y = (instruction & 0x00F0) >> 4;
-  const uint8_t n = instruction & 0x000F;
-  const uint8_t nn = instruction & 0x00FF;
-  const uint16_t nnn = instruction & 0x0FFF;
+  const ChirpOp op = decoded->op;
+  const uint16_t instruction = decoded->instruction;
+  const uint8_t x = decoded->x;
+  const uint8_t y = decoded->y;
+  const uint8_t n = decoded->n;
+  const uint8_t nn = decoded->nn;
+  const uint16_t nnn = decoded->nnn;
 
-  if (chirp->config->is_debug)
+  if (CHIRP_LOG_IS_ON(chirp, CHIRP_LOG_TRACE))
   {
     if (chirp_stack_is_empty(chirp->stack))
     {
@@ -147,215 +603,387 @@ void chirp_execute(Chirp* chirp, const uint16_t instruction)
     }
     else
     {
+      uint16_t top = 0;
+      chirp_stack_peek(chirp->stack, &top);
       SDL_Log(
         "executing instruction %04X with PC = %04X and top of stack as %04X\n",
         instruction,
         chirp->program_counter,
-        chirp_stack_peek(chirp->stack));
+        top);
     }
   }
 
-  switch (opcode)
+  switch (op)
   {
-  case 0x0000:
-    switch (nnn)
-    {
-    case 0x00E0:
-      // clear screen
-      clear_display(chirp);
-      return;
-    case 0x00EE:
-      // return from subroutine
-      subroutine_return(chirp);
-      return;
-    default:
-      fprintf(stderr, "invalid instruction %04X\n", instruction);
-      exit(1);
-    }
+  case CHIRP_OP_CLS:
+    clear_display(chirp);
+    return;
+  case CHIRP_OP_RET:
+    subroutine_return(chirp);
+    return;
 
-  case 0x1000:
+  case CHIRP_OP_JP:
     jump(chirp, nnn);
     return;
-
-  case 0x2000:
+  case CHIRP_OP_CALL:
     subroutine_call(chirp, nnn);
     return;
+  case CHIRP_OP_JP_V0:
+    if (chirp->config->jump_with_vx)
+    {
+      jump_with_offset_nnn_vx(chirp, x, nnn);
+    }
+    else
+    {
+      jump_with_offset_nnn(chirp, nnn);
+    }
+    return;
 
-  case 0x3000:
+  case CHIRP_OP_SE_VX_NN:
     skip_if_vx_eq_nn(chirp, x, nn);
     return;
-
-  case 0x4000:
+  case CHIRP_OP_SNE_VX_NN:
     skip_if_vx_neq_nn(chirp, x, nn);
     return;
-
-  case 0x5000:
-    if (n != 0x0)
-    {
-      SDL_LogError(SDL_LOG_CATEGORY_ERROR, "invalid instruction %04X\n", instruction);
-      exit(1);
-    }
+  case CHIRP_OP_SE_VX_VY:
     skip_if_vx_eq_vy(chirp, x, y);
     return;
+  case CHIRP_OP_SNE_VX_VY:
+    skip_if_vx_neq_vy(chirp, x, y);
+    return;
+  case CHIRP_OP_SKP:
+    skip_if_key_vx_pressed(chirp, x);
+    return;
+  case CHIRP_OP_SKNP:
+    skip_if_key_vx_not_pressed(chirp, x);
+    return;
 
-  case 0x6000:
+  case CHIRP_OP_LD_VX_NN:
     set_vx_eq_nn(chirp, x, nn);
     return;
-
-  case 0x7000:
+  case CHIRP_OP_ADD_VX_NN:
     set_vx_eq_vx_plus_nn(chirp, x, nn);
     return;
-
-  case 0x8000:
-    switch (n)
+  case CHIRP_OP_LD_VX_VY:
+    set_vx_eq_vy(chirp, x, y);
+    return;
+  case CHIRP_OP_OR:
+    set_vx_eq_vx_or_vy(chirp, x, y);
+    return;
+  case CHIRP_OP_AND:
+    set_vx_eq_vx_and_vy(chirp, x, y);
+    return;
+  case CHIRP_OP_XOR:
+    set_vx_eq_vx_xor_vy(chirp, x, y);
+    return;
+  case CHIRP_OP_ADD_VX_VY:
+    set_vx_eq_vx_plus_vy(chirp, x, y);
+    return;
+  case CHIRP_OP_SUB:
+    set_vx_eq_vx_minus_vy(chirp, x, y);
+    return;
+  case CHIRP_OP_SHR:
+    if (chirp->config->shift_vx)
     {
-    case 0x0:
-      set_vx_eq_vy(chirp, x, y);
-      return;
-    case 0x1:
-      set_vx_eq_vx_or_vy(chirp, x, y);
-      return;
-    case 0x2:
-      set_vx_eq_vx_and_vy(chirp, x, y);
-      return;
-    case 0x3:
-      set_vx_eq_vx_xor_vy(chirp, x, y);
-      return;
-    case 0x4:
-      set_vx_eq_vx_plus_vy(chirp, x, y);
-      return;
-    case 0x5:
-      set_vx_eq_vx_minus_vy(chirp, x, y);
-      return;
-    case 0x6:
-      if (chirp->config->shift_vx)
-      {
-        set_vx_eq_vx_shift_right(chirp, x);
-      }
-      else
-      {
-        set_vx_eq_vy_shift_right(chirp, x, y);
-      }
-      return;
-    case 0x7:
-      set_vx_eq_vy_minus_vx(chirp, x, y);
-      return;
-    case 0xE:
-      if (chirp->config->shift_vx)
-      {
-        set_vx_eq_vx_shift_left(chirp, x);
-      }
-      else
-      {
-        set_vx_eq_vy_shift_left(chirp, x, y);
-      }
-      return;
-    default:
-      fprintf(stderr, "invalid instruction %04X\n", instruction);
-      exit(1);
+      set_vx_eq_vx_shift_right(chirp, x);
     }
-
-  case 0x9000:
-    if (n != 0x0)
+    else
     {
-      SDL_LogError(SDL_LOG_CATEGORY_ERROR, "invalid instruction %04X\n", instruction);
-      exit(1);
+      set_vx_eq_vy_shift_right(chirp, x, y);
     }
-    skip_if_vx_neq_vy(chirp, x, y);
     return;
-
-  case 0xA000:
-    set_index_eq_nnn(chirp, nnn);
+  case CHIRP_OP_SUBN:
+    set_vx_eq_vy_minus_vx(chirp, x, y);
     return;
-
-  case 0xB000:
-    if (chirp->config->jump_with_vx)
+  case CHIRP_OP_SHL:
+    if (chirp->config->shift_vx)
     {
-      jump_with_offset_nnn_vx(chirp, x, nnn);
+      set_vx_eq_vx_shift_left(chirp, x);
     }
     else
     {
-      jump_with_offset_nnn(chirp, nnn);
+      set_vx_eq_vy_shift_left(chirp, x, y);
     }
     return;
-
-  case 0xC000:
+  case CHIRP_OP_RND:
     set_vx_eq_random(chirp, x, nn);
     return;
+  case CHIRP_OP_LD_VX_DT:
+    set_vx_eq_delay(chirp, x);
+    return;
+  case CHIRP_OP_LD_VX_K:
+    get_key(chirp, x);
+    return;
 
-  case 0xD000:
+  case CHIRP_OP_LD_I:
+    set_index_eq_nnn(chirp, nnn);
+    return;
+  case CHIRP_OP_ADD_I_VX:
+    set_index_eq_index_plus_vx(chirp, x);
+    return;
+  case CHIRP_OP_LD_F_VX:
+    set_index_eq_font(chirp, x);
+    return;
+
+  case CHIRP_OP_DRW:
     draw(chirp, x, y, n);
     return;
 
-  case 0xE000:
-    switch (nn)
+  case CHIRP_OP_LD_DT_VX:
+    set_delay_eq_vx(chirp, x);
+    return;
+  case CHIRP_OP_LD_ST_VX:
+    set_sound_eq_vx(chirp, x);
+    return;
+
+  case CHIRP_OP_LD_B_VX:
+    binary_coded_decimal_conversion(chirp, x);
+    return;
+  case CHIRP_OP_STORE:
+    if (chirp->config->set_registers_increment_index)
     {
-    case 0x9E:
-      skip_if_key_vx_pressed(chirp, x);
-      return;
-    case 0xA1:
-      skip_if_key_vx_not_pressed(chirp, x);
-      return;
-    default:
-      fprintf(stderr, "invalid instruction %04X\n", instruction);
-      exit(1);
+      set_registers_inc(chirp, x);
+    }
+    else
+    {
+      set_registers(chirp, x);
+    }
+    return;
+  case CHIRP_OP_LOAD:
+    if (chirp->config->load_registers_increment_index)
+    {
+      load_registers_inc(chirp, x);
+    }
+    else
+    {
+      load_registers(chirp, x);
     }
+    return;
 
-  case 0xF000:
-    switch (nn)
+  case CHIRP_OP_AUDIO:
+    if (!chirp->config->xo_chip)
     {
-    case 0x07:
-      set_vx_eq_delay(chirp, x);
-      return;
-    case 0x15:
-      set_delay_eq_vx(chirp, x);
-      return;
-    case 0x18:
-      set_sound_eq_vx(chirp, x);
-      return;
-    case 0x1E:
-      set_index_eq_index_plus_vx(chirp, x);
+      chirp_raise_fault(chirp, CHIRP_FAULT_INVALID_INSTRUCTION, instruction);
       return;
-    case 0x0A:
-      get_key(chirp, x);
-      return;
-    case 0x29:
-      set_index_eq_font(chirp, x);
-      return;
-    case 0x33:
-      binary_coded_decimal_conversion(chirp, x);
-      return;
-    case 0x55:
-      if (chirp->config->set_registers_increment_index)
-      {
-        set_registers_inc(chirp, x);
-      }
-      else
-      {
-        set_registers(chirp, x);
-      }
-      return;
-    case 0x65:
-      if (chirp->config->load_registers_increment_index)
-      {
-        load_registers_inc(chirp, x);
-      }
-      else
-      {
-        load_registers(chirp, x);
-      }
+    }
+    load_audio_pattern(chirp);
+    return;
+  case CHIRP_OP_PITCH:
+    if (!chirp->config->xo_chip)
+    {
+      chirp_raise_fault(chirp, CHIRP_FAULT_INVALID_INSTRUCTION, instruction);
       return;
-    default:
-      fprintf(stderr, "invalid instruction %04X\n", instruction);
-      exit(1);
     }
+    set_pitch_eq_vx(chirp, x);
+    return;
+
   default:
-    fprintf(stderr, "invalid instruction %04X\n", instruction);
-    exit(1);
+    chirp_raise_fault(chirp, CHIRP_FAULT_INVALID_INSTRUCTION, instruction);
+    return;
+  }
+}
+
+void chirp_execute(Chirp* chirp, const uint16_t instruction)
+{
+  const ChirpDecoded decoded = chirp_decode(instruction);
+  chirp_execute_op(chirp, &decoded);
+}
+
+// cycles spent on an instruction that has just been executed
+uint32_t chirp_instruction_cost(const Chirp* chirp, const uint16_t instruction, const bool has_skipped)
+{
+  if (!chirp->config->vip_timing)
+  {
+    return 1;
+  }
+
+  return chirp_timing_cost(instruction, has_skipped);
+}
+
+// decodes every instruction the analysis found reachable ahead of time, so the first pass through a ROM never has to
+// decode anything. Bytes it found to be data are left alone, and so is code the ROM writes over, which would only be
+// decoded again once it runs as something else
+void chirp_apply_analysis(Chirp* chirp, const ChirpAnalysis* analysis)
+{
+  for (int address = 0; address < CHIRP_MEMORY_SIZE; address++)
+  {
+    const uint8_t flags = analysis->flags[address];
+    const uint8_t second_flags = analysis->flags[(address + 1) & 0x0FFF];
+    if ((flags & CHIRP_BYTE_CODE) != 0 && ((flags | second_flags) & CHIRP_BYTE_WRITTEN) == 0)
+    {
+      chirp_decode_cache_seed(chirp->decode_cache, address, chirp_decode_at(chirp->boot->mem->mem, address));
+    }
+  }
+}
+
+// fetches and executes the instruction at the program counter, accounting for the time it takes
+void chirp_execute_next(Chirp* chirp)
+{
+  const uint16_t pc = chirp->program_counter;
+  const uint16_t instruction = chirp_fetch(chirp);
+  if (chirp->engine == CHIRP_ENGINE_REFERENCE)
+  {
+    chirp_execute(chirp, instruction);
+  }
+  else
+  {
+    chirp_execute_op(chirp, chirp_decode_cache_lookup(chirp->decode_cache, pc, instruction));
   }
+
+  chirp->instruction_count++;
+  chirp->cycle_count += chirp_instruction_cost(chirp, instruction, chirp->program_counter == pc + 4);
+}
+
+// emulated time, including the time skipped while idle that has not been caught up on yet
+uint64_t chirp_cycles(const Chirp* chirp)
+{
+  return chirp->cycle_count + chirp->loop.skipped;
 }
 
-void chirp_start_emulator_loop(Chirp* chirp, SDLWindow* window)
+// executes a single instruction unless the machine has already halted; returns the fault state afterwards
+ChirpFault chirp_step(Chirp* chirp)
+{
+  if (chirp->fault != CHIRP_FAULT_NONE)
+  {
+    return chirp->fault;
+  }
+
+  // an idle machine is spinning in a loop that cannot change anything, so only count the time
+  if (chirp->idle_wake != 0)
+  {
+    chirp->loop.skipped++;
+    return chirp->fault;
+  }
+
+  // instructions are two bytes, so the last one starts right before the end of memory
+  const uint16_t pc = chirp->program_counter;
+  if (pc < CHIRP_INSTRUCTIONS_ADDR_START || pc >= CHIRP_INSTRUCTIONS_ADDR_END)
+  {
+    chirp_halt(chirp, CHIRP_FAULT_PC_OUT_OF_RANGE, pc, 0);
+    return chirp->fault;
+  }
+
+  // a loop with a breakpoint in it is never passed through unseen, so it is not left to be parked as idle either
+  if (chirp->breakpoints != NULL && (chirp->breakpoints[pc >> 6] >> (pc & 63) & 1) != 0)
+  {
+    chirp_idle_clear(chirp);
+    chirp_halt(chirp, CHIRP_FAULT_TRAP, pc, chirp_mem_fetch(chirp->mem, pc));
+    return chirp->fault;
+  }
+
+  // a hook that moves the PC skips the instruction, which the next step then hooks and runs from the new address
+  if (chirp->plugins != NULL && chirp_plugins_is_pc_hooked(chirp->plugins, pc))
+  {
+    chirp_plugins_reach(chirp->plugins, pc);
+    if (chirp->program_counter != pc || chirp->fault != CHIRP_FAULT_NONE)
+    {
+      return chirp->fault;
+    }
+  }
+
+  chirp_execute_next(chirp);
+
+  return chirp->fault;
+}
+
+// runs for the given number of cycles (instructions, unless vip_timing is on), stopping early if the machine halts
+ChirpFault chirp_run(Chirp* chirp, const uint64_t cycles)
+{
+  const uint64_t end = chirp_cycles(chirp) + cycles;
+
+  while (chirp_cycles(chirp) < end)
+  {
+    if (chirp->idle_wake != 0)
+    {
+      // the rest of the budget would only spin through the idle loop, so skip all of it at once
+      chirp->loop.skipped += end - chirp_cycles(chirp);
+      break;
+    }
+
+    // translated code runs as far as it can in one go, leaving whatever it has no translation for to chirp_step;
+    // it never looks at the PC hooks or the breakpoints, so with any of them everything is interpreted
+    if (chirp_aot_covers(chirp) && chirp->fault == CHIRP_FAULT_NONE && !CHIRP_LOG_IS_ON(chirp, CHIRP_LOG_TRACE)
+      && (chirp->plugins == NULL || chirp->plugins->pc_hook_count == 0) && chirp->breakpoints == NULL
+      && chirp->aot->run(chirp, end))
+    {
+      continue;
+    }
+
+    if (chirp_step(chirp) != CHIRP_FAULT_NONE)
+    {
+      break;
+    }
+  }
+
+  return chirp->fault;
+}
+
+// runs the rest of the current 60Hz frame worth of cycles, without ticking the timers
+ChirpFault chirp_run_to_frame_end(Chirp* chirp)
+{
+  const uint64_t frame = chirp->frame_count;
+  uint64_t frame_end;
+
+  if (chirp->config->vip_timing)
+  {
+    frame_end = (frame + 1) * CHIRP_VIP_CYCLES_PER_FRAME;
+  }
+  else
+  {
+    // spread the remainder over the frames so that cpu_speed instructions run every 60 frames
+    const uint64_t cpu_speed = (uint64_t)chirp->config->cpu_speed;
+    frame_end = chirp_cycles(chirp) + (frame + 1) * cpu_speed / 60 - frame * cpu_speed / 60;
+  }
+
+  // the last instruction of the previous frame may have run past this frame's end already
+  const uint64_t now = chirp_cycles(chirp);
+  if (now < frame_end)
+  {
+    chirp_run(chirp, frame_end - now);
+  }
+
+  return chirp->fault;
+}
+
+// cycle at which the current frame ends when every frame has run its full share of cycles since the reset, for hosts
+// that drive the machine one step at a time and tick the timers themselves
+uint64_t chirp_frame_end(const Chirp* chirp)
+{
+  const uint64_t frame = chirp->frame_count;
+
+  if (chirp->config->vip_timing)
+  {
+    return (frame + 1) * CHIRP_VIP_CYCLES_PER_FRAME;
+  }
+
+  return (frame + 1) * (uint64_t)chirp->config->cpu_speed / 60;
+}
+
+// runs one 60Hz frame worth of cycles, then ticks the timers
+ChirpFault chirp_run_frame(Chirp* chirp)
+{
+  chirp_run_to_frame_end(chirp);
+  chirp_tick_timers(chirp);
+
+  return chirp->fault;
+}
+
+/**
+ * Copies the machine into ahead and runs the copy the given number of frames further on the keys held right now, so
+ * that what is shown already reflects input the machine itself will only react to frames from now. The machine is
+ * left untouched, so the next frame runs from the real state again.
+ */
+void chirp_run_ahead(const Chirp* chirp, Chirp* ahead, const int frames)
+{
+  chirp_copy(ahead, chirp);
+  for (int i = 0; i < frames && ahead->fault == CHIRP_FAULT_NONE; i++)
+  {
+    chirp_run_frame(ahead);
+  }
+}
+
+// gdb is NULL unless a GDB stub is listening
+void chirp_start_emulator_loop(Chirp* chirp, SDLWindow* window, ChirpGdbStub* gdb)
 {
   const double timer_tick_interval = 1.0 / 60.0;
   const double cpu_tick_interval = 1.0 / ((float)chirp->config->cpu_speed);
@@ -368,13 +996,23 @@ void chirp_start_emulator_loop(Chirp* chirp, SDLWindow* window)
   SDL_Event e;
   SDL_zero(e);
 
+  // the keymap was checked when the arguments were parsed
+  ChirpKeymap keymap;
+  chirp_keymap_parse(&keymap, chirp->config->keymap != NULL ? chirp->config->keymap : CHIRP_KEYMAP_DEFAULT);
+
+  // breakpoints would fire in the frames run ahead, so a GDB client always sees the real machine
+  Chirp* ahead = chirp->config->run_ahead > 0 && gdb == NULL ? chirp_clone(chirp) : NULL;
+
   while (chirp->is_running)
   {
     const uint64_t now = SDL_GetPerformanceCounter();
     const double dt = (double)(now - last_time) / (double)freq;
 
     timer_accumulator += dt;
-    cpu_accumulator += dt;
+    if (!chirp->config->vip_timing)
+    {
+      cpu_accumulator += dt;
+    }
 
     bool is_quitting = false;
 
@@ -396,26 +1034,28 @@ void chirp_start_emulator_loop(Chirp* chirp, SDLWindow* window)
         case SDLK_SPACE:
           chirp->is_paused = !chirp->is_paused;
           break;
+        case SDLK_F1:
+          window->is_overlay_visible = !window->is_overlay_visible;
+          chirp->need_draw_screen = true;
+          break;
+#ifdef CHIRP_INSTRUMENT
+        case SDLK_F2:
+          window->is_heatmap_visible = !window->is_heatmap_visible;
+          chirp->need_draw_screen = true;
+          break;
+#endif
         default:
           break;
         }
 
-        for (int i = 0; i < CHIRP_KEYBOARD_SIZE; i++)
-        {
-          if (e.key.key == KEYMAP[i])
-          {
-            chirp_keyboard_write(chirp->keyboard, i, true);
-          }
-        }
+        chirp_set_key(chirp, chirp_keymap_lookup(&keymap, e.key.scancode), true);
         break;
       case SDL_EVENT_KEY_UP:
-        for (int i = 0; i < CHIRP_KEYBOARD_SIZE; i++)
-        {
-          if (e.key.key == KEYMAP[i])
-          {
-            chirp_keyboard_write(chirp->keyboard, i, false);
-          }
-        }
+        chirp_set_key(chirp, chirp_keymap_lookup(&keymap, e.key.scancode), false);
+        break;
+      case SDL_EVENT_WINDOW_PIXEL_SIZE_CHANGED:
+      case SDL_EVENT_WINDOW_EXPOSED:
+        chirp->need_draw_screen = true;
         break;
       default:
         break;
@@ -427,35 +1067,124 @@ void chirp_start_emulator_loop(Chirp* chirp, SDLWindow* window)
 
     if (chirp->is_paused || is_quitting)
     {
+      if (window->metrics != NULL)
+      {
+        chirp_metrics_pause(window->metrics);
+      }
       continue;
     }
 
+    if (gdb != NULL)
+    {
+      chirp_gdb_poll(gdb);
+
+      // no time passes for the ROM while the client looks at it, and the loop only wakes up for the client or input
+      if (chirp_gdb_is_stopped(gdb))
+      {
+        cpu_accumulator = 0.0;
+        timer_accumulator = 0.0;
+        if (window->metrics != NULL)
+        {
+          chirp_metrics_pause(window->metrics);
+        }
+        chirp_gdb_wait(gdb, 10);
+        continue;
+      }
+    }
+
     // interleaving the updates to avoid cpu hogging
     while (cpu_accumulator >= cpu_tick_interval || timer_accumulator >= timer_tick_interval)
     {
       if (cpu_accumulator >= cpu_tick_interval)
       {
-        // fetch instruction
-        const uint16_t instruction = chirp_fetch(chirp);
-
-        // execute instruction
-        chirp_execute(chirp, instruction);
+        // fetch and execute instruction
+        chirp_step(chirp);
         cpu_accumulator -= cpu_tick_interval;
+
+        // a breakpoint has to be reported with the machine exactly as it stopped
+        if (chirp->fault == CHIRP_FAULT_TRAP)
+        {
+          break;
+        }
       }
 
       if (timer_accumulator >= timer_tick_interval)
       {
+        // with the timing model, emulated time follows the cycle counter and the wall clock only paces frames
+        if (chirp->config->vip_timing && chirp_run_to_frame_end(chirp) == CHIRP_FAULT_TRAP)
+        {
+          break;
+        }
+
         // update timers
         chirp_update_timers(chirp, window);
         timer_accumulator -= timer_tick_interval;
 
-        // render screen at 60Hz
-        if (chirp->need_draw_screen)
+        // the overlay is redrawn whenever its numbers change, even if the display has not; only the last of the
+        // frames run in one go is timed, since the ones before it are catching up and follow each other at once
+        if (window->metrics != NULL && timer_accumulator >= timer_tick_interval)
+        {
+          chirp_metrics_record_catchup(window->metrics);
+        }
+        else if (window->metrics != NULL)
         {
-          sdl_window_draw_display(window, chirp->display);
+          chirp_metrics_record_frame(window->metrics, chirp->instruction_count);
+          if (chirp_metrics_report(window->metrics) && window->is_overlay_visible)
+          {
+            chirp->need_draw_screen = true;
+          }
+        }
+
+#ifdef CHIRP_INSTRUMENT
+        // the accesses counted are the real machine's, never those of the frames run ahead, which are thrown away
+        sdl_window_update_heatmap(window, chirp->mem->heat);
+        if (window->is_heatmap_visible)
+        {
+          chirp->need_draw_screen = true;
+        }
+#endif
+
+        // render screen at 60Hz, from the future when running ahead, and on every frame while it fades; frames that
+        // are only catching up on lost time are never shown, so they are not run ahead either
+        if (ahead != NULL && timer_accumulator < timer_tick_interval)
+        {
+          chirp_run_ahead(chirp, ahead, chirp->config->run_ahead);
+          if (chirp->need_draw_screen || chirp_needs_draw(ahead, window))
+          {
+            chirp_draw_screen(ahead, window);
+            chirp->need_draw_screen = false;
+          }
+        }
+        else if (ahead == NULL && chirp_needs_draw(chirp, window))
+        {
+          chirp_draw_screen(chirp, window);
           chirp->need_draw_screen = false;
         }
       }
     }
+
+    // a halted ROM stays on screen, unless it halted because of an error and there is no debugger to report it to
+    if (chirp_fault_is_error(chirp->fault) && gdb == NULL)
+    {
+      chirp->is_running = false;
+    }
+    else if (chirp->fault != CHIRP_FAULT_NONE || chirp_is_idle(chirp))
+    {
+      // nothing can happen before the next timer tick or input event, so sleep until then
+      const int wait_ms = (int)((timer_tick_interval - timer_accumulator) * 1000.0);
+      if (wait_ms > 0 && gdb != NULL)
+      {
+        chirp_gdb_wait(gdb, wait_ms);
+      }
+      else if (wait_ms > 0)
+      {
+        SDL_WaitEventTimeout(NULL, wait_ms);
+      }
+    }
+  }
+
+  if (ahead != NULL)
+  {
+    chirp_free(ahead);
   }
 }
@@ -4,7 +4,45 @@
 #include "chirp_t.h"
 
 Chirp* chirp_new(ChirpConfig* config);
+Chirp* chirp_new_from_rom(ChirpConfig* config, const uint8_t* rom, size_t rom_size);
+bool chirp_load_rom_image(Chirp* chirp, const uint8_t* rom, size_t rom_size);
+Chirp* chirp_clone(const Chirp* chirp);
+void chirp_copy(Chirp* dst, const Chirp* src);
+void chirp_reset(Chirp* chirp);
 void chirp_free(Chirp* chirp);
-void chirp_start_emulator_loop(Chirp* chirp, SDLWindow* window);
+typedef struct ChirpAnalysis ChirpAnalysis; // see analysis.h
+void chirp_apply_analysis(Chirp* chirp, const ChirpAnalysis* analysis);
+typedef struct ChirpGdbStub ChirpGdbStub; // see gdbstub.h
+
+void chirp_start_emulator_loop(Chirp* chirp, SDLWindow* window, ChirpGdbStub* gdb);
+
+// headless execution; each returns the fault state of the instance, CHIRP_FAULT_NONE while it can keep running
+ChirpFault chirp_step(Chirp* chirp);
+ChirpFault chirp_run(Chirp* chirp, uint64_t cycles);
+ChirpFault chirp_run_to_frame_end(Chirp* chirp);
+ChirpFault chirp_run_frame(Chirp* chirp);
+uint64_t chirp_frame_end(const Chirp* chirp);
+
+uint16_t chirp_fetch(Chirp* chirp);
+void chirp_execute(Chirp* chirp, uint16_t instruction);
+void chirp_execute_op(Chirp* chirp, const ChirpDecoded* decoded);
+void chirp_execute_next(Chirp* chirp);
+uint32_t chirp_instruction_cost(const Chirp* chirp, uint16_t instruction, bool has_skipped);
+uint64_t chirp_cycles(const Chirp* chirp);
+uint8_t chirp_random(Chirp* chirp);
+void chirp_tick_timers(Chirp* chirp);
+void chirp_set_key(Chirp* chirp, int key, bool is_pressed);
+bool chirp_is_idle(const Chirp* chirp);
+float chirp_audio_rate(const Chirp* chirp);
+void chirp_update_timers(Chirp* chirp, SDLWindow* window);
+bool chirp_needs_draw(const Chirp* chirp, const SDLWindow* window);
+void chirp_draw_screen(Chirp* chirp, SDLWindow* window);
+
+void chirp_halt(Chirp* chirp, ChirpFault fault, uint16_t address, uint16_t instruction);
+void chirp_resume_from_trap(Chirp* chirp);
+void chirp_raise_fault(Chirp* chirp, ChirpFault fault, uint16_t instruction);
+bool chirp_fault_is_error(ChirpFault fault);
+const char* chirp_fault_name(ChirpFault fault);
+const char* chirp_engine_name(ChirpEngine engine);
 
 #endif // CHIRP_H
@@ -0,0 +1,62 @@
+#ifndef CHIRP_PLUGIN_ABI_H
+#define CHIRP_PLUGIN_ABI_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// the interface plugins are built against, and all they need to include: a plugin is a shared library loaded with
+// --plugin=PATH[,ARGS] that exports CHIRP_PLUGIN_INIT, which registers hooks and keeps the API it is handed to call
+// back into the emulator from them. See plugins/ for examples; make plugins builds them.
+//
+// Hooks run on the emulator's thread, in the middle of emulation, and whatever they change the ROM sees from its next
+// instruction on. PC hooks only cost anything at the addresses they are on; frames run ahead are never hooked, and a
+// machine parked on an idle loop is only hooked on frame ends until it wakes up.
+
+#define CHIRP_PLUGIN_ABI_VERSION 1
+#define CHIRP_PLUGIN_INIT "chirp_plugin_init" // ChirpPluginInit, required
+#define CHIRP_PLUGIN_EXIT "chirp_plugin_exit" // ChirpPluginExit, optional
+
+typedef struct ChirpPluginHost ChirpPluginHost; // the emulator's side, passed back to every call
+
+// after the 60Hz tick, with frame the number of ticks so far
+typedef void (*ChirpPluginFrameHook)(ChirpPluginHost* host, void* user, uint64_t frame);
+// before the instruction at address runs; moving the PC skips it
+typedef void (*ChirpPluginPcHook)(ChirpPluginHost* host, void* user, uint16_t address);
+// after the ROM, or a plugin, stored value at address
+typedef void (*ChirpPluginWriteHook)(ChirpPluginHost* host, void* user, uint16_t address, uint8_t value);
+
+// only ever grows at the end, so that a plugin can check size for what it needs
+typedef struct ChirpPluginApi
+{
+  int abi_version; // CHIRP_PLUGIN_ABI_VERSION of the emulator
+  int size;        // sizeof(ChirpPluginApi) of the emulator
+  ChirpPluginHost* host;
+
+  // false once there are too many hooks of the kind, or for an address outside of memory
+  bool (*on_frame)(ChirpPluginHost* host, ChirpPluginFrameHook hook, void* user);
+  bool (*on_pc)(ChirpPluginHost* host, uint16_t address, ChirpPluginPcHook hook, void* user);
+  bool (*on_write)(ChirpPluginHost* host, uint16_t start, uint16_t end, ChirpPluginWriteHook hook, void* user);
+
+  uint8_t (*read_register)(ChirpPluginHost* host, int index); // V0 to VF
+  void (*write_register)(ChirpPluginHost* host, int index, uint8_t value);
+  uint16_t (*read_index)(ChirpPluginHost* host);
+  void (*write_index)(ChirpPluginHost* host, uint16_t value);
+  uint16_t (*read_pc)(ChirpPluginHost* host);
+  void (*write_pc)(ChirpPluginHost* host, uint16_t value);
+  uint8_t (*read_memory)(ChirpPluginHost* host, uint16_t address);
+  void (*write_memory)(ChirpPluginHost* host, uint16_t address, uint8_t value); // write hooks included
+  bool (*read_key)(ChirpPluginHost* host, int key);
+  void (*set_key)(ChirpPluginHost* host, int key, bool is_pressed);
+  bool (*read_pixel)(ChirpPluginHost* host, int x, int y);
+
+  uint64_t (*frame_count)(ChirpPluginHost* host);
+  uint64_t (*instruction_count)(ChirpPluginHost* host);
+  void (*stop)(ChirpPluginHost* host); // ends the run once the current frame is over
+} ChirpPluginApi;
+
+// args is what followed the first comma of --plugin, or an empty string; false fails the start of the emulator
+typedef bool (*ChirpPluginInit)(const ChirpPluginApi* api, const char* args);
+// right before the plugin is unloaded, with the machine as it was left
+typedef void (*ChirpPluginExit)(const ChirpPluginApi* api);
+
+#endif // CHIRP_PLUGIN_ABI_H
@@ -3,11 +3,15 @@
 
 // holds definitions that need to be shared to avoid cyclic dependencies
 
+#include "capture.h"
+#include "decode.h"
+#include "deflicker.h"
 #include "display.h"
 #include "memory.h"
 #include "stack.h"
 #include "registers.h"
 #include "keyboard.h"
+#include "romdb.h"
 #include "window.h"
 
 // list taken from https://tobiasvl.github.io/blog/write-a-chip-8-emulator/#font
@@ -30,25 +34,69 @@ const static uint8_t CHIRP_FONTS[CHIRP_FONTS_BYTES] = {
   0xF0, 0x80, 0xF0, 0x80, 0x80  // F
 };
 
-// list taken from https://github.com/cookerlyk/Chip8/blob/master/src/chip8.h
-const static uint8_t KEYMAP[CHIRP_KEYBOARD_SIZE] = {
-  SDLK_X, // 0
-  SDLK_1, // 1
-  SDLK_2, // 2
-  SDLK_3, // 3
-  SDLK_Q, // 4
-  SDLK_W, // 5
-  SDLK_E, // 6
-  SDLK_A, // 7
-  SDLK_S, // 8
-  SDLK_D, // 9
-  SDLK_Z, // A
-  SDLK_C, // B
-  SDLK_4, // C
-  SDLK_R, // D
-  SDLK_F, // E
-  SDLK_V  // F
-};
+// faults halt the machine instead of exiting so that the host decides what to do with the instance
+typedef enum ChirpFault
+{
+  CHIRP_FAULT_NONE = 0,
+  CHIRP_FAULT_INVALID_INSTRUCTION,
+  CHIRP_FAULT_STACK_OVERFLOW,
+  CHIRP_FAULT_STACK_UNDERFLOW,
+  CHIRP_FAULT_PC_OUT_OF_RANGE,
+  CHIRP_FAULT_INFINITE_LOOP, // not an error: the ROM can never make progress again
+  CHIRP_FAULT_TRAP,          // reached one of the host's breakpoints, whose instruction has not run yet
+} ChirpFault;
+
+// ways of executing instructions, which must all agree with the reference, see diff.h
+typedef enum ChirpEngine
+{
+  CHIRP_ENGINE_REFERENCE, // decodes every instruction from scratch with chirp_execute
+  CHIRP_ENGINE_CACHED,    // looks the instructions up in the decode cache; the default
+  CHIRP_ENGINE_AOT,       // runs the attached ahead-of-time translation where it can, see aot.h
+} ChirpEngine;
+
+#ifdef CHIRP_COVERAGE
+#define CHIRP_COVERAGE_BYTES (CHIRP_MEMORY_SIZE / 8) // one bit for every address the PC has fetched from
+#endif
+
+// what a loop has done since its backward jump was last reached
+#define CHIRP_LOOP_SIDE_EFFECT 0x1 // touched state outside the registers (memory, display, timers, randomness)
+#define CHIRP_LOOP_READ_DELAY 0x2  // read the delay timer
+#define CHIRP_LOOP_READ_KEYS 0x4   // read the keyboard
+
+// external events that can bring an idle machine back to life
+#define CHIRP_WAKE_TIMER 0x1  // next tick that changes the delay timer
+#define CHIRP_WAKE_KEY 0x2    // next key change
+#define CHIRP_WAKE_VBLANK 0x4 // next tick, regardless of the timers
+
+// options set on the command line, which the ROM database leaves alone
+#define CHIRP_GIVEN_CPU_SPEED 0x1
+#define CHIRP_GIVEN_KEYMAP 0x2
+#define CHIRP_GIVEN_QUIRK(quirk) ((quirk) << 2) // one of the CHIRP_QUIRK_* flags in romdb.h
+
+#define CHIRP_PLUGIN_MAX 8 // plugins loaded at once, see plugin.h
+
+#define CHIRP_RANDOM_SEED 0x2545F491 // any non-zero value works; fixed so that every run of a ROM is reproducible
+
+// XO-CHIP audio, see https://johnearnest.github.io/Octo/docs/XO-ChipSpecification.html#audio
+#define CHIRP_AUDIO_PATTERN_BYTES 16 // 128 1-bit samples
+#define CHIRP_AUDIO_DEFAULT_PITCH 64 // plays the pattern at 4000 samples per second
+
+// state of the machine the last time a backward jump was reached, see idle.c
+typedef struct ChirpIdleLoop
+{
+  uint16_t jump_address; // address of the backward jump being watched; 0 when nothing is watched
+  uint8_t effects;       // CHIRP_LOOP_* flags raised since the jump was last reached
+  uint64_t reached_at;   // cycle count when the jump was last reached
+  uint64_t reached_at_instruction;
+  uint64_t cycles;       // cycles in one pass through the loop once idle
+  uint64_t instructions; // instructions in one pass through the loop once idle
+  uint64_t skipped;      // cycles skipped while idle, caught up on before the next external event
+  uint8_t registers[CHIRP_REGISTERS_SIZE];
+  uint16_t index_register;
+  uint8_t delay_timer;
+  uint8_t stack_size;
+  uint16_t stack[CHIRP_STACK_SIZE];
+} ChirpIdleLoop;
 
 typedef struct ChirpConfig
 {
@@ -58,10 +106,46 @@ typedef struct ChirpConfig
   bool jump_with_vx;                   // affects BNNN; defaults to false
   bool set_registers_increment_index;  // affects FX55; defaults to false
   bool load_registers_increment_index; // affects FX65; defaults to false
+  bool detect_quirks;                  // replaces the four quirks above with the ones that run best; defaults to false
   bool has_audio;                      // defaults to false
+  bool vip_timing;                     // per-instruction COSMAC VIP cycle costs instead of cpu_speed; defaults to false
+  bool vblank_wait;                    // affects DXYN, which waits for the next 60Hz tick; defaults to false
+  bool xo_chip;                        // enables the XO-CHIP audio instructions F002 and FX3A; defaults to false
+  bool analyse;                        // pre-decodes the code found by static analysis of the ROM; defaults to false
+  bool is_headless;                    // runs without a window for a fixed number of frames; defaults to false
+  bool is_debugger;                    // drives the machine from the interactive debugger on stdin; defaults to false
+  const char* gdb_address;             // TCP port or Unix socket path for the GDB stub; defaults to NULL (no stub)
+  bool has_metrics;                    // collects runtime metrics, reported on stderr and at exit; defaults to false
+  const char* metrics_path;            // where the metrics are written as JSON at exit; defaults to NULL (stdout)
   int cpu_speed;                       // defaults to 500
+  int frames;                          // frames to run in headless mode; defaults to 600
+  const char* keymap;                  // host keys for 0-F, see CHIRP_KEYMAP_DEFAULT; defaults to that
+  int run_ahead;                       // frames emulated past the one shown, to hide input latency; defaults to 0
+  int diff_interval;                   // cycles between engine comparisons, 0 to run normally; defaults to 0
+  SDLScaling scaling;                  // how the display fits the window; defaults to SDL_SCALING_INTEGER
+  int persistence;                     // percent of a pixel's brightness left a frame after it goes dark; defaults to 0
+  bool has_scanlines;                  // darkens the bottom of every display row; defaults to false
+  int deflicker;                       // percent of its brightness a dark pixel keeps per tick, 0 for off; defaults to 0
+  const char* capture_path;            // .y4m or .gif every tick is recorded into; defaults to NULL (no capture)
+  int plugin_count;                    // PATH or PATH,ARGS of every --plugin in plugins, see plugin.h; defaults to 0
+  const char* plugins[CHIRP_PLUGIN_MAX];
+  const char* rom_db_path;             // ROM database index, see romdb.h; defaults to NULL (CHIRP_ROMDB_DEFAULT_PATH)
+  const ChirpRomDb* rom_db;            // looked up by chirp_new, owned by the host; defaults to NULL (no lookup)
+  const ChirpRomEntry* rom_entry;      // set by chirp_new when the database knows the ROM; defaults to NULL
+  uint8_t given;                       // CHIRP_GIVEN_* flags; defaults to 0
 } ChirpConfig;
 
+// the memory image right after the ROM and fonts are loaded, which never changes afterwards, so an instance shares it
+// with its clones and whatever it is copied into; only ever shared on one thread at a time
+typedef struct ChirpBootImage
+{
+  ChirpMemory* mem;
+  int refs; // instances using it, the last of which frees it
+} ChirpBootImage;
+
+typedef struct ChirpAotProgram ChirpAotProgram; // see aot.h
+typedef struct ChirpPluginHost ChirpPluginHost; // see plugin.h
+
 typedef struct Chirp
 {
   ChirpConfig* config;
@@ -71,16 +155,61 @@ typedef struct Chirp
   ChirpRegisters* registers;
   ChirpDisplay* display;
   ChirpKeyboard* keyboard;
+  ChirpDeflicker* deflicker; // display as shown with anti-flicker, updated on every tick; NULL unless configured
+
+  ChirpBootImage* boot; // restored by chirp_reset; NULL until a ROM is loaded
+
+  // every instance keeps its own, never copied or reset since entries check themselves against memory when used
+  ChirpDecodeCache* decode_cache;
+
+  // records every tick; owned by the host and never copied, so that clones running ahead are not recorded
+  ChirpCapture* capture;
+
+  // hooks of the plugins loaded with --plugin, NULL without any; never copied either, so clones never call into them
+  ChirpPluginHost* plugins;
+
+  // one bit per address chirp_step halts at with CHIRP_FAULT_TRAP before running it; owned by the host like the
+  // plugins, NULL without any
+  const uint64_t* breakpoints;
+
+  ChirpEngine engine;
+  const ChirpAotProgram* aot; // ahead-of-time translation of the ROM, used by CHIRP_ENGINE_AOT; NULL if none
+  bool is_aot_checked;        // all of the translation was compared with memory since code last changed; never copied
+  bool is_aot_intact;         // and it was all there
 
   uint16_t program_counter; // we can point to at most 4096 instructions (since the RAM is 4096)
   uint16_t index_register;  // 16 bits to point to location
   uint8_t delay_timer;      // 8 bits to hold values from 0 to 60
   uint8_t sound_timer;      // 8 bits to hold values from 0 to 60
+  uint32_t random_state;    // xorshift state behind CXNN, kept per instance so clones and replays stay deterministic
 
   // flags to indicate state for running the machine
   bool is_running;
   bool is_paused;
   bool need_draw_screen;
+
+  // XO-CHIP audio, only ever changed by F002 and FX3A
+  uint8_t audio_pattern[CHIRP_AUDIO_PATTERN_BYTES];
+  uint8_t audio_pitch;    // playback rate is 4000 * 2^((pitch - 64) / 48) samples per second
+  bool has_audio_pattern; // false until the ROM loads a pattern, the default beep plays until then
+  bool need_update_audio; // the pattern or pitch changed since the front end last picked them up
+
+  ChirpIdleLoop loop; // backward jump being watched for loops that only wait on an external event
+  uint8_t idle_wake;  // CHIRP_WAKE_* events the machine is idle on; 0 while it is making progress
+  int8_t key_wait;    // register FX0A is blocked on until a key is released, -1 when not blocked
+
+  uint64_t instruction_count; // instructions executed since the last reset
+  uint64_t cycle_count;       // emulated time since the last reset; one cycle per instruction without vip_timing
+  uint64_t frame_count;       // 60Hz timer ticks since the last reset
+
+  // set once the machine halts on a fault; nothing executes until the next reset
+  ChirpFault fault;
+  uint16_t fault_address;     // address of the instruction that faulted
+  uint16_t fault_instruction; // the instruction that faulted
+
+#ifdef CHIRP_COVERAGE
+  uint8_t coverage[CHIRP_COVERAGE_BYTES];
+#endif
 } Chirp;
 
 #endif
@@ -0,0 +1,695 @@
+#include "debugger.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CHIRP_DEBUGGER_LINE_SIZE 256
+
+ChirpDebugger* chirp_debugger_new(Chirp* chirp, SDLWindow* window)
+{
+  ChirpDebugger* debugger = malloc(sizeof(ChirpDebugger));
+  if (debugger == NULL)
+  {
+    fprintf(stderr, "out of memory\n");
+    exit(1);
+  }
+
+  memset(debugger, 0, sizeof(ChirpDebugger));
+  debugger->chirp = chirp;
+  debugger->window = window;
+
+  // every checkpoint is allocated up front so that taking one never allocates
+  for (int i = 0; i < CHIRP_DEBUGGER_CHECKPOINTS; i++)
+  {
+    debugger->checkpoints[i].chirp = chirp_clone(chirp);
+    debugger->checkpoints[i].is_valid = false;
+  }
+  debugger->checkpoints[0].step = 0;
+  debugger->checkpoints[0].is_valid = true;
+
+  return debugger;
+}
+
+void chirp_debugger_free(ChirpDebugger* debugger)
+{
+  for (int i = 0; i < CHIRP_DEBUGGER_CHECKPOINTS; i++)
+  {
+    chirp_free(debugger->checkpoints[i].chirp);
+  }
+  free(debugger->events);
+  free(debugger);
+}
+
+ChirpCheckpoint* chirp_debugger_checkpoint_slot(ChirpDebugger* debugger, const uint64_t step)
+{
+  return &debugger->checkpoints[(step / CHIRP_DEBUGGER_CHECKPOINT_INTERVAL) % CHIRP_DEBUGGER_CHECKPOINTS];
+}
+
+// checkpoints are taken on arrival at a step, before any key change made at that step is applied
+void chirp_debugger_save_checkpoint(ChirpDebugger* debugger)
+{
+  if (debugger->step % CHIRP_DEBUGGER_CHECKPOINT_INTERVAL != 0)
+  {
+    return;
+  }
+
+  ChirpCheckpoint* checkpoint = chirp_debugger_checkpoint_slot(debugger, debugger->step);
+  if (checkpoint->is_valid && checkpoint->step == debugger->step)
+  {
+    return;
+  }
+
+  chirp_copy(checkpoint->chirp, debugger->chirp);
+  checkpoint->step = debugger->step;
+  checkpoint->is_valid = true;
+}
+
+// index of the first event made at or after the given step
+int chirp_debugger_find_event(const ChirpDebugger* debugger, const uint64_t step)
+{
+  int low = 0;
+  int high = debugger->event_count;
+
+  while (low < high)
+  {
+    const int mid = low + (high - low) / 2;
+    if (debugger->events[mid].step < step)
+    {
+      low = mid + 1;
+    }
+    else
+    {
+      high = mid;
+    }
+  }
+
+  return low;
+}
+
+// puts the machine back to the latest checkpoint at or before the given step
+bool chirp_debugger_restore(ChirpDebugger* debugger, const uint64_t step)
+{
+  const uint64_t last = step / CHIRP_DEBUGGER_CHECKPOINT_INTERVAL;
+
+  for (uint64_t i = 0; i <= last && i < CHIRP_DEBUGGER_CHECKPOINTS; i++)
+  {
+    const uint64_t checkpoint_step = (last - i) * CHIRP_DEBUGGER_CHECKPOINT_INTERVAL;
+    const ChirpCheckpoint* checkpoint = chirp_debugger_checkpoint_slot(debugger, checkpoint_step);
+
+    if (checkpoint->is_valid && checkpoint->step == checkpoint_step)
+    {
+      chirp_copy(debugger->chirp, checkpoint->chirp);
+      debugger->step = checkpoint_step;
+      debugger->next_event = chirp_debugger_find_event(debugger, checkpoint_step);
+      return true;
+    }
+  }
+
+  return false;
+}
+
+// oldest step that going backwards can still reach
+uint64_t chirp_debugger_oldest_step(const ChirpDebugger* debugger)
+{
+  uint64_t oldest = debugger->step;
+
+  for (int i = 0; i < CHIRP_DEBUGGER_CHECKPOINTS; i++)
+  {
+    const ChirpCheckpoint* checkpoint = &debugger->checkpoints[i];
+    if (checkpoint->is_valid && checkpoint->step < oldest)
+    {
+      oldest = checkpoint->step;
+    }
+  }
+
+  return oldest;
+}
+
+/**
+ * Moves the machine one step forward on a fixed schedule, so that re-executing from a checkpoint always ends up in
+ * the exact same state: logged key changes for this step are applied, one instruction executes (or, while the
+ * machine is idle, time skips straight to the end of the frame) and the timers tick once the frame's cycles have run.
+ */
+bool chirp_debugger_step(ChirpDebugger* debugger)
+{
+  Chirp* chirp = debugger->chirp;
+  if (chirp->fault != CHIRP_FAULT_NONE)
+  {
+    return false;
+  }
+
+  while (debugger->next_event < debugger->event_count &&
+         debugger->events[debugger->next_event].step == debugger->step)
+  {
+    const ChirpDebuggerEvent* event = &debugger->events[debugger->next_event];
+    chirp_set_key(chirp, event->key, event->is_pressed);
+    debugger->next_event++;
+  }
+
+  const uint64_t frame_end = chirp_frame_end(chirp);
+  if (!chirp_is_idle(chirp))
+  {
+    chirp_step(chirp);
+  }
+  else if (chirp_cycles(chirp) < frame_end)
+  {
+    chirp_run(chirp, frame_end - chirp_cycles(chirp));
+  }
+
+  if (chirp_cycles(chirp) >= frame_end)
+  {
+    chirp_tick_timers(chirp);
+  }
+
+  debugger->step++;
+  chirp_debugger_save_checkpoint(debugger);
+
+  return true;
+}
+
+// goes forwards or backwards to the given step; returns false if it is older than the history kept
+bool chirp_debugger_seek(ChirpDebugger* debugger, const uint64_t step)
+{
+  if (step < debugger->step && !chirp_debugger_restore(debugger, step))
+  {
+    return false;
+  }
+
+  while (debugger->step < step)
+  {
+    if (!chirp_debugger_step(debugger))
+    {
+      break;
+    }
+  }
+
+  return true;
+}
+
+uint16_t chirp_debugger_watch_value(const Chirp* chirp, const ChirpWatchpoint* watchpoint)
+{
+  switch (watchpoint->kind)
+  {
+  case CHIRP_WATCH_MEMORY:
+    return chirp_mem_read(chirp->mem, watchpoint->address);
+  case CHIRP_WATCH_REGISTER:
+    return chirp_registers_read(chirp->registers, watchpoint->address);
+  case CHIRP_WATCH_INDEX:
+    return chirp->index_register;
+  default:
+    return 0;
+  }
+}
+
+void chirp_debugger_sync_watchpoints(ChirpDebugger* debugger)
+{
+  for (int i = 0; i < debugger->watchpoint_count; i++)
+  {
+    ChirpWatchpoint* watchpoint = &debugger->watchpoints[i];
+    watchpoint->value = chirp_debugger_watch_value(debugger->chirp, watchpoint);
+  }
+}
+
+// checks the machine right before it executes the instruction at the current step
+ChirpStopReason chirp_debugger_check(ChirpDebugger* debugger)
+{
+  const Chirp* chirp = debugger->chirp;
+
+  if (chirp->fault != CHIRP_FAULT_NONE)
+  {
+    return CHIRP_STOP_HALT;
+  }
+
+  if (!debugger->is_armed)
+  {
+    return CHIRP_STOP_NONE;
+  }
+
+  // every watchpoint is refreshed, even when an earlier one already fired
+  ChirpStopReason reason = CHIRP_STOP_NONE;
+  for (int i = 0; i < debugger->watchpoint_count; i++)
+  {
+    ChirpWatchpoint* watchpoint = &debugger->watchpoints[i];
+    const uint16_t value = chirp_debugger_watch_value(chirp, watchpoint);
+    if (value != watchpoint->value)
+    {
+      watchpoint->value = value;
+      reason = CHIRP_STOP_WATCHPOINT;
+    }
+  }
+  if (reason != CHIRP_STOP_NONE)
+  {
+    return reason;
+  }
+
+  const uint16_t pc = chirp->program_counter;
+  if (debugger->pc_breakpoints[pc & 0x0FFF])
+  {
+    return CHIRP_STOP_BREAKPOINT;
+  }
+
+  if (debugger->opcode_breakpoint_count > 0)
+  {
+    const uint16_t instruction = chirp_mem_read(chirp->mem, pc) << 8 | chirp_mem_read(chirp->mem, pc + 1);
+    for (int i = 0; i < debugger->opcode_breakpoint_count; i++)
+    {
+      const ChirpOpcodeBreakpoint* breakpoint = &debugger->opcode_breakpoints[i];
+      if ((instruction & breakpoint->mask) == breakpoint->opcode)
+      {
+        return CHIRP_STOP_OPCODE_BREAKPOINT;
+      }
+    }
+  }
+
+  return CHIRP_STOP_NONE;
+}
+
+// runs forwards until a breakpoint or watchpoint fires, the machine halts or it can only wait for a key
+ChirpStopReason chirp_debugger_continue(ChirpDebugger* debugger)
+{
+  chirp_debugger_sync_watchpoints(debugger);
+
+  while (true)
+  {
+    if (!chirp_debugger_step(debugger))
+    {
+      return CHIRP_STOP_HALT;
+    }
+
+    const ChirpStopReason reason = chirp_debugger_check(debugger);
+    if (reason != CHIRP_STOP_NONE)
+    {
+      return reason;
+    }
+
+    // logged key changes still ahead will wake it up, anything else has to come from the user
+    const bool has_events_ahead = debugger->next_event < debugger->event_count;
+    if (debugger->chirp->idle_wake == CHIRP_WAKE_KEY && !has_events_ahead)
+    {
+      return CHIRP_STOP_WAITING_FOR_KEY;
+    }
+  }
+}
+
+/**
+ * Runs backwards to the latest earlier step where continue would have stopped.
+ *
+ * Each checkpoint interval is replayed in turn, newest first, remembering the last step a breakpoint or watchpoint
+ * fired at; the first interval with a hit is the one to stop in, so it costs at most one replay per interval searched
+ * plus the final seek.
+ */
+ChirpStopReason chirp_debugger_reverse_continue(ChirpDebugger* debugger)
+{
+  const uint64_t end = debugger->step;
+  uint64_t segment_end = end;
+
+  while (segment_end > 0)
+  {
+    const uint64_t segment_start = (segment_end - 1) / CHIRP_DEBUGGER_CHECKPOINT_INTERVAL *
+                                   CHIRP_DEBUGGER_CHECKPOINT_INTERVAL;
+    if (!chirp_debugger_restore(debugger, segment_start) || debugger->step != segment_start)
+    {
+      break;
+    }
+
+    chirp_debugger_sync_watchpoints(debugger);
+    uint64_t hit = 0;
+    ChirpStopReason hit_reason = CHIRP_STOP_NONE;
+
+    while (debugger->step < segment_end && chirp_debugger_step(debugger))
+    {
+      const ChirpStopReason reason = chirp_debugger_check(debugger);
+      if (reason != CHIRP_STOP_NONE && reason != CHIRP_STOP_HALT && debugger->step < end)
+      {
+        hit = debugger->step;
+        hit_reason = reason;
+      }
+    }
+
+    if (hit_reason != CHIRP_STOP_NONE)
+    {
+      chirp_debugger_seek(debugger, hit);
+      chirp_debugger_sync_watchpoints(debugger);
+      return hit_reason;
+    }
+
+    segment_end = segment_start;
+  }
+
+  chirp_debugger_seek(debugger, chirp_debugger_oldest_step(debugger));
+  chirp_debugger_sync_watchpoints(debugger);
+  return CHIRP_STOP_HISTORY_START;
+}
+
+/**
+ * Changes a key at the current step and logs it so that replays see it too.
+ *
+ * This starts a new timeline: logged key changes and checkpoints from after the current step belonged to the old one
+ * and are thrown away.
+ */
+void chirp_debugger_set_key(ChirpDebugger* debugger, const int key, const bool is_pressed)
+{
+  debugger->event_count = chirp_debugger_find_event(debugger, debugger->step + 1);
+
+  for (int i = 0; i < CHIRP_DEBUGGER_CHECKPOINTS; i++)
+  {
+    ChirpCheckpoint* checkpoint = &debugger->checkpoints[i];
+    if (checkpoint->is_valid && checkpoint->step > debugger->step)
+    {
+      checkpoint->is_valid = false;
+    }
+  }
+
+  if (debugger->event_count == debugger->event_capacity)
+  {
+    const int capacity = debugger->event_capacity == 0 ? 64 : debugger->event_capacity * 2;
+    ChirpDebuggerEvent* events = realloc(debugger->events, capacity * sizeof(ChirpDebuggerEvent));
+    if (events == NULL)
+    {
+      fprintf(stderr, "out of memory\n");
+      exit(1);
+    }
+
+    debugger->events = events;
+    debugger->event_capacity = capacity;
+  }
+
+  ChirpDebuggerEvent* event = &debugger->events[debugger->event_count++];
+  event->step = debugger->step;
+  event->key = (uint8_t)key;
+  event->is_pressed = is_pressed;
+
+  chirp_set_key(debugger->chirp, key, is_pressed);
+  debugger->next_event = debugger->event_count;
+}
+
+bool chirp_debugger_add_breakpoint(ChirpDebugger* debugger, const uint16_t address)
+{
+  if (address >= CHIRP_MEMORY_SIZE)
+  {
+    return false;
+  }
+
+  debugger->pc_breakpoints[address] = true;
+  debugger->is_armed = true;
+  return true;
+}
+
+bool chirp_debugger_add_opcode_breakpoint(ChirpDebugger* debugger, const uint16_t opcode, const uint16_t mask)
+{
+  if (debugger->opcode_breakpoint_count == CHIRP_DEBUGGER_OPCODE_BREAKPOINTS)
+  {
+    return false;
+  }
+
+  ChirpOpcodeBreakpoint* breakpoint = &debugger->opcode_breakpoints[debugger->opcode_breakpoint_count++];
+  breakpoint->opcode = opcode & mask;
+  breakpoint->mask = mask;
+  debugger->is_armed = true;
+  return true;
+}
+
+bool chirp_debugger_add_watchpoint(ChirpDebugger* debugger, const ChirpWatchKind kind, const uint16_t address)
+{
+  if (debugger->watchpoint_count == CHIRP_DEBUGGER_WATCHPOINTS ||
+      (kind == CHIRP_WATCH_MEMORY && address >= CHIRP_MEMORY_SIZE) ||
+      (kind == CHIRP_WATCH_REGISTER && address >= CHIRP_REGISTERS_SIZE))
+  {
+    return false;
+  }
+
+  ChirpWatchpoint* watchpoint = &debugger->watchpoints[debugger->watchpoint_count++];
+  watchpoint->kind = kind;
+  watchpoint->address = address;
+  watchpoint->value = chirp_debugger_watch_value(debugger->chirp, watchpoint);
+  debugger->is_armed = true;
+  return true;
+}
+
+void chirp_debugger_clear_breakpoints(ChirpDebugger* debugger)
+{
+  memset(debugger->pc_breakpoints, 0, sizeof(debugger->pc_breakpoints));
+  debugger->opcode_breakpoint_count = 0;
+  debugger->watchpoint_count = 0;
+  debugger->is_armed = false;
+}
+
+const char* chirp_stop_reason_name(const ChirpStopReason reason)
+{
+  switch (reason)
+  {
+  case CHIRP_STOP_NONE:
+    return "none";
+  case CHIRP_STOP_BREAKPOINT:
+    return "breakpoint";
+  case CHIRP_STOP_OPCODE_BREAKPOINT:
+    return "opcode breakpoint";
+  case CHIRP_STOP_WATCHPOINT:
+    return "watchpoint";
+  case CHIRP_STOP_HALT:
+    return "halted";
+  case CHIRP_STOP_WAITING_FOR_KEY:
+    return "waiting for a key";
+  case CHIRP_STOP_HISTORY_START:
+    return "start of history";
+  default:
+    return "unknown";
+  }
+}
+
+void chirp_debugger_print_state(const ChirpDebugger* debugger)
+{
+  const Chirp* chirp = debugger->chirp;
+  const uint16_t pc = chirp->program_counter;
+  const ChirpDecoded decoded = chirp_decode(chirp_decode_at(chirp->mem->mem, pc));
+  char text[32];
+  chirp_disassemble(&decoded, text, sizeof(text));
+
+  printf("step %llu  frame %llu  pc %03X: %04X %s  I %03X  dt %d  st %d\n",
+         (unsigned long long)debugger->step,
+         (unsigned long long)chirp->frame_count,
+         pc,
+         decoded.instruction,
+         text,
+         chirp->index_register,
+         chirp->delay_timer,
+         chirp->sound_timer);
+
+  for (int i = 0; i < CHIRP_REGISTERS_SIZE; i++)
+  {
+    printf("V%X %02X%s", i, chirp_registers_read(chirp->registers, i), i == CHIRP_REGISTERS_SIZE - 1 ? "\n" : "  ");
+  }
+
+  if (chirp->keyboard->pressed != 0 || chirp->key_wait >= 0)
+  {
+    printf("keys");
+    for (int i = 0; i < CHIRP_KEYBOARD_SIZE; i++)
+    {
+      if (chirp_keyboard_read(chirp->keyboard, i))
+      {
+        printf(" %X (since cycle %llu)", i, (unsigned long long)chirp->keyboard->edge_cycles[i]);
+      }
+    }
+    if (chirp->key_wait >= 0)
+    {
+      printf("%s FX0A waiting on a release for V%X", chirp->keyboard->pressed != 0 ? "," : "", chirp->key_wait);
+    }
+    printf("\n");
+  }
+
+  if (chirp->fault != CHIRP_FAULT_NONE)
+  {
+    printf("halted: %s: %04X at %03X\n",
+           chirp_fault_name(chirp->fault),
+           chirp->fault_instruction,
+           chirp->fault_address);
+  }
+}
+
+void chirp_debugger_print_memory(const ChirpDebugger* debugger, const uint16_t address, const int length)
+{
+  for (int i = 0; i < length; i++)
+  {
+    if (i % 16 == 0)
+    {
+      printf("%s%03X:", i == 0 ? "" : "\n", (address + i) & 0x0FFF);
+    }
+    printf(" %02X", chirp_mem_read(debugger->chirp->mem, address + i));
+  }
+  printf("\n");
+}
+
+void chirp_debugger_print_screen(const ChirpDebugger* debugger)
+{
+  for (int y = 0; y < DISPLAY_HEIGHT; y++)
+  {
+    for (int x = 0; x < DISPLAY_WIDTH; x++)
+    {
+      putchar(chirp_display_get_pixel(debugger->chirp->display, x, y) ? '#' : '.');
+    }
+    putchar('\n');
+  }
+}
+
+void chirp_debugger_print_help()
+{
+  printf("s, step [N]          execute N steps (default 1)\n"
+         "rs, rstep [N]        go back N steps (default 1)\n"
+         "c, continue          run until a breakpoint or watchpoint fires, the ROM halts or waits for a key\n"
+         "rc, rcontinue        run backwards to the previous breakpoint or watchpoint hit\n"
+         "b, break ADDR        stop when the PC reaches ADDR\n"
+         "ob, obreak OP [MASK] stop before an instruction where (instruction & MASK) == OP; MASK defaults to FFFF\n"
+         "w, watch mem ADDR    stop when mem[ADDR] changes\n"
+         "w, watch v X         stop when VX changes\n"
+         "w, watch i           stop when I changes\n"
+         "d, delete            remove every breakpoint and watchpoint\n"
+         "r, regs              print the registers\n"
+         "m, mem ADDR [LEN]    print LEN bytes of memory from ADDR (default 16)\n"
+         "k, key K down|up     press or release key K at the current step\n"
+         "screen               print the display\n"
+         "q, quit              stop debugging\n"
+         "numbers are hexadecimal except for step counts and lengths\n");
+}
+
+void chirp_debugger_print_stop(const ChirpDebugger* debugger, const ChirpStopReason reason)
+{
+  printf("stopped: %s\n", chirp_stop_reason_name(reason));
+  chirp_debugger_print_state(debugger);
+}
+
+/**
+ * Reads commands from stdin until quit or end of input.
+ *
+ * The window, when there is one, only mirrors the display; keys go through the key command so that every input ends
+ * up in the log replays are built from.
+ */
+void chirp_debugger_run(ChirpDebugger* debugger)
+{
+  char line[CHIRP_DEBUGGER_LINE_SIZE];
+  char command[32];
+  char arg[32];
+  unsigned int first;
+  unsigned int second;
+
+  chirp_debugger_print_state(debugger);
+
+  while (true)
+  {
+    if (debugger->window != NULL)
+    {
+      sdl_window_draw_display(debugger->window, debugger->chirp->display);
+      SDL_PumpEvents();
+    }
+
+    printf("(chirp) ");
+    fflush(stdout);
+    if (fgets(line, sizeof(line), stdin) == NULL)
+    {
+      break;
+    }
+
+    const int args = sscanf(line, "%31s %31s %x", command, arg, &second);
+    if (args < 1)
+    {
+      continue;
+    }
+
+    if (strcmp(command, "s") == 0 || strcmp(command, "step") == 0)
+    {
+      const int count = args >= 2 ? atoi(arg) : 1;
+      chirp_debugger_seek(debugger, debugger->step + (count > 0 ? count : 1));
+      chirp_debugger_print_state(debugger);
+    }
+    else if (strcmp(command, "rs") == 0 || strcmp(command, "rstep") == 0)
+    {
+      const uint64_t count = args >= 2 && atoi(arg) > 0 ? (uint64_t)atoi(arg) : 1;
+      const uint64_t step = count < debugger->step ? debugger->step - count : 0;
+      if (!chirp_debugger_seek(debugger, step))
+      {
+        printf("step %llu is older than the history kept\n", (unsigned long long)step);
+      }
+      chirp_debugger_print_state(debugger);
+    }
+    else if (strcmp(command, "c") == 0 || strcmp(command, "continue") == 0)
+    {
+      chirp_debugger_print_stop(debugger, chirp_debugger_continue(debugger));
+    }
+    else if (strcmp(command, "rc") == 0 || strcmp(command, "rcontinue") == 0)
+    {
+      chirp_debugger_print_stop(debugger, chirp_debugger_reverse_continue(debugger));
+    }
+    else if ((strcmp(command, "b") == 0 || strcmp(command, "break") == 0) && args >= 2 &&
+             sscanf(arg, "%x", &first) == 1)
+    {
+      if (!chirp_debugger_add_breakpoint(debugger, (uint16_t)first))
+      {
+        printf("address out of range\n");
+      }
+    }
+    else if ((strcmp(command, "ob") == 0 || strcmp(command, "obreak") == 0) && args >= 2 &&
+             sscanf(arg, "%x", &first) == 1)
+    {
+      const uint16_t mask = args >= 3 ? (uint16_t)second : 0xFFFF;
+      if (!chirp_debugger_add_opcode_breakpoint(debugger, (uint16_t)first, mask))
+      {
+        printf("too many opcode breakpoints\n");
+      }
+    }
+    else if ((strcmp(command, "w") == 0 || strcmp(command, "watch") == 0) && args >= 2)
+    {
+      bool is_added = false;
+      if (strcmp(arg, "i") == 0)
+      {
+        is_added = chirp_debugger_add_watchpoint(debugger, CHIRP_WATCH_INDEX, 0);
+      }
+      else if (strcmp(arg, "mem") == 0 && args >= 3)
+      {
+        is_added = chirp_debugger_add_watchpoint(debugger, CHIRP_WATCH_MEMORY, (uint16_t)second);
+      }
+      else if (strcmp(arg, "v") == 0 && args >= 3)
+      {
+        is_added = chirp_debugger_add_watchpoint(debugger, CHIRP_WATCH_REGISTER, (uint16_t)second);
+      }
+
+      if (!is_added)
+      {
+        printf("could not add the watchpoint\n");
+      }
+    }
+    else if (strcmp(command, "d") == 0 || strcmp(command, "delete") == 0)
+    {
+      chirp_debugger_clear_breakpoints(debugger);
+    }
+    else if (strcmp(command, "r") == 0 || strcmp(command, "regs") == 0)
+    {
+      chirp_debugger_print_state(debugger);
+    }
+    else if ((strcmp(command, "m") == 0 || strcmp(command, "mem") == 0) && args >= 2 &&
+             sscanf(arg, "%x", &first) == 1)
+    {
+      int length = 16;
+      sscanf(line, "%*s %*s %d", &length);
+      chirp_debugger_print_memory(debugger, (uint16_t)first, length > 0 ? length : 16);
+    }
+    else if ((strcmp(command, "k") == 0 || strcmp(command, "key") == 0) && args >= 2 &&
+             sscanf(arg, "%x", &first) == 1 && first < CHIRP_KEYBOARD_SIZE)
+    {
+      char state[8] = "down";
+      sscanf(line, "%*s %*s %7s", state);
+      chirp_debugger_set_key(debugger, (int)first, strcmp(state, "up") != 0);
+    }
+    else if (strcmp(command, "screen") == 0)
+    {
+      chirp_debugger_print_screen(debugger);
+    }
+    else if (strcmp(command, "q") == 0 || strcmp(command, "quit") == 0)
+    {
+      break;
+    }
+    else
+    {
+      chirp_debugger_print_help();
+    }
+  }
+}
@@ -0,0 +1,101 @@
+#ifndef CHIRP_DEBUGGER_H
+#define CHIRP_DEBUGGER_H
+
+#include "chirp.h"
+
+// interactive debugger that can also run backwards: the machine is checkpointed every few thousand steps and every
+// input it receives is logged, so any earlier step is reached by restoring the closest checkpoint before it and
+// re-executing deterministically from there
+
+#define CHIRP_DEBUGGER_CHECKPOINT_INTERVAL 1024 // steps between checkpoints; bounds the replay needed to go back
+#define CHIRP_DEBUGGER_CHECKPOINTS 256          // checkpoints kept; older history can no longer be reached
+#define CHIRP_DEBUGGER_OPCODE_BREAKPOINTS 16
+#define CHIRP_DEBUGGER_WATCHPOINTS 16
+
+typedef enum ChirpStopReason
+{
+  CHIRP_STOP_NONE = 0,
+  CHIRP_STOP_BREAKPOINT,        // the PC reached a breakpoint
+  CHIRP_STOP_OPCODE_BREAKPOINT, // the next instruction matches an opcode breakpoint
+  CHIRP_STOP_WATCHPOINT,        // the last step changed a watched value
+  CHIRP_STOP_HALT,              // the machine halted on a fault
+  CHIRP_STOP_WAITING_FOR_KEY,   // nothing can happen until a key changes
+  CHIRP_STOP_HISTORY_START,     // ran backwards into the oldest step still reachable
+} ChirpStopReason;
+
+typedef enum ChirpWatchKind
+{
+  CHIRP_WATCH_MEMORY,
+  CHIRP_WATCH_REGISTER,
+  CHIRP_WATCH_INDEX,
+} ChirpWatchKind;
+
+typedef struct ChirpWatchpoint
+{
+  ChirpWatchKind kind;
+  uint16_t address; // memory address or register number, depending on the kind
+  uint16_t value;   // value at the previous step
+} ChirpWatchpoint;
+
+// stops before any instruction where (instruction & mask) == opcode
+typedef struct ChirpOpcodeBreakpoint
+{
+  uint16_t opcode;
+  uint16_t mask;
+} ChirpOpcodeBreakpoint;
+
+// key change made from the debugger, replayed right before the step it was made at
+typedef struct ChirpDebuggerEvent
+{
+  uint64_t step;
+  uint8_t key;
+  bool is_pressed;
+} ChirpDebuggerEvent;
+
+typedef struct ChirpCheckpoint
+{
+  Chirp* chirp; // allocated once up front, overwritten in place
+  uint64_t step;
+  bool is_valid;
+} ChirpCheckpoint;
+
+typedef struct ChirpDebugger
+{
+  Chirp* chirp;
+  SDLWindow* window; // NULL when headless
+  uint64_t step;     // steps since the reset, the debugger's notion of time
+
+  ChirpCheckpoint checkpoints[CHIRP_DEBUGGER_CHECKPOINTS]; // ring indexed by step / CHIRP_DEBUGGER_CHECKPOINT_INTERVAL
+
+  // log of every key change, sorted by step
+  ChirpDebuggerEvent* events;
+  int event_count;
+  int event_capacity;
+  int next_event; // first event not applied to the machine yet
+
+  bool is_armed; // any breakpoint or watchpoint set; lets continue skip the checks entirely otherwise
+  bool pc_breakpoints[CHIRP_MEMORY_SIZE];
+  ChirpOpcodeBreakpoint opcode_breakpoints[CHIRP_DEBUGGER_OPCODE_BREAKPOINTS];
+  int opcode_breakpoint_count;
+  ChirpWatchpoint watchpoints[CHIRP_DEBUGGER_WATCHPOINTS];
+  int watchpoint_count;
+} ChirpDebugger;
+
+ChirpDebugger* chirp_debugger_new(Chirp* chirp, SDLWindow* window);
+void chirp_debugger_free(ChirpDebugger* debugger);
+
+bool chirp_debugger_step(ChirpDebugger* debugger);
+bool chirp_debugger_seek(ChirpDebugger* debugger, uint64_t step);
+ChirpStopReason chirp_debugger_continue(ChirpDebugger* debugger);
+ChirpStopReason chirp_debugger_reverse_continue(ChirpDebugger* debugger);
+void chirp_debugger_set_key(ChirpDebugger* debugger, int key, bool is_pressed);
+
+bool chirp_debugger_add_breakpoint(ChirpDebugger* debugger, uint16_t address);
+bool chirp_debugger_add_opcode_breakpoint(ChirpDebugger* debugger, uint16_t opcode, uint16_t mask);
+bool chirp_debugger_add_watchpoint(ChirpDebugger* debugger, ChirpWatchKind kind, uint16_t address);
+void chirp_debugger_clear_breakpoints(ChirpDebugger* debugger);
+
+const char* chirp_stop_reason_name(ChirpStopReason reason);
+void chirp_debugger_run(ChirpDebugger* debugger);
+
+#endif // CHIRP_DEBUGGER_H
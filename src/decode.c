@@ -0,0 +1,263 @@
+#include "decode.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+ChirpOp chirp_decode_op(const uint16_t instruction)
+{
+  const uint8_t x = (instruction & 0x0F00) >> 8;
+  const uint8_t n = instruction & 0x000F;
+  const uint8_t nn = instruction & 0x00FF;
+
+  switch (instruction & 0xF000)
+  {
+  case 0x0000:
+    switch (instruction)
+    {
+    case 0x00E0:
+      return CHIRP_OP_CLS;
+    case 0x00EE:
+      return CHIRP_OP_RET;
+    default:
+      return CHIRP_OP_INVALID;
+    }
+  case 0x1000:
+    return CHIRP_OP_JP;
+  case 0x2000:
+    return CHIRP_OP_CALL;
+  case 0x3000:
+    return CHIRP_OP_SE_VX_NN;
+  case 0x4000:
+    return CHIRP_OP_SNE_VX_NN;
+  case 0x5000:
+    return n == 0x0 ? CHIRP_OP_SE_VX_VY : CHIRP_OP_INVALID;
+  case 0x6000:
+    return CHIRP_OP_LD_VX_NN;
+  case 0x7000:
+    return CHIRP_OP_ADD_VX_NN;
+  case 0x8000:
+    switch (n)
+    {
+    case 0x0:
+      return CHIRP_OP_LD_VX_VY;
+    case 0x1:
+      return CHIRP_OP_OR;
+    case 0x2:
+      return CHIRP_OP_AND;
+    case 0x3:
+      return CHIRP_OP_XOR;
+    case 0x4:
+      return CHIRP_OP_ADD_VX_VY;
+    case 0x5:
+      return CHIRP_OP_SUB;
+    case 0x6:
+      return CHIRP_OP_SHR;
+    case 0x7:
+      return CHIRP_OP_SUBN;
+    case 0xE:
+      return CHIRP_OP_SHL;
+    default:
+      return CHIRP_OP_INVALID;
+    }
+  case 0x9000:
+    return n == 0x0 ? CHIRP_OP_SNE_VX_VY : CHIRP_OP_INVALID;
+  case 0xA000:
+    return CHIRP_OP_LD_I;
+  case 0xB000:
+    return CHIRP_OP_JP_V0;
+  case 0xC000:
+    return CHIRP_OP_RND;
+  case 0xD000:
+    return CHIRP_OP_DRW;
+  case 0xE000:
+    switch (nn)
+    {
+    case 0x9E:
+      return CHIRP_OP_SKP;
+    case 0xA1:
+      return CHIRP_OP_SKNP;
+    default:
+      return CHIRP_OP_INVALID;
+    }
+  default:
+    switch (nn)
+    {
+    case 0x02:
+      return x == 0x0 ? CHIRP_OP_AUDIO : CHIRP_OP_INVALID;
+    case 0x07:
+      return CHIRP_OP_LD_VX_DT;
+    case 0x0A:
+      return CHIRP_OP_LD_VX_K;
+    case 0x15:
+      return CHIRP_OP_LD_DT_VX;
+    case 0x18:
+      return CHIRP_OP_LD_ST_VX;
+    case 0x1E:
+      return CHIRP_OP_ADD_I_VX;
+    case 0x29:
+      return CHIRP_OP_LD_F_VX;
+    case 0x33:
+      return CHIRP_OP_LD_B_VX;
+    case 0x3A:
+      return CHIRP_OP_PITCH;
+    case 0x55:
+      return CHIRP_OP_STORE;
+    case 0x65:
+      return CHIRP_OP_LOAD;
+    default:
+      return CHIRP_OP_INVALID;
+    }
+  }
+}
+
+ChirpDecoded chirp_decode(const uint16_t instruction)
+{
+  ChirpDecoded decoded;
+  decoded.op = chirp_decode_op(instruction);
+  decoded.instruction = instruction;
+  decoded.x = (instruction & 0x0F00) >> 8;
+  decoded.y = (instruction & 0x00F0) >> 4;
+  decoded.n = instruction & 0x000F;
+  decoded.nn = instruction & 0x00FF;
+  decoded.nnn = instruction & 0x0FFF;
+
+  return decoded;
+}
+
+// instruction stored at an address of a 4K memory image, wrapping around the end like the core does
+uint16_t chirp_decode_at(const uint8_t* mem, const uint16_t address)
+{
+  return (uint16_t)(mem[address & 0x0FFF] << 8 | mem[(address + 1) & 0x0FFF]);
+}
+
+bool chirp_op_is_skip(const ChirpOp op)
+{
+  switch (op)
+  {
+  case CHIRP_OP_SE_VX_NN:
+  case CHIRP_OP_SNE_VX_NN:
+  case CHIRP_OP_SE_VX_VY:
+  case CHIRP_OP_SNE_VX_VY:
+  case CHIRP_OP_SKP:
+  case CHIRP_OP_SKNP:
+    return true;
+  default:
+    return false;
+  }
+}
+
+// writes the instruction in the usual CHIP-8 assembly syntax; returns what snprintf returns
+int chirp_disassemble(const ChirpDecoded* d, char* out, const size_t size)
+{
+  switch (d->op)
+  {
+  case CHIRP_OP_CLS:
+    return snprintf(out, size, "CLS");
+  case CHIRP_OP_RET:
+    return snprintf(out, size, "RET");
+  case CHIRP_OP_JP:
+    return snprintf(out, size, "JP 0x%03X", d->nnn);
+  case CHIRP_OP_CALL:
+    return snprintf(out, size, "CALL 0x%03X", d->nnn);
+  case CHIRP_OP_SE_VX_NN:
+    return snprintf(out, size, "SE V%X, 0x%02X", d->x, d->nn);
+  case CHIRP_OP_SNE_VX_NN:
+    return snprintf(out, size, "SNE V%X, 0x%02X", d->x, d->nn);
+  case CHIRP_OP_SE_VX_VY:
+    return snprintf(out, size, "SE V%X, V%X", d->x, d->y);
+  case CHIRP_OP_LD_VX_NN:
+    return snprintf(out, size, "LD V%X, 0x%02X", d->x, d->nn);
+  case CHIRP_OP_ADD_VX_NN:
+    return snprintf(out, size, "ADD V%X, 0x%02X", d->x, d->nn);
+  case CHIRP_OP_LD_VX_VY:
+    return snprintf(out, size, "LD V%X, V%X", d->x, d->y);
+  case CHIRP_OP_OR:
+    return snprintf(out, size, "OR V%X, V%X", d->x, d->y);
+  case CHIRP_OP_AND:
+    return snprintf(out, size, "AND V%X, V%X", d->x, d->y);
+  case CHIRP_OP_XOR:
+    return snprintf(out, size, "XOR V%X, V%X", d->x, d->y);
+  case CHIRP_OP_ADD_VX_VY:
+    return snprintf(out, size, "ADD V%X, V%X", d->x, d->y);
+  case CHIRP_OP_SUB:
+    return snprintf(out, size, "SUB V%X, V%X", d->x, d->y);
+  case CHIRP_OP_SHR:
+    return snprintf(out, size, "SHR V%X, V%X", d->x, d->y);
+  case CHIRP_OP_SUBN:
+    return snprintf(out, size, "SUBN V%X, V%X", d->x, d->y);
+  case CHIRP_OP_SHL:
+    return snprintf(out, size, "SHL V%X, V%X", d->x, d->y);
+  case CHIRP_OP_SNE_VX_VY:
+    return snprintf(out, size, "SNE V%X, V%X", d->x, d->y);
+  case CHIRP_OP_LD_I:
+    return snprintf(out, size, "LD I, 0x%03X", d->nnn);
+  case CHIRP_OP_JP_V0:
+    return snprintf(out, size, "JP V0, 0x%03X", d->nnn);
+  case CHIRP_OP_RND:
+    return snprintf(out, size, "RND V%X, 0x%02X", d->x, d->nn);
+  case CHIRP_OP_DRW:
+    return snprintf(out, size, "DRW V%X, V%X, %d", d->x, d->y, d->n);
+  case CHIRP_OP_SKP:
+    return snprintf(out, size, "SKP V%X", d->x);
+  case CHIRP_OP_SKNP:
+    return snprintf(out, size, "SKNP V%X", d->x);
+  case CHIRP_OP_AUDIO:
+    return snprintf(out, size, "AUDIO");
+  case CHIRP_OP_LD_VX_DT:
+    return snprintf(out, size, "LD V%X, DT", d->x);
+  case CHIRP_OP_LD_VX_K:
+    return snprintf(out, size, "LD V%X, K", d->x);
+  case CHIRP_OP_LD_DT_VX:
+    return snprintf(out, size, "LD DT, V%X", d->x);
+  case CHIRP_OP_LD_ST_VX:
+    return snprintf(out, size, "LD ST, V%X", d->x);
+  case CHIRP_OP_ADD_I_VX:
+    return snprintf(out, size, "ADD I, V%X", d->x);
+  case CHIRP_OP_LD_F_VX:
+    return snprintf(out, size, "LD F, V%X", d->x);
+  case CHIRP_OP_LD_B_VX:
+    return snprintf(out, size, "LD B, V%X", d->x);
+  case CHIRP_OP_PITCH:
+    return snprintf(out, size, "PITCH V%X", d->x);
+  case CHIRP_OP_STORE:
+    return snprintf(out, size, "LD [I], V%X", d->x);
+  case CHIRP_OP_LOAD:
+    return snprintf(out, size, "LD V%X, [I]", d->x);
+  default:
+    return snprintf(out, size, "DW 0x%04X", d->instruction);
+  }
+}
+
+ChirpDecodeCache* chirp_decode_cache_new()
+{
+  // zeroed entries already hold the right answer for 0000, so nothing is ever treated as a stale hit
+  ChirpDecodeCache* cache = calloc(1, sizeof(ChirpDecodeCache));
+  if (cache == NULL)
+  {
+    fprintf(stderr, "out of memory\n");
+    exit(1);
+  }
+
+  return cache;
+}
+
+// the instruction just fetched from address, decoding it only if that address held something else last time
+const ChirpDecoded* chirp_decode_cache_lookup(ChirpDecodeCache* cache,
+                                              const uint16_t address,
+                                              const uint16_t instruction)
+{
+  ChirpDecoded* entry = &cache->entries[address & 0x0FFF];
+  if (entry->instruction != instruction)
+  {
+    *entry = chirp_decode(instruction);
+  }
+
+  return entry;
+}
+
+// decodes ahead of time, for addresses known to hold code before the ROM ever gets there
+void chirp_decode_cache_seed(ChirpDecodeCache* cache, const uint16_t address, const uint16_t instruction)
+{
+  cache->entries[address & 0x0FFF] = chirp_decode(instruction);
+}
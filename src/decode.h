@@ -0,0 +1,84 @@
+#ifndef CHIRP_DECODE_H
+#define CHIRP_DECODE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "memory.h"
+
+// instruction decoding shared by the core and the tools; depends on nothing else so the tools can build without SDL
+
+// every instruction the core knows about; quirks pick between variations when executing, not when decoding
+typedef enum ChirpOp
+{
+  CHIRP_OP_INVALID = 0, // also what an empty decode cache entry holds, which is right for 0000
+  CHIRP_OP_CLS,         // 00E0
+  CHIRP_OP_RET,         // 00EE
+  CHIRP_OP_JP,          // 1NNN
+  CHIRP_OP_CALL,        // 2NNN
+  CHIRP_OP_SE_VX_NN,    // 3XNN
+  CHIRP_OP_SNE_VX_NN,   // 4XNN
+  CHIRP_OP_SE_VX_VY,    // 5XY0
+  CHIRP_OP_LD_VX_NN,    // 6XNN
+  CHIRP_OP_ADD_VX_NN,   // 7XNN
+  CHIRP_OP_LD_VX_VY,    // 8XY0
+  CHIRP_OP_OR,          // 8XY1
+  CHIRP_OP_AND,         // 8XY2
+  CHIRP_OP_XOR,         // 8XY3
+  CHIRP_OP_ADD_VX_VY,   // 8XY4
+  CHIRP_OP_SUB,         // 8XY5
+  CHIRP_OP_SHR,         // 8XY6
+  CHIRP_OP_SUBN,        // 8XY7
+  CHIRP_OP_SHL,         // 8XYE
+  CHIRP_OP_SNE_VX_VY,   // 9XY0
+  CHIRP_OP_LD_I,        // ANNN
+  CHIRP_OP_JP_V0,       // BNNN
+  CHIRP_OP_RND,         // CXNN
+  CHIRP_OP_DRW,         // DXYN
+  CHIRP_OP_SKP,         // EX9E
+  CHIRP_OP_SKNP,        // EXA1
+  CHIRP_OP_AUDIO,       // F002 (XO-CHIP)
+  CHIRP_OP_LD_VX_DT,    // FX07
+  CHIRP_OP_LD_VX_K,     // FX0A
+  CHIRP_OP_LD_DT_VX,    // FX15
+  CHIRP_OP_LD_ST_VX,    // FX18
+  CHIRP_OP_ADD_I_VX,    // FX1E
+  CHIRP_OP_LD_F_VX,     // FX29
+  CHIRP_OP_LD_B_VX,     // FX33
+  CHIRP_OP_PITCH,       // FX3A (XO-CHIP)
+  CHIRP_OP_STORE,       // FX55
+  CHIRP_OP_LOAD,        // FX65
+  CHIRP_OP_COUNT,
+} ChirpOp;
+
+typedef struct ChirpDecoded
+{
+  ChirpOp op;
+  uint16_t instruction;
+  uint8_t x;
+  uint8_t y;
+  uint8_t n;
+  uint8_t nn;
+  uint16_t nnn;
+} ChirpDecoded;
+
+// the cache keeps every instruction fully decoded, operands and all, so running one again is a single compare.
+// Entries check themselves against the instruction actually fetched, so code that rewrites itself never needs an
+// explicit invalidation
+typedef struct ChirpDecodeCache
+{
+  ChirpDecoded entries[CHIRP_MEMORY_SIZE];
+} ChirpDecodeCache;
+
+ChirpOp chirp_decode_op(uint16_t instruction);
+ChirpDecoded chirp_decode(uint16_t instruction);
+uint16_t chirp_decode_at(const uint8_t* mem, uint16_t address);
+bool chirp_op_is_skip(ChirpOp op);
+int chirp_disassemble(const ChirpDecoded* decoded, char* out, size_t size);
+
+ChirpDecodeCache* chirp_decode_cache_new();
+const ChirpDecoded* chirp_decode_cache_lookup(ChirpDecodeCache* cache, uint16_t address, uint16_t instruction);
+void chirp_decode_cache_seed(ChirpDecodeCache* cache, uint16_t address, uint16_t instruction);
+
+#endif // CHIRP_DECODE_H
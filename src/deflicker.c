@@ -0,0 +1,128 @@
+#include "deflicker.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// persistence is the percentage of its brightness a pixel keeps on every tick after it goes dark
+ChirpDeflicker* chirp_deflicker_new(const int persistence)
+{
+  ChirpDeflicker* deflicker = malloc(sizeof(ChirpDeflicker));
+  if (deflicker == NULL)
+  {
+    fprintf(stderr, "out of memory\n");
+    exit(1);
+  }
+
+  const int kept = persistence < 0 ? 0 : persistence > 99 ? 99 : persistence;
+  deflicker->keep = (uint16_t)(kept * 256 / 100);
+  deflicker->version = 0;
+  chirp_deflicker_reset(deflicker);
+
+  return deflicker;
+}
+
+void chirp_deflicker_free(ChirpDeflicker* deflicker)
+{
+  free(deflicker);
+}
+
+void chirp_deflicker_reset(ChirpDeflicker* deflicker)
+{
+  memset(deflicker->levels, 0, sizeof(deflicker->levels));
+  deflicker->fading_rows = 0;
+  deflicker->changed_rows = CHIRP_DISPLAY_ALL_ROWS;
+  deflicker->version++;
+}
+
+/**
+ * Called on every 60Hz tick: lit pixels go to full brightness and dark ones lose some of theirs.
+ *
+ * Only the rows written to since the last tick, or still fading from an earlier one, are touched; the rest of the
+ * levels are already what they would be. Takes the dirty rows from the display, so nothing else may follow them.
+ */
+void chirp_deflicker_update(ChirpDeflicker* deflicker, ChirpDisplay* display)
+{
+  const uint64_t rows = display->dirty_rows | deflicker->fading_rows;
+  display->dirty_rows = 0;
+  if (rows == 0)
+  {
+    return;
+  }
+
+  uint64_t fading_rows = 0;
+  for (int y = 0; y < DISPLAY_HEIGHT; y++)
+  {
+    const uint64_t row = (uint64_t)1 << y;
+    if ((rows & row) == 0)
+    {
+      continue;
+    }
+
+    uint8_t* levels = deflicker->levels[y];
+    const bool* pixels = display->display[y];
+    for (int x = 0; x < DISPLAY_WIDTH; x++)
+    {
+      if (pixels[x])
+      {
+        levels[x] = CHIRP_DEFLICKER_LIT;
+      }
+      else if (levels[x] != 0)
+      {
+        levels[x] = (uint8_t)(levels[x] * deflicker->keep >> 8);
+        if (levels[x] != 0)
+        {
+          fading_rows |= row;
+        }
+      }
+    }
+  }
+
+  deflicker->fading_rows = fading_rows;
+  deflicker->changed_rows |= rows;
+  deflicker->version++;
+}
+
+/**
+ * Copies the levels of src into dst, which keeps the rows it has not handed to the front end yet and adds the rows the
+ * copy made look different, so that a front end drawing dst only redraws those, however far apart the two have got.
+ */
+void chirp_deflicker_copy(ChirpDeflicker* dst, const ChirpDeflicker* src)
+{
+  uint64_t changed_rows = dst->changed_rows;
+  for (int y = 0; y < DISPLAY_HEIGHT; y++)
+  {
+    if (memcmp(dst->levels[y], src->levels[y], sizeof(dst->levels[y])) != 0)
+    {
+      changed_rows |= (uint64_t)1 << y;
+    }
+  }
+
+  const uint64_t version = dst->version;
+  *dst = *src;
+  dst->changed_rows = changed_rows;
+  dst->version = changed_rows != 0 ? version + 1 : version;
+}
+
+// shows the display as it is, fully lit or dark with nothing fading, for when there are no levels to carry on from
+void chirp_deflicker_show(ChirpDeflicker* deflicker, const ChirpDisplay* display)
+{
+  for (int y = 0; y < DISPLAY_HEIGHT; y++)
+  {
+    for (int x = 0; x < DISPLAY_WIDTH; x++)
+    {
+      deflicker->levels[y][x] = display->display[y][x] ? CHIRP_DEFLICKER_LIT : 0;
+    }
+  }
+  deflicker->fading_rows = 0;
+  deflicker->changed_rows = CHIRP_DISPLAY_ALL_ROWS;
+  deflicker->version++;
+}
+
+// rows that changed since the last call, for the front end to redraw
+uint64_t chirp_deflicker_take_changes(ChirpDeflicker* deflicker)
+{
+  const uint64_t rows = deflicker->changed_rows;
+  deflicker->changed_rows = 0;
+  return rows;
+}
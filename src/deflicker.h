@@ -0,0 +1,31 @@
+#ifndef CHIRP_DEFLICKER_H
+#define CHIRP_DEFLICKER_H
+
+#include "display.h"
+
+#include <stdint.h>
+
+// anti-flicker: CHIP-8 sprites are drawn with XOR, so a moving sprite is erased and redrawn and can spend whole frames
+// off the screen. Instead of going dark at once, a pixel fades out over a few 60Hz ticks, which hides the gaps. Only
+// the rows the display marked dirty and the rows still fading are looked at, so a tick costs what changed on it
+
+#define CHIRP_DEFLICKER_LIT 255 // level of a pixel that is on
+
+typedef struct ChirpDeflicker
+{
+  uint8_t levels[DISPLAY_HEIGHT][DISPLAY_WIDTH]; // brightness of every pixel as shown, from 0 to CHIRP_DEFLICKER_LIT
+  uint64_t fading_rows;  // rows with a pixel that went dark and has not faded out yet
+  uint64_t changed_rows; // rows whose levels may have changed since the front end last took them
+  uint64_t version;      // bumped whenever the levels may have changed, like ChirpDisplay.version
+  uint16_t keep;         // fraction of its level a dark pixel keeps on every tick, out of 256
+} ChirpDeflicker;
+
+ChirpDeflicker* chirp_deflicker_new(int persistence);
+void chirp_deflicker_free(ChirpDeflicker* deflicker);
+void chirp_deflicker_reset(ChirpDeflicker* deflicker);
+void chirp_deflicker_update(ChirpDeflicker* deflicker, ChirpDisplay* display);
+void chirp_deflicker_copy(ChirpDeflicker* dst, const ChirpDeflicker* src);
+void chirp_deflicker_show(ChirpDeflicker* deflicker, const ChirpDisplay* display);
+uint64_t chirp_deflicker_take_changes(ChirpDeflicker* deflicker);
+
+#endif // CHIRP_DEFLICKER_H
@@ -0,0 +1,232 @@
+#include "detect.h"
+#include "pool.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+void chirp_quirks_apply(ChirpConfig* config, const int quirks)
+{
+  config->shift_vx = (quirks & CHIRP_QUIRK_SHIFT_VX) != 0;
+  config->jump_with_vx = (quirks & CHIRP_QUIRK_JUMP_WITH_VX) != 0;
+  config->set_registers_increment_index = (quirks & CHIRP_QUIRK_SET_REGISTERS_INCREMENT_INDEX) != 0;
+  config->load_registers_increment_index = (quirks & CHIRP_QUIRK_LOAD_REGISTERS_INCREMENT_INDEX) != 0;
+}
+
+// the CHIRP_QUIRK_* flags of the quirks given on the command line
+int chirp_quirks_given(const ChirpConfig* config)
+{
+  return (config->given / CHIRP_GIVEN_QUIRK(1)) & ((1 << CHIRP_QUIRK_COUNT) - 1);
+}
+
+int chirp_quirks_count(const int quirks)
+{
+  int count = 0;
+  for (int i = 0; i < CHIRP_QUIRK_COUNT; i++)
+  {
+    count += quirks >> i & 1;
+  }
+
+  return count;
+}
+
+// the flags that turn the quirks on, or "none"
+void chirp_quirks_format(const int quirks, char* out, const size_t size)
+{
+  snprintf(out, size, "%s", quirks == 0 ? "none" : "");
+  for (int i = 0; i < CHIRP_QUIRK_COUNT; i++)
+  {
+    if ((quirks >> i & 1) != 0)
+    {
+      const size_t length = strlen(out);
+      snprintf(out + length, size - length, "%s--%s", length > 0 ? " " : "", chirp_quirk_name(i));
+    }
+  }
+}
+
+// runs one profile to the end, on the key presses every profile gets
+void chirp_detect_run(const ChirpDetect* detect, ChirpDetectRun* run)
+{
+  Chirp* chirp = run->chirp;
+  uint64_t version = chirp->display->version;
+  int next_input = 0;
+
+  while (chirp->frame_count < detect->frames)
+  {
+    while (next_input < detect->input_count && detect->inputs[next_input].frame <= chirp->frame_count)
+    {
+      const ChirpDiffInput* input = &detect->inputs[next_input++];
+      chirp_set_key(chirp, input->key, input->is_pressed);
+    }
+
+    const ChirpFault fault = chirp_run_frame(chirp);
+    if (chirp->display->version != version)
+    {
+      version = chirp->display->version;
+      run->changed_frames++;
+      for (int y = 0; y < DISPLAY_HEIGHT; y++)
+      {
+        for (int x = 0; x < DISPLAY_WIDTH; x++)
+        {
+          if (chirp->display->display[y][x] && !run->touched[y][x])
+          {
+            run->touched[y][x] = true;
+            run->touched_pixels++;
+          }
+        }
+      }
+    }
+
+    if (fault != CHIRP_FAULT_NONE)
+    {
+      break;
+    }
+  }
+
+  run->fault = chirp->fault;
+  run->halted_at = chirp->frame_count;
+}
+
+int SDLCALL chirp_detect_work(void* data)
+{
+  ChirpDetect* detect = data;
+  for (int i = SDL_AddAtomicInt(&detect->next_run, 1); i < detect->run_count;
+       i = SDL_AddAtomicInt(&detect->next_run, 1))
+  {
+    chirp_detect_run(detect, &detect->runs[i]);
+  }
+
+  return 0;
+}
+
+/**
+ * Whether run a did strictly better than run b: not faulting on an error beats faulting on one, then running longer
+ * before halting beats halting early, then more frames that changed the display, then more of the display used.
+ *
+ * Quirks a ROM never exercises leave everything equal, so a profile has to do better to win over one with fewer
+ * quirks.
+ */
+bool chirp_detect_is_better(const ChirpDetectRun* a, const ChirpDetectRun* b)
+{
+  if (chirp_fault_is_error(a->fault) != chirp_fault_is_error(b->fault))
+  {
+    return !chirp_fault_is_error(a->fault);
+  }
+  if (a->halted_at != b->halted_at)
+  {
+    return a->halted_at > b->halted_at;
+  }
+  if (a->changed_frames != b->changed_frames)
+  {
+    return a->changed_frames > b->changed_frames;
+  }
+
+  return a->touched_pixels > b->touched_pixels;
+}
+
+/**
+ * Runs a clone of the instance for the given number of frames with every combination of the quirks that keeps the
+ * given CHIRP_QUIRK_* flags on, all at once on up to one thread per core, and returns the flags of the combination that
+ * did best. The instance is left untouched, so it should be in its post-load state.
+ *
+ * Verbose prints how every combination fared.
+ */
+int chirp_detect_quirks(const Chirp* chirp, const uint64_t frames, const int given, const bool is_verbose)
+{
+  ChirpDetect* detect = calloc(1, sizeof(ChirpDetect));
+  const int capacity = frames / CHIRP_DIFF_INPUT_INTERVAL * 2 + 2;
+  ChirpDiffInput* inputs = malloc(sizeof(ChirpDiffInput) * capacity);
+  if (detect == NULL || inputs == NULL)
+  {
+    fprintf(stderr, "out of memory\n");
+    exit(1);
+  }
+
+  const uint64_t start = SDL_GetPerformanceCounter();
+  detect->frames = frames;
+  detect->inputs = inputs;
+  detect->input_count = chirp_diff_make_inputs(inputs, capacity, frames, CHIRP_RANDOM_SEED);
+  SDL_SetAtomicInt(&detect->next_run, 0);
+
+  // the instances come out of a pool of clones, so they share the boot image and only run on their own configs
+  detect->run_count = CHIRP_DETECT_PROFILES >> chirp_quirks_count(given);
+  ChirpPool* pool = chirp_pool_new(chirp, detect->run_count);
+  int count = 0;
+  for (int enabled = 0; enabled <= CHIRP_QUIRK_COUNT; enabled++)
+  {
+    for (int quirks = 0; quirks < CHIRP_DETECT_PROFILES; quirks++)
+    {
+      if (chirp_quirks_count(quirks) != enabled || (quirks & given) != given)
+      {
+        continue;
+      }
+
+      ChirpDetectRun* run = &detect->runs[count++];
+      run->quirks = quirks;
+      run->config = *chirp->config;
+      run->config.is_debug = false; // sixteen instances logging every instruction at once would be unreadable
+      chirp_quirks_apply(&run->config, quirks);
+      run->chirp = chirp_pool_acquire(pool);
+      run->chirp->config = &run->config;
+    }
+  }
+
+  // the calling thread is one of the workers, so that nothing is lost if no thread can be created
+  const int cores = SDL_GetNumLogicalCPUCores();
+  const int thread_count = cores < 1 ? 1 : cores < detect->run_count ? cores : detect->run_count;
+  SDL_Thread* threads[CHIRP_DETECT_PROFILES];
+  for (int i = 1; i < thread_count; i++)
+  {
+    threads[i] = SDL_CreateThread(chirp_detect_work, "chirp detect", detect);
+  }
+  chirp_detect_work(detect);
+  for (int i = 1; i < thread_count; i++)
+  {
+    if (threads[i] != NULL)
+    {
+      SDL_WaitThread(threads[i], NULL);
+    }
+  }
+
+  const ChirpDetectRun* best = &detect->runs[0];
+  for (int i = 1; i < detect->run_count; i++)
+  {
+    if (chirp_detect_is_better(&detect->runs[i], best))
+    {
+      best = &detect->runs[i];
+    }
+  }
+
+  if (is_verbose)
+  {
+    printf("ran %d quirk profiles for %llu frames on %d threads in %.1fms\n",
+           detect->run_count,
+           (unsigned long long)frames,
+           thread_count,
+           (double)(SDL_GetPerformanceCounter() - start) * 1000.0 / (double)SDL_GetPerformanceFrequency());
+    for (int i = 0; i < detect->run_count; i++)
+    {
+      const ChirpDetectRun* run = &detect->runs[i];
+      char flags[128];
+      chirp_quirks_format(run->quirks, flags, sizeof(flags));
+      printf("%c %-28s frame %5llu  changed %5d  pixels %4d  %s\n",
+             run == best ? '*' : ' ',
+             chirp_fault_name(run->fault),
+             (unsigned long long)run->halted_at,
+             run->changed_frames,
+             run->touched_pixels,
+             flags);
+    }
+  }
+
+  const int quirks = best->quirks;
+  for (int i = 0; i < detect->run_count; i++)
+  {
+    chirp_pool_release(pool, detect->runs[i].chirp);
+  }
+  chirp_pool_free(pool);
+  free(inputs);
+  free(detect);
+
+  return quirks;
+}
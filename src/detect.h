@@ -0,0 +1,45 @@
+#ifndef CHIRP_DETECT_H
+#define CHIRP_DETECT_H
+
+#include "chirp.h"
+#include "diff.h"
+
+// quirk detection for ROMs nobody said anything about: the post-load state is cloned once for every combination of
+// the quirks, each clone runs on its own config for a fixed number of frames on a generated stream of key presses,
+// spread over as many threads as there are cores, and the combination that got furthest wins
+
+#define CHIRP_DETECT_PROFILES 16 // every combination of the CHIRP_QUIRK_* flags, see romdb.h
+#define CHIRP_DETECT_FRAMES 3600 // emulated time each profile gets, a minute
+
+// how one combination of the quirks fared
+typedef struct ChirpDetectRun
+{
+  int quirks; // CHIRP_QUIRK_* flags
+  ChirpConfig config;
+  Chirp* chirp;
+
+  ChirpFault fault;
+  uint64_t halted_at; // frame the profile faulted or spun on itself at, the full run if it never did
+  int changed_frames; // frames the display changed in
+  int touched_pixels; // pixels lit at some point
+  bool touched[DISPLAY_HEIGHT][DISPLAY_WIDTH];
+} ChirpDetectRun;
+
+typedef struct ChirpDetect
+{
+  ChirpDetectRun runs[CHIRP_DETECT_PROFILES]; // in order of how many quirks they turn on, fewest first
+  int run_count;                              // only the combinations with the quirks given on the command line
+  uint64_t frames;
+
+  ChirpDiffInput* inputs; // the same for every profile
+  int input_count;
+
+  SDL_AtomicInt next_run; // first run no thread has taken yet
+} ChirpDetect;
+
+int chirp_detect_quirks(const Chirp* chirp, uint64_t frames, int given, bool is_verbose);
+int chirp_quirks_given(const ChirpConfig* config);
+void chirp_quirks_apply(ChirpConfig* config, int quirks);
+void chirp_quirks_format(int quirks, char* out, size_t size);
+
+#endif // CHIRP_DETECT_H
@@ -0,0 +1,340 @@
+#include "diff.h"
+#include "decode.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// NULL if the instance cannot run on the candidate engine
+ChirpDiff* chirp_diff_new(const Chirp* chirp, const ChirpEngine candidate, const uint64_t interval)
+{
+  if (candidate == CHIRP_ENGINE_AOT && chirp->aot == NULL)
+  {
+    fprintf(stderr, "no ahead-of-time translation attached to compare against\n");
+    return NULL;
+  }
+
+  ChirpDiff* diff = malloc(sizeof(ChirpDiff));
+  if (diff == NULL)
+  {
+    fprintf(stderr, "out of memory\n");
+    exit(1);
+  }
+
+  const ChirpEngine engines[2] = {CHIRP_ENGINE_REFERENCE, candidate};
+  for (int i = 0; i < 2; i++)
+  {
+    ChirpDiffSide* side = &diff->sides[i];
+    side->chirp = chirp_clone(chirp);
+    side->chirp->engine = engines[i];
+    side->checkpoint = chirp_clone(side->chirp);
+    side->next_input = 0;
+    side->checkpoint_next_input = 0;
+    side->trace_size = 0;
+  }
+
+  diff->interval = interval > 0 ? interval : 1;
+  diff->inputs = NULL;
+  diff->input_count = 0;
+  diff->comparisons = 0;
+
+  return diff;
+}
+
+void chirp_diff_free(ChirpDiff* diff)
+{
+  for (int i = 0; i < 2; i++)
+  {
+    chirp_free(diff->sides[i].chirp);
+    chirp_free(diff->sides[i].checkpoint);
+  }
+
+  free(diff);
+}
+
+// the inputs are not copied and must outlive the run
+void chirp_diff_set_inputs(ChirpDiff* diff, const ChirpDiffInput* inputs, const int input_count)
+{
+  diff->inputs = inputs;
+  diff->input_count = input_count;
+}
+
+/**
+ * Fills inputs with a reproducible stream of key presses, one every CHIRP_DIFF_INPUT_INTERVAL frames, so that ROMs
+ * waiting on the keypad make progress. Returns the number of inputs written.
+ */
+int chirp_diff_make_inputs(ChirpDiffInput* inputs, const int capacity, const uint64_t frames, const uint32_t seed)
+{
+  uint32_t state = seed != 0 ? seed : 1;
+  int count = 0;
+
+  for (uint64_t frame = CHIRP_DIFF_INPUT_INTERVAL; frame < frames && count + 2 <= capacity;
+       frame += CHIRP_DIFF_INPUT_INTERVAL)
+  {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+
+    const uint8_t key = state % CHIRP_KEYBOARD_SIZE;
+    inputs[count++] = (ChirpDiffInput){frame, key, true};
+    inputs[count++] = (ChirpDiffInput){frame + CHIRP_DIFF_INPUT_LENGTH, key, false};
+  }
+
+  return count;
+}
+
+// name of the first part of the state the two instances disagree on, NULL if they agree on all of it
+const char* chirp_diff_compare(const Chirp* a, const Chirp* b)
+{
+  if (a->program_counter != b->program_counter)
+  {
+    return "program counter";
+  }
+  if (a->index_register != b->index_register)
+  {
+    return "index register";
+  }
+  if (memcmp(a->registers->registers, b->registers->registers, sizeof(a->registers->registers)) != 0)
+  {
+    return "registers";
+  }
+  if (a->stack->current_size != b->stack->current_size
+      || memcmp(a->stack->stack, b->stack->stack, sizeof(uint16_t) * a->stack->current_size) != 0)
+  {
+    return "stack";
+  }
+  if (a->delay_timer != b->delay_timer)
+  {
+    return "delay timer";
+  }
+  if (a->sound_timer != b->sound_timer)
+  {
+    return "sound timer";
+  }
+  if (memcmp(a->display->display, b->display->display, sizeof(a->display->display)) != 0)
+  {
+    return "display";
+  }
+  if (memcmp(a->mem->mem, b->mem->mem, sizeof(a->mem->mem)) != 0)
+  {
+    return "memory";
+  }
+  if (a->instruction_count != b->instruction_count)
+  {
+    return "instruction count";
+  }
+  if (chirp_cycles(a) != chirp_cycles(b))
+  {
+    return "cycle count";
+  }
+  if (a->frame_count != b->frame_count)
+  {
+    return "frame count";
+  }
+  if (a->idle_wake != b->idle_wake || a->key_wait != b->key_wait)
+  {
+    return "idle state";
+  }
+  if (a->fault != b->fault)
+  {
+    return "fault";
+  }
+
+  return NULL;
+}
+
+// applies the inputs due by the current frame, then runs for up to budget cycles without going past the end of the
+// frame, ticking the timers once it is reached
+void chirp_diff_advance(ChirpDiff* diff, ChirpDiffSide* side, const uint64_t budget)
+{
+  Chirp* chirp = side->chirp;
+
+  while (side->next_input < diff->input_count && diff->inputs[side->next_input].frame <= chirp->frame_count)
+  {
+    const ChirpDiffInput* input = &diff->inputs[side->next_input++];
+    chirp_set_key(chirp, input->key, input->is_pressed);
+  }
+
+  const uint64_t frame_end = chirp_frame_end(chirp);
+  const uint64_t now = chirp_cycles(chirp);
+  if (now < frame_end)
+  {
+    chirp_run(chirp, frame_end - now < budget ? frame_end - now : budget);
+  }
+
+  if (chirp_cycles(chirp) >= frame_end)
+  {
+    chirp_tick_timers(chirp);
+  }
+}
+
+// advances by a single instruction, remembering it for the trace
+void chirp_diff_step(ChirpDiff* diff, ChirpDiffSide* side)
+{
+  Chirp* chirp = side->chirp;
+  const uint64_t instruction_count = chirp->instruction_count;
+  const ChirpDiffTraceEntry entry = {
+    .address = chirp->program_counter,
+    .instruction = chirp_decode_at(chirp->mem->mem, chirp->program_counter),
+  };
+
+  chirp_diff_advance(diff, side, 1);
+
+  if (chirp->instruction_count != instruction_count)
+  {
+    side->trace[side->trace_size % CHIRP_DIFF_TRACE_SIZE] = entry;
+    side->trace_size++;
+  }
+}
+
+void chirp_diff_print_state(const char* name, const Chirp* chirp)
+{
+  printf("%s: pc %03X  I %03X  dt %d  st %d  instructions %llu  cycles %llu  frame %llu  fault %s\n",
+         name,
+         chirp->program_counter,
+         chirp->index_register,
+         chirp->delay_timer,
+         chirp->sound_timer,
+         (unsigned long long)chirp->instruction_count,
+         (unsigned long long)chirp_cycles(chirp),
+         (unsigned long long)chirp->frame_count,
+         chirp_fault_name(chirp->fault));
+
+  printf(" ");
+  for (int i = 0; i < CHIRP_REGISTERS_SIZE; i++)
+  {
+    printf(" V%X %02X", i, chirp->registers->registers[i]);
+  }
+  printf("\n  stack");
+  for (int i = 0; i < chirp->stack->current_size; i++)
+  {
+    printf(" %03X", chirp->stack->stack[i]);
+  }
+  printf("\n  display %016llx  memory %016llx\n",
+         (unsigned long long)chirp_rom_hash((const uint8_t*)chirp->display->display, sizeof(chirp->display->display)),
+         (unsigned long long)chirp_rom_hash(chirp->mem->mem, sizeof(chirp->mem->mem)));
+}
+
+// writes trace entry i of the last CHIRP_DIFF_TRACE_SIZE, or nothing if the side has not run that many
+void chirp_diff_format_trace(const ChirpDiffSide* side, const int i, char* out, const size_t size)
+{
+  const int count = side->trace_size < CHIRP_DIFF_TRACE_SIZE ? side->trace_size : CHIRP_DIFF_TRACE_SIZE;
+  const int first = side->trace_size - count;
+  out[0] = '\0';
+  if (i >= count)
+  {
+    return;
+  }
+
+  const ChirpDiffTraceEntry* entry = &side->trace[(first + i) % CHIRP_DIFF_TRACE_SIZE];
+  const ChirpDecoded decoded = chirp_decode(entry->instruction);
+  char text[32];
+  chirp_disassemble(&decoded, text, sizeof(text));
+  snprintf(out, size, "%03X: %04X  %s", entry->address, entry->instruction, text);
+}
+
+/**
+ * Explains a divergence found at the end of a slice: shows both states as they are, then replays the slice one
+ * instruction at a time from the last checkpoint to find the first instruction after which the engines disagree.
+ *
+ * A slice that diverges when run whole but not one instruction at a time points at the candidate's handling of
+ * longer runs, such as the fall through between translated instructions.
+ */
+void chirp_diff_report(ChirpDiff* diff, const char* field)
+{
+  ChirpDiffSide* reference = &diff->sides[0];
+  ChirpDiffSide* candidate = &diff->sides[1];
+  const char* candidate_name = chirp_engine_name(candidate->chirp->engine);
+
+  printf("engines diverged after %llu comparisons: %s differs\n", (unsigned long long)diff->comparisons, field);
+  chirp_diff_print_state(chirp_engine_name(reference->chirp->engine), reference->chirp);
+  chirp_diff_print_state(candidate_name, candidate->chirp);
+
+  const uint64_t slice_end = chirp_cycles(reference->chirp);
+  for (int i = 0; i < 2; i++)
+  {
+    ChirpDiffSide* side = &diff->sides[i];
+    chirp_copy(side->chirp, side->checkpoint);
+    side->next_input = side->checkpoint_next_input;
+    side->trace_size = 0;
+  }
+
+  const char* first = NULL;
+  while (first == NULL && chirp_cycles(reference->chirp) < slice_end)
+  {
+    chirp_diff_step(diff, reference);
+    chirp_diff_step(diff, candidate);
+    first = chirp_diff_compare(reference->chirp, candidate->chirp);
+
+    // both halted the same way, so time stops for both
+    if (first == NULL && reference->chirp->fault != CHIRP_FAULT_NONE)
+    {
+      break;
+    }
+  }
+
+  if (first == NULL)
+  {
+    printf("\nthe slice agrees when replayed one instruction at a time\n");
+    return;
+  }
+
+  printf("\nfirst divergence, at instruction %llu: %s differs\n",
+         (unsigned long long)reference->chirp->instruction_count,
+         first);
+  printf("  %-32s  %s\n", chirp_engine_name(reference->chirp->engine), candidate_name);
+  for (int i = 0; i < CHIRP_DIFF_TRACE_SIZE; i++)
+  {
+    char left[48];
+    char right[48];
+    chirp_diff_format_trace(reference, i, left, sizeof(left));
+    chirp_diff_format_trace(candidate, i, right, sizeof(right));
+    if (left[0] == '\0' && right[0] == '\0')
+    {
+      break;
+    }
+    printf("  %-32s  %s\n", left, right);
+  }
+
+  chirp_diff_print_state(chirp_engine_name(reference->chirp->engine), reference->chirp);
+  chirp_diff_print_state(candidate_name, candidate->chirp);
+}
+
+/**
+ * Runs both engines for the given number of frames, comparing them after every slice; returns false and reports
+ * the divergence on stdout as soon as they disagree.
+ */
+bool chirp_diff_run(ChirpDiff* diff, const uint64_t frames)
+{
+  ChirpDiffSide* reference = &diff->sides[0];
+  ChirpDiffSide* candidate = &diff->sides[1];
+
+  while (reference->chirp->frame_count < frames)
+  {
+    chirp_diff_advance(diff, reference, diff->interval);
+    chirp_diff_advance(diff, candidate, diff->interval);
+    diff->comparisons++;
+
+    const char* field = chirp_diff_compare(reference->chirp, candidate->chirp);
+    if (field != NULL)
+    {
+      chirp_diff_report(diff, field);
+      return false;
+    }
+
+    // both halted the same way, so nothing else can happen
+    if (reference->chirp->fault != CHIRP_FAULT_NONE)
+    {
+      break;
+    }
+
+    for (int i = 0; i < 2; i++)
+    {
+      ChirpDiffSide* side = &diff->sides[i];
+      chirp_copy(side->checkpoint, side->chirp);
+      side->checkpoint_next_input = side->next_input;
+    }
+  }
+
+  return true;
+}
@@ -0,0 +1,58 @@
+#ifndef CHIRP_DIFF_H
+#define CHIRP_DIFF_H
+
+#include "chirp.h"
+
+// differential testing: the reference engine and a candidate run the same ROM on the same inputs in lockstep, and
+// their whole state is compared at every slice boundary. The first slice they disagree on is replayed one
+// instruction at a time from the last state they agreed on, to find the instruction where they part ways
+
+#define CHIRP_DIFF_TRACE_SIZE 16     // instructions shown before a divergence
+#define CHIRP_DIFF_INPUT_INTERVAL 30 // frames between key presses in generated input streams
+#define CHIRP_DIFF_INPUT_LENGTH 6    // frames each generated key press is held for
+
+// key change applied right before the first slice of a frame
+typedef struct ChirpDiffInput
+{
+  uint64_t frame;
+  uint8_t key;
+  bool is_pressed;
+} ChirpDiffInput;
+
+typedef struct ChirpDiffTraceEntry
+{
+  uint16_t address;
+  uint16_t instruction;
+} ChirpDiffTraceEntry;
+
+// one side of the comparison
+typedef struct ChirpDiffSide
+{
+  Chirp* chirp;
+  Chirp* checkpoint; // last state both sides agreed on, allocated once up front
+  int next_input;    // first input not applied yet
+  int checkpoint_next_input;
+
+  ChirpDiffTraceEntry trace[CHIRP_DIFF_TRACE_SIZE]; // ring of the last instructions, only kept while replaying
+  int trace_size;
+} ChirpDiffSide;
+
+typedef struct ChirpDiff
+{
+  ChirpDiffSide sides[2]; // reference first, then the candidate
+  uint64_t interval;      // cycles in a slice; slices also end with every frame
+
+  const ChirpDiffInput* inputs; // sorted by frame
+  int input_count;
+
+  uint64_t comparisons;
+} ChirpDiff;
+
+ChirpDiff* chirp_diff_new(const Chirp* chirp, ChirpEngine candidate, uint64_t interval);
+void chirp_diff_free(ChirpDiff* diff);
+void chirp_diff_set_inputs(ChirpDiff* diff, const ChirpDiffInput* inputs, int input_count);
+bool chirp_diff_run(ChirpDiff* diff, uint64_t frames);
+const char* chirp_diff_compare(const Chirp* a, const Chirp* b);
+int chirp_diff_make_inputs(ChirpDiffInput* inputs, int capacity, uint64_t frames, uint32_t seed);
+
+#endif // CHIRP_DIFF_H
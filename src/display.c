@@ -1,56 +1,52 @@
 #include "display.h"
-#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
-void check_bounds(const int x, const int y)
+bool check_bounds(const int x, const int y)
 {
-  if (x < 0 || x >= DISPLAY_WIDTH || y < 0 || y >= DISPLAY_HEIGHT)
-  {
-    printf("invalid pixel position: x=%d, y=%d; display size is %d wide, %d tall", x, y, DISPLAY_WIDTH, DISPLAY_HEIGHT);
-    exit(1);
-  }
+  return x >= 0 && x < DISPLAY_WIDTH && y >= 0 && y < DISPLAY_HEIGHT;
 }
 
 ChirpDisplay* chirp_display_new()
 {
   ChirpDisplay* display = (ChirpDisplay*)malloc(sizeof(ChirpDisplay));
-
-  for (int y = 0; y < DISPLAY_HEIGHT; y++)
-  {
-    for (int x = 0; x < DISPLAY_WIDTH; x++)
-    {
-      display->display[y][x] = false;
-    }
-  }
+  display->version = 0;
+  chirp_display_clear(display);
 
   return display;
 }
 
+// out of bounds pixels read as off
 bool chirp_display_get_pixel(const ChirpDisplay* display, const int x, const int y)
 {
-  check_bounds(x, y);
+  if (!check_bounds(x, y)) return false;
   return display->display[y][x];
 }
 
-void chirp_display_set_pixel(ChirpDisplay* display, const int x, const int y, const bool state)
+// returns false without touching the display if the pixel is out of bounds
+bool chirp_display_set_pixel(ChirpDisplay* display, const int x, const int y, const bool state)
 {
-  check_bounds(x, y);
+  if (!check_bounds(x, y)) return false;
   display->display[y][x] = state;
+  display->dirty_rows |= (uint64_t)1 << y;
+  display->version++;
+  return true;
 }
 
-void chirp_display_flip_pixel(ChirpDisplay* display, const int x, const int y)
+// returns false without touching the display if the pixel is out of bounds
+bool chirp_display_flip_pixel(ChirpDisplay* display, const int x, const int y)
 {
-  check_bounds(x, y);
-  display->display[y][x] = !chirp_display_get_pixel(display, x, y);
+  if (!check_bounds(x, y)) return false;
+  display->display[y][x] = !display->display[y][x];
+  display->dirty_rows |= (uint64_t)1 << y;
+  display->version++;
+  return true;
 }
 
 void chirp_display_clear(ChirpDisplay* display)
 {
-  for (int y = 0; y < DISPLAY_HEIGHT; y++)
-  {
-    for (int x = 0; x < DISPLAY_WIDTH; x++)
-    {
-      chirp_display_set_pixel(display, x, y, false);
-    }
-  }
+  // every pixel is in bounds so there's no need to go through chirp_display_set_pixel
+  memset(display->display, 0, sizeof(display->display));
+  display->dirty_rows = CHIRP_DISPLAY_ALL_ROWS;
+  display->version++;
 }
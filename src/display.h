@@ -2,23 +2,29 @@
 #define CHIRP_DISPLAY_H
 
 #include <stdbool.h>
+#include <stdint.h>
 
 #define DISPLAY_WIDTH 64
 #define DISPLAY_HEIGHT 32
-#define UPSCALE_FACTOR 16
+#define UPSCALE_FACTOR 16 // of the window when it opens, it can be resized from there
 
 #define WINDOW_WIDTH (DISPLAY_WIDTH * UPSCALE_FACTOR)
 #define WINDOW_HEIGHT (DISPLAY_HEIGHT * UPSCALE_FACTOR)
 
+// every bit of ChirpDisplay.dirty_rows that stands for a row; there is room for up to 64
+#define CHIRP_DISPLAY_ALL_ROWS ((uint64_t)-1 >> (64 - DISPLAY_HEIGHT))
+
 typedef struct ChirpDisplay
 {
   bool display[DISPLAY_HEIGHT][DISPLAY_WIDTH];
+  uint64_t dirty_rows; // bit y is set once row y is written to, until whoever follows the changes clears it
+  uint64_t version;    // bumped on every write, so that any number of observers can tell whether it changed
 } ChirpDisplay;
 
 ChirpDisplay* chirp_display_new();
 bool chirp_display_get_pixel(const ChirpDisplay* display, int x, int y);
-void chirp_display_set_pixel(ChirpDisplay* display, int x, int y, bool state);
-void chirp_display_flip_pixel(ChirpDisplay* display, int x, int y);
+bool chirp_display_set_pixel(ChirpDisplay* display, int x, int y, bool state);
+bool chirp_display_flip_pixel(ChirpDisplay* display, int x, int y);
 void chirp_display_clear(ChirpDisplay* display);
 
 #endif // CHIRP_DISPLAY_H
@@ -0,0 +1,782 @@
+// sockets and poll are POSIX, outside of what -std=c11 exposes
+#define _POSIX_C_SOURCE 200809L
+
+#include "gdbstub.h"
+#include "idle.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#define CHIRP_GDB_SIGINT 2
+#define CHIRP_GDB_SIGILL 4
+#define CHIRP_GDB_SIGTRAP 5
+#define CHIRP_GDB_SIGSEGV 11
+
+// the core is not an architecture gdb knows about, so describe its registers
+static const char CHIRP_GDB_TARGET_XML[] =
+  "<?xml version=\"1.0\"?>"
+  "<!DOCTYPE target SYSTEM \"gdb-target.dtd\">"
+  "<target version=\"1.0\">"
+  "<feature name=\"org.chirp.chip8\">"
+  "<reg name=\"v0\" bitsize=\"8\" type=\"uint8\"/>"
+  "<reg name=\"v1\" bitsize=\"8\" type=\"uint8\"/>"
+  "<reg name=\"v2\" bitsize=\"8\" type=\"uint8\"/>"
+  "<reg name=\"v3\" bitsize=\"8\" type=\"uint8\"/>"
+  "<reg name=\"v4\" bitsize=\"8\" type=\"uint8\"/>"
+  "<reg name=\"v5\" bitsize=\"8\" type=\"uint8\"/>"
+  "<reg name=\"v6\" bitsize=\"8\" type=\"uint8\"/>"
+  "<reg name=\"v7\" bitsize=\"8\" type=\"uint8\"/>"
+  "<reg name=\"v8\" bitsize=\"8\" type=\"uint8\"/>"
+  "<reg name=\"v9\" bitsize=\"8\" type=\"uint8\"/>"
+  "<reg name=\"va\" bitsize=\"8\" type=\"uint8\"/>"
+  "<reg name=\"vb\" bitsize=\"8\" type=\"uint8\"/>"
+  "<reg name=\"vc\" bitsize=\"8\" type=\"uint8\"/>"
+  "<reg name=\"vd\" bitsize=\"8\" type=\"uint8\"/>"
+  "<reg name=\"ve\" bitsize=\"8\" type=\"uint8\"/>"
+  "<reg name=\"vf\" bitsize=\"8\" type=\"uint8\"/>"
+  "<reg name=\"i\" bitsize=\"16\" type=\"data_ptr\"/>"
+  "<reg name=\"pc\" bitsize=\"16\" type=\"code_ptr\"/>"
+  "<reg name=\"sp\" bitsize=\"8\" type=\"uint8\"/>"
+  "</feature>"
+  "</target>";
+
+static const char CHIRP_GDB_HEX[] = "0123456789abcdef";
+
+int chirp_gdb_hex_value(const char c)
+{
+  if (c >= '0' && c <= '9')
+  {
+    return c - '0';
+  }
+  if (c >= 'a' && c <= 'f')
+  {
+    return c - 'a' + 10;
+  }
+  if (c >= 'A' && c <= 'F')
+  {
+    return c - 'A' + 10;
+  }
+  return -1;
+}
+
+// parses hex digits up to the first non-hex character, which is returned through end
+uint32_t chirp_gdb_parse_hex(const char* text, const char** end)
+{
+  uint32_t value = 0;
+  int digit;
+
+  while ((digit = chirp_gdb_hex_value(*text)) >= 0)
+  {
+    value = value << 4 | (uint32_t)digit;
+    text++;
+  }
+
+  if (end != NULL)
+  {
+    *end = text;
+  }
+  return value;
+}
+
+char* chirp_gdb_write_byte(char* out, const uint8_t value)
+{
+  *out++ = CHIRP_GDB_HEX[value >> 4];
+  *out++ = CHIRP_GDB_HEX[value & 0xF];
+  return out;
+}
+
+// values wider than a byte go over the wire in target order, which gdb assumes is little endian here
+char* chirp_gdb_write_value(char* out, const uint32_t value, const int bytes)
+{
+  for (int i = 0; i < bytes; i++)
+  {
+    out = chirp_gdb_write_byte(out, (value >> (8 * i)) & 0xFF);
+  }
+  return out;
+}
+
+uint32_t chirp_gdb_read_value(const char* text, const int bytes)
+{
+  uint32_t value = 0;
+
+  for (int i = 0; i < bytes; i++)
+  {
+    const int high = chirp_gdb_hex_value(text[2 * i]);
+    const int low = chirp_gdb_hex_value(text[2 * i + 1]);
+    value |= (uint32_t)((high << 4 | low) & 0xFF) << (8 * i);
+  }
+  return value;
+}
+
+void chirp_gdb_set_non_blocking(const int fd)
+{
+  fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+}
+
+// listens on a loopback TCP port when the address is a number, on a Unix socket at that path otherwise
+ChirpGdbStub* chirp_gdb_new(Chirp* chirp, const char* address)
+{
+  char* end;
+  const long port = strtol(address, &end, 10);
+  const bool is_port = *address != '\0' && *end == '\0';
+
+  int fd;
+  if (is_port)
+  {
+    if (port <= 0 || port > 65535)
+    {
+      fprintf(stderr, "invalid gdb port %s\n", address);
+      return NULL;
+    }
+
+    fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0)
+    {
+      perror("gdb socket");
+      return NULL;
+    }
+
+    const int reuse = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((uint16_t)port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK); // never reachable from another machine
+
+    if (bind(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0)
+    {
+      perror("gdb bind");
+      close(fd);
+      return NULL;
+    }
+  }
+  else
+  {
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (strlen(address) >= sizeof(addr.sun_path))
+    {
+      fprintf(stderr, "gdb socket path too long\n");
+      return NULL;
+    }
+    strcpy(addr.sun_path, address);
+
+    fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0)
+    {
+      perror("gdb socket");
+      return NULL;
+    }
+
+    unlink(address);
+    if (bind(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0)
+    {
+      perror("gdb bind");
+      close(fd);
+      return NULL;
+    }
+  }
+
+  if (listen(fd, 1) < 0)
+  {
+    perror("gdb listen");
+    close(fd);
+    return NULL;
+  }
+  chirp_gdb_set_non_blocking(fd);
+
+  ChirpGdbStub* stub = malloc(sizeof(ChirpGdbStub));
+  if (stub == NULL)
+  {
+    fprintf(stderr, "out of memory\n");
+    exit(1);
+  }
+
+  memset(stub, 0, sizeof(ChirpGdbStub));
+  stub->chirp = chirp;
+  stub->listen_fd = fd;
+  stub->client_fd = -1;
+  stub->path = is_port ? NULL : address;
+  stub->checksum_digits = -1;
+
+  // like gdbserver, nothing runs until a client has had a chance to look at the machine
+  stub->is_stopped = true;
+
+  return stub;
+}
+
+bool chirp_gdb_has_breakpoint(const ChirpGdbStub* stub, const uint16_t address)
+{
+  return (stub->breakpoints[(address & 0x0FFF) >> 6] >> (address & 63) & 1) != 0;
+}
+
+// hands the machine the breakpoints to stop at, or nothing to test at all once there are none
+void chirp_gdb_attach_breakpoints(ChirpGdbStub* stub)
+{
+  stub->chirp->breakpoints = stub->breakpoint_count > 0 ? stub->breakpoints : NULL;
+}
+
+void chirp_gdb_set_breakpoint(ChirpGdbStub* stub, const uint16_t address, const bool is_set)
+{
+  if (chirp_gdb_has_breakpoint(stub, address) == is_set)
+  {
+    return;
+  }
+
+  // a machine parked on an idle loop would never reach a breakpoint put inside of it
+  chirp_idle_catch_up(stub->chirp);
+  chirp_idle_clear(stub->chirp);
+
+  stub->breakpoints[address >> 6] ^= (uint64_t)1 << (address & 63);
+  stub->breakpoint_count += is_set ? 1 : -1;
+  chirp_gdb_attach_breakpoints(stub);
+}
+
+void chirp_gdb_remove_breakpoints(ChirpGdbStub* stub)
+{
+  memset(stub->breakpoints, 0, sizeof(stub->breakpoints));
+  stub->breakpoint_count = 0;
+  chirp_gdb_attach_breakpoints(stub);
+}
+
+void chirp_gdb_close_client(ChirpGdbStub* stub)
+{
+  if (stub->client_fd >= 0)
+  {
+    close(stub->client_fd);
+    stub->client_fd = -1;
+  }
+
+  // a detached ROM runs on as if no debugger had ever been there
+  chirp_gdb_remove_breakpoints(stub);
+  stub->is_stopped = false;
+  stub->is_in_packet = false;
+  stub->packet_size = 0;
+  stub->checksum_digits = -1;
+}
+
+void chirp_gdb_free(ChirpGdbStub* stub)
+{
+  chirp_gdb_close_client(stub);
+  close(stub->listen_fd);
+  if (stub->path != NULL)
+  {
+    unlink(stub->path);
+  }
+  free(stub);
+}
+
+void chirp_gdb_send_raw(ChirpGdbStub* stub, const char* data, const size_t size)
+{
+  size_t sent = 0;
+
+  while (sent < size && stub->client_fd >= 0)
+  {
+    const ssize_t result = send(stub->client_fd, data + sent, size - sent, 0);
+    if (result > 0)
+    {
+      sent += (size_t)result;
+    }
+    else if (result < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+    {
+      // replies are small, so waiting for the socket to drain only happens with a stalled client
+      struct pollfd pfd = {.fd = stub->client_fd, .events = POLLOUT};
+      poll(&pfd, 1, 100);
+    }
+    else
+    {
+      chirp_gdb_close_client(stub);
+    }
+  }
+}
+
+void chirp_gdb_send(ChirpGdbStub* stub, const char* data)
+{
+  char packet[CHIRP_GDB_PACKET_SIZE + 4];
+  const size_t size = strlen(data);
+  uint8_t checksum = 0;
+
+  packet[0] = '$';
+  for (size_t i = 0; i < size; i++)
+  {
+    packet[i + 1] = data[i];
+    checksum += (uint8_t)data[i];
+  }
+  packet[size + 1] = '#';
+  chirp_gdb_write_byte(&packet[size + 2], checksum);
+
+  chirp_gdb_send_raw(stub, packet, size + 4);
+}
+
+int chirp_gdb_fault_signal(const ChirpFault fault)
+{
+  switch (fault)
+  {
+  case CHIRP_FAULT_NONE:
+  case CHIRP_FAULT_INFINITE_LOOP:
+  case CHIRP_FAULT_TRAP:
+    return CHIRP_GDB_SIGTRAP;
+  case CHIRP_FAULT_INVALID_INSTRUCTION:
+    return CHIRP_GDB_SIGILL;
+  default:
+    return CHIRP_GDB_SIGSEGV;
+  }
+}
+
+void chirp_gdb_stop(ChirpGdbStub* stub, const int signal)
+{
+  char reply[4];
+  reply[0] = 'S';
+  chirp_gdb_write_byte(&reply[1], (uint8_t)signal);
+  reply[3] = '\0';
+
+  stub->is_stopped = true;
+  chirp_gdb_send(stub, reply);
+}
+
+// runs the instruction at the PC, even when there is a breakpoint on it that would stop it before it starts
+void chirp_gdb_step(ChirpGdbStub* stub)
+{
+  stub->chirp->breakpoints = NULL;
+  chirp_step(stub->chirp);
+  chirp_gdb_attach_breakpoints(stub);
+}
+
+uint32_t chirp_gdb_read_register(const Chirp* chirp, const int number)
+{
+  if (number < CHIRP_REGISTERS_SIZE)
+  {
+    return chirp_registers_read(chirp->registers, number);
+  }
+
+  switch (number)
+  {
+  case CHIRP_GDB_REGISTER_I:
+    return chirp->index_register;
+  case CHIRP_GDB_REGISTER_PC:
+    return chirp->program_counter;
+  default:
+    return chirp->stack->current_size;
+  }
+}
+
+int chirp_gdb_register_size(const int number)
+{
+  return number == CHIRP_GDB_REGISTER_I || number == CHIRP_GDB_REGISTER_PC ? 2 : 1;
+}
+
+// the stack pointer can only move within the entries already pushed, since the rest hold no return addresses
+bool chirp_gdb_write_register(Chirp* chirp, const int number, const uint32_t value)
+{
+  if (number < CHIRP_REGISTERS_SIZE)
+  {
+    chirp_registers_write(chirp->registers, number, (uint8_t)value);
+    return true;
+  }
+
+  switch (number)
+  {
+  case CHIRP_GDB_REGISTER_I:
+    chirp->index_register = (uint16_t)value;
+    return true;
+  case CHIRP_GDB_REGISTER_PC:
+    chirp->program_counter = (uint16_t)value & 0x0FFF;
+    return true;
+  case CHIRP_GDB_REGISTER_SP:
+    if (value > chirp->stack->current_size)
+    {
+      return false;
+    }
+    chirp->stack->current_size = (uint8_t)value;
+    chirp->stack->ptr = (uint8_t)value;
+    return true;
+  default:
+    return false;
+  }
+}
+
+void chirp_gdb_read_features(ChirpGdbStub* stub, const char* args)
+{
+  // qXfer:features:read:target.xml:offset,length
+  const char* annex = "target.xml:";
+  if (strncmp(args, annex, strlen(annex)) != 0)
+  {
+    chirp_gdb_send(stub, "E00");
+    return;
+  }
+
+  const char* cursor;
+  const uint32_t offset = chirp_gdb_parse_hex(args + strlen(annex), &cursor);
+  uint32_t length = *cursor == ',' ? chirp_gdb_parse_hex(cursor + 1, NULL) : 0;
+  const uint32_t total = sizeof(CHIRP_GDB_TARGET_XML) - 1;
+
+  if (offset >= total)
+  {
+    chirp_gdb_send(stub, "l");
+    return;
+  }
+
+  if (length > CHIRP_GDB_PACKET_SIZE - 2)
+  {
+    length = CHIRP_GDB_PACKET_SIZE - 2;
+  }
+  if (length > total - offset)
+  {
+    length = total - offset;
+  }
+
+  char reply[CHIRP_GDB_PACKET_SIZE];
+  reply[0] = offset + length < total ? 'm' : 'l';
+  memcpy(&reply[1], CHIRP_GDB_TARGET_XML + offset, length);
+  reply[length + 1] = '\0';
+  chirp_gdb_send(stub, reply);
+}
+
+void chirp_gdb_handle_packet(ChirpGdbStub* stub, const char* packet)
+{
+  Chirp* chirp = stub->chirp;
+  char reply[CHIRP_GDB_PACKET_SIZE];
+  const char* cursor;
+
+  switch (packet[0])
+  {
+  case '?':
+    chirp_gdb_stop(stub, chirp_gdb_fault_signal(chirp->fault));
+    return;
+
+  case 'g':
+  {
+    char* out = reply;
+    for (int i = 0; i < CHIRP_GDB_REGISTER_COUNT; i++)
+    {
+      out = chirp_gdb_write_value(out, chirp_gdb_read_register(chirp, i), chirp_gdb_register_size(i));
+    }
+    *out = '\0';
+    chirp_gdb_send(stub, reply);
+    return;
+  }
+
+  case 'G':
+  {
+    const char* in = packet + 1;
+    for (int i = 0; i < CHIRP_GDB_REGISTER_COUNT && strlen(in) >= (size_t)(2 * chirp_gdb_register_size(i)); i++)
+    {
+      chirp_gdb_write_register(chirp, i, chirp_gdb_read_value(in, chirp_gdb_register_size(i)));
+      in += 2 * chirp_gdb_register_size(i);
+    }
+    chirp_gdb_send(stub, "OK");
+    return;
+  }
+
+  case 'p':
+  {
+    const int number = (int)chirp_gdb_parse_hex(packet + 1, NULL);
+    if (number >= CHIRP_GDB_REGISTER_COUNT)
+    {
+      chirp_gdb_send(stub, "E00");
+      return;
+    }
+    *chirp_gdb_write_value(reply, chirp_gdb_read_register(chirp, number), chirp_gdb_register_size(number)) = '\0';
+    chirp_gdb_send(stub, reply);
+    return;
+  }
+
+  case 'P':
+  {
+    const int number = (int)chirp_gdb_parse_hex(packet + 1, &cursor);
+    if (number >= CHIRP_GDB_REGISTER_COUNT || *cursor != '=' ||
+        !chirp_gdb_write_register(chirp, number, chirp_gdb_read_value(cursor + 1, chirp_gdb_register_size(number))))
+    {
+      chirp_gdb_send(stub, "E00");
+      return;
+    }
+    chirp_gdb_send(stub, "OK");
+    return;
+  }
+
+  case 'm':
+  {
+    const uint32_t address = chirp_gdb_parse_hex(packet + 1, &cursor);
+    uint32_t length = *cursor == ',' ? chirp_gdb_parse_hex(cursor + 1, NULL) : 0;
+    if (length > (CHIRP_GDB_PACKET_SIZE - 1) / 2)
+    {
+      length = (CHIRP_GDB_PACKET_SIZE - 1) / 2;
+    }
+    if (address >= CHIRP_MEMORY_SIZE)
+    {
+      chirp_gdb_send(stub, "E01");
+      return;
+    }
+    if (length > CHIRP_MEMORY_SIZE - address)
+    {
+      length = CHIRP_MEMORY_SIZE - address;
+    }
+
+    char* out = reply;
+    for (uint32_t i = 0; i < length; i++)
+    {
+      out = chirp_gdb_write_byte(out, chirp_mem_read(chirp->mem, (uint16_t)(address + i)));
+    }
+    *out = '\0';
+    chirp_gdb_send(stub, reply);
+    return;
+  }
+
+  case 'M':
+  {
+    const uint32_t address = chirp_gdb_parse_hex(packet + 1, &cursor);
+    const uint32_t length = *cursor == ',' ? chirp_gdb_parse_hex(cursor + 1, &cursor) : 0;
+    if (*cursor != ':' || address + length > CHIRP_MEMORY_SIZE || strlen(cursor + 1) < 2 * length)
+    {
+      chirp_gdb_send(stub, "E01");
+      return;
+    }
+
+    for (uint32_t i = 0; i < length; i++)
+    {
+      chirp_mem_write(chirp->mem, (uint16_t)(address + i), (uint8_t)chirp_gdb_read_value(cursor + 1 + 2 * i, 1));
+    }
+    chirp_gdb_send(stub, "OK");
+    return;
+  }
+
+  case 'c':
+    if (packet[1] != '\0')
+    {
+      chirp->program_counter = (uint16_t)chirp_gdb_parse_hex(packet + 1, NULL) & 0x0FFF;
+    }
+
+    // a halted machine can only report the same halt again
+    if (chirp->fault != CHIRP_FAULT_NONE)
+    {
+      chirp_gdb_stop(stub, chirp_gdb_fault_signal(chirp->fault));
+      return;
+    }
+
+    // the breakpoint the machine is sitting on would fire straight away, so get past it first
+    if (chirp_gdb_has_breakpoint(stub, chirp->program_counter))
+    {
+      chirp_gdb_step(stub);
+    }
+
+    stub->is_stopped = false;
+    return;
+
+  case 's':
+    if (packet[1] != '\0')
+    {
+      chirp->program_counter = (uint16_t)chirp_gdb_parse_hex(packet + 1, NULL) & 0x0FFF;
+    }
+
+    chirp_gdb_step(stub);
+    chirp_gdb_stop(stub, chirp_gdb_fault_signal(chirp->fault));
+    return;
+
+  case 'Z':
+  case 'z':
+  {
+    // only software breakpoints (type 0) exist; watchpoints would need every write checked
+    if (packet[1] != '0' || packet[2] != ',')
+    {
+      chirp_gdb_send(stub, "");
+      return;
+    }
+
+    const uint16_t address = (uint16_t)chirp_gdb_parse_hex(packet + 3, NULL) & 0x0FFF;
+    chirp_gdb_set_breakpoint(stub, address, packet[0] == 'Z');
+
+    chirp_gdb_send(stub, "OK");
+    return;
+  }
+
+  case 'D':
+    chirp_gdb_send(stub, "OK");
+    chirp_gdb_close_client(stub);
+    return;
+
+  case 'k':
+    chirp->is_running = false;
+    chirp_gdb_close_client(stub);
+    return;
+
+  case 'H':
+    chirp_gdb_send(stub, "OK");
+    return;
+
+  case 'q':
+    if (strncmp(packet, "qSupported", 10) == 0)
+    {
+      snprintf(reply, sizeof(reply), "PacketSize=%x;qXfer:features:read+", CHIRP_GDB_PACKET_SIZE);
+      chirp_gdb_send(stub, reply);
+    }
+    else if (strncmp(packet, "qXfer:features:read:", 20) == 0)
+    {
+      chirp_gdb_read_features(stub, packet + 20);
+    }
+    else if (strcmp(packet, "qAttached") == 0)
+    {
+      chirp_gdb_send(stub, "1");
+    }
+    else if (strcmp(packet, "qC") == 0)
+    {
+      chirp_gdb_send(stub, "QC1");
+    }
+    else if (strcmp(packet, "qfThreadInfo") == 0)
+    {
+      chirp_gdb_send(stub, "m1");
+    }
+    else if (strcmp(packet, "qsThreadInfo") == 0)
+    {
+      chirp_gdb_send(stub, "l");
+    }
+    else
+    {
+      chirp_gdb_send(stub, "");
+    }
+    return;
+
+  default:
+    // an empty reply tells the client the packet is not supported
+    chirp_gdb_send(stub, "");
+    return;
+  }
+}
+
+// feeds received bytes through the packet framing, acknowledging and handling every complete packet
+void chirp_gdb_receive(ChirpGdbStub* stub, const char* data, const ssize_t size)
+{
+  for (ssize_t i = 0; i < size && stub->client_fd >= 0; i++)
+  {
+    const char c = data[i];
+
+    if (stub->checksum_digits >= 0)
+    {
+      if (stub->checksum_digits++ == 0)
+      {
+        stub->checksum_high = c;
+        continue;
+      }
+
+      const uint8_t expected = (uint8_t)(chirp_gdb_hex_value(stub->checksum_high) << 4 | chirp_gdb_hex_value(c));
+      uint8_t checksum = 0;
+      for (int j = 0; j < stub->packet_size; j++)
+      {
+        checksum += (uint8_t)stub->packet[j];
+      }
+
+      stub->packet[stub->packet_size] = '\0';
+      stub->is_in_packet = false;
+      stub->checksum_digits = -1;
+      stub->packet_size = 0;
+
+      if (checksum != expected)
+      {
+        chirp_gdb_send_raw(stub, "-", 1);
+        continue;
+      }
+
+      chirp_gdb_send_raw(stub, "+", 1);
+      chirp_gdb_handle_packet(stub, stub->packet);
+    }
+    else if (c == '$')
+    {
+      stub->is_in_packet = true;
+      stub->packet_size = 0;
+    }
+    else if (!stub->is_in_packet)
+    {
+      // ctrl-c from the client; acks need no answer since every reply is sent only once
+      if (c == 0x03 && !stub->is_stopped)
+      {
+        chirp_gdb_stop(stub, CHIRP_GDB_SIGINT);
+      }
+    }
+    else if (c == '#')
+    {
+      stub->checksum_digits = 0;
+    }
+    else if (stub->packet_size < CHIRP_GDB_PACKET_SIZE - 1)
+    {
+      stub->packet[stub->packet_size++] = c;
+    }
+  }
+}
+
+/**
+ * Services the connection without ever blocking: accepts a client if none is connected, handles every packet that
+ * has arrived, and tells the client when the machine it resumed has halted.
+ *
+ * A trap at one of the stub's breakpoints is undone right here, so the ROM sees the breakpoint as the stop it is and
+ * not as a fault.
+ */
+void chirp_gdb_poll(ChirpGdbStub* stub)
+{
+  Chirp* chirp = stub->chirp;
+
+  if (stub->client_fd < 0)
+  {
+    const int fd = accept(stub->listen_fd, NULL, NULL);
+    if (fd < 0)
+    {
+      return;
+    }
+
+    chirp_gdb_set_non_blocking(fd);
+    stub->client_fd = fd;
+    stub->is_stopped = true;
+  }
+
+  char buffer[CHIRP_GDB_PACKET_SIZE];
+  while (stub->client_fd >= 0)
+  {
+    const ssize_t size = recv(stub->client_fd, buffer, sizeof(buffer), 0);
+    if (size > 0)
+    {
+      chirp_gdb_receive(stub, buffer, size);
+    }
+    else if (size == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR))
+    {
+      chirp_gdb_close_client(stub);
+    }
+    else
+    {
+      break;
+    }
+  }
+
+  if (chirp->fault == CHIRP_FAULT_TRAP && chirp_gdb_has_breakpoint(stub, chirp->fault_address))
+  {
+    chirp_resume_from_trap(chirp);
+    chirp_gdb_stop(stub, CHIRP_GDB_SIGTRAP);
+  }
+  else if (chirp->fault != CHIRP_FAULT_NONE && stub->client_fd >= 0 && !stub->is_stopped)
+  {
+    chirp_gdb_stop(stub, chirp_gdb_fault_signal(chirp->fault));
+  }
+}
+
+// blocks until the client sends something or the timeout runs out, for hosts with nothing else to do while stopped
+void chirp_gdb_wait(ChirpGdbStub* stub, const int timeout_ms)
+{
+  struct pollfd pfd = {
+    .fd = stub->client_fd >= 0 ? stub->client_fd : stub->listen_fd,
+    .events = POLLIN,
+  };
+  poll(&pfd, 1, timeout_ms);
+}
+
+bool chirp_gdb_is_stopped(const ChirpGdbStub* stub)
+{
+  return stub->is_stopped;
+}
@@ -0,0 +1,45 @@
+#ifndef CHIRP_GDBSTUB_H
+#define CHIRP_GDBSTUB_H
+
+#include "chirp.h"
+
+// GDB remote serial protocol stub, see https://sourceware.org/gdb/current/onlinedocs/gdb.html/Remote-Protocol.html
+//
+// the stub never blocks: the host polls it between batches of instructions, and breakpoints are bits chirp_step tests
+// before running an instruction, so memory stays exactly as the ROM left it; without any there is nothing to test
+
+#define CHIRP_GDB_PACKET_SIZE 1024
+
+// registers in the order g and G send them: V0 to VF, then I, PC and SP
+#define CHIRP_GDB_REGISTER_I 16
+#define CHIRP_GDB_REGISTER_PC 17
+#define CHIRP_GDB_REGISTER_SP 18
+#define CHIRP_GDB_REGISTER_COUNT 19
+
+struct ChirpGdbStub
+{
+  Chirp* chirp;
+
+  int listen_fd;
+  int client_fd;    // -1 until a client connects
+  const char* path; // Unix socket path to remove on exit; NULL when listening on a TCP port
+  bool is_stopped;  // the client is looking at the machine, so it must not run
+
+  // packet being received, $data#checksum
+  bool is_in_packet; // outside of packets the client only sends acks and interrupts
+  char packet[CHIRP_GDB_PACKET_SIZE];
+  int packet_size;
+  int checksum_digits; // checksum characters read so far after the #; -1 while still reading data
+  char checksum_high;  // first checksum character, which can arrive in a different read than the second
+
+  uint64_t breakpoints[CHIRP_MEMORY_SIZE / 64]; // one bit per address with a breakpoint, see Chirp
+  int breakpoint_count;
+};
+
+ChirpGdbStub* chirp_gdb_new(Chirp* chirp, const char* address);
+void chirp_gdb_free(ChirpGdbStub* stub);
+void chirp_gdb_poll(ChirpGdbStub* stub);
+void chirp_gdb_wait(ChirpGdbStub* stub, int timeout_ms);
+bool chirp_gdb_is_stopped(const ChirpGdbStub* stub);
+
+#endif // CHIRP_GDBSTUB_H
@@ -0,0 +1,143 @@
+#include "idle.h"
+#include "chirp.h"
+#include "log.h"
+
+#include <string.h>
+
+void chirp_idle_snapshot(Chirp* chirp, const uint16_t jump_address)
+{
+  ChirpIdleLoop* loop = &chirp->loop;
+
+  loop->jump_address = jump_address;
+  loop->effects = 0;
+  loop->reached_at = chirp->cycle_count;
+  loop->reached_at_instruction = chirp->instruction_count;
+  memcpy(loop->registers, chirp->registers->registers, sizeof(loop->registers));
+  loop->index_register = chirp->index_register;
+  loop->delay_timer = chirp->delay_timer;
+  loop->stack_size = chirp->stack->current_size;
+  memcpy(loop->stack, chirp->stack->stack, sizeof(uint16_t) * chirp->stack->current_size);
+}
+
+bool chirp_idle_is_unchanged(const Chirp* chirp)
+{
+  const ChirpIdleLoop* loop = &chirp->loop;
+
+  return loop->index_register == chirp->index_register
+    && loop->delay_timer == chirp->delay_timer
+    && loop->stack_size == chirp->stack->current_size
+    && memcmp(loop->registers, chirp->registers->registers, sizeof(loop->registers)) == 0
+    && memcmp(loop->stack, chirp->stack->stack, sizeof(uint16_t) * loop->stack_size) == 0;
+}
+
+/**
+ * Called by 1NNN whenever it jumps backwards, before the program counter is moved to NNN.
+ *
+ * If a full pass through the loop had no side effects and left the registers, index, delay timer and stack exactly as
+ * they were, then every following pass will do the same until something outside the CPU changes. Depending on what the
+ * loop read, that is the next timer tick, the next key change, or never.
+ */
+void chirp_idle_on_backward_jump(Chirp* chirp, const uint16_t nnn)
+{
+  const ChirpIdleLoop* loop = &chirp->loop;
+  const uint16_t jump_address = chirp->program_counter - 2;
+
+  // already parked on this loop, which only happens while catching up on it
+  if (chirp->idle_wake != 0)
+  {
+    return;
+  }
+
+  if (loop->jump_address != jump_address
+    || (loop->effects & CHIRP_LOOP_SIDE_EFFECT) != 0
+    || !chirp_idle_is_unchanged(chirp))
+  {
+    chirp_idle_snapshot(chirp, jump_address);
+    return;
+  }
+
+  uint8_t wake = 0;
+  if ((loop->effects & CHIRP_LOOP_READ_DELAY) != 0 && chirp->delay_timer > 0)
+  {
+    wake |= CHIRP_WAKE_TIMER;
+  }
+  if ((loop->effects & CHIRP_LOOP_READ_KEYS) != 0)
+  {
+    wake |= CHIRP_WAKE_KEY;
+  }
+
+  if (wake == 0)
+  {
+    chirp_raise_fault(chirp, CHIRP_FAULT_INFINITE_LOOP, 0x1000 | nnn);
+    return;
+  }
+
+  CHIRP_INFO(chirp,
+             "[idle] loop at %04X waits on%s%s\n",
+             jump_address,
+             (wake & CHIRP_WAKE_TIMER) != 0 ? " timer" : "",
+             (wake & CHIRP_WAKE_KEY) != 0 ? " keys" : "");
+
+  chirp_idle_wait(
+    chirp,
+    wake,
+    chirp->cycle_count - loop->reached_at,
+    chirp->instruction_count - loop->reached_at_instruction);
+}
+
+// parks the machine at the start of a loop that repeats every given cycles and instructions, until one of the wake
+// events happens; a loop of 0 instructions means the machine is blocked rather than spinning
+void chirp_idle_wait(Chirp* chirp, const uint8_t wake, const uint64_t cycles, const uint64_t instructions)
+{
+  chirp->idle_wake = wake;
+  chirp->loop.cycles = cycles;
+  chirp->loop.instructions = instructions;
+  chirp->loop.skipped = 0;
+}
+
+/**
+ * Brings a parked machine to exactly where it would be had it kept spinning through the loop.
+ *
+ * Whole passes through the loop change nothing, so only the partial pass at the end has to be executed. This must
+ * happen right before an external event so that the loop observes the event at the same point as it would have.
+ */
+void chirp_idle_catch_up(Chirp* chirp)
+{
+  ChirpIdleLoop* loop = &chirp->loop;
+  if (loop->skipped == 0)
+  {
+    return;
+  }
+
+  const uint64_t partial = loop->skipped % loop->cycles;
+  const uint64_t passes = loop->skipped / loop->cycles;
+  chirp->cycle_count += passes * loop->cycles;
+  chirp->instruction_count += passes * loop->instructions;
+  loop->skipped = 0;
+
+  // chirp_step would skip these since the machine is still parked
+  const uint64_t end = chirp->cycle_count + partial;
+  while (loop->instructions > 0 && chirp->cycle_count < end)
+  {
+    chirp_execute_next(chirp);
+  }
+  if (chirp->cycle_count < end)
+  {
+    chirp->cycle_count = end;
+  }
+}
+
+void chirp_idle_wake(Chirp* chirp, const uint8_t event)
+{
+  if ((chirp->idle_wake & event) != 0)
+  {
+    chirp_idle_clear(chirp);
+  }
+}
+
+void chirp_idle_clear(Chirp* chirp)
+{
+  chirp->idle_wake = 0;
+  chirp->loop.jump_address = 0;
+  chirp->loop.skipped = 0;
+}
@@ -0,0 +1,15 @@
+#ifndef CHIRP_IDLE_H
+#define CHIRP_IDLE_H
+
+#include "chirp_t.h"
+
+// detects loops that can only be left through an external event (timer tick or key change) so the
+// machine can skip straight to that event instead of spinning through the loop
+
+void chirp_idle_on_backward_jump(Chirp* chirp, uint16_t nnn);
+void chirp_idle_wait(Chirp* chirp, uint8_t wake, uint64_t cycles, uint64_t instructions);
+void chirp_idle_catch_up(Chirp* chirp);
+void chirp_idle_wake(Chirp* chirp, uint8_t event);
+void chirp_idle_clear(Chirp* chirp);
+
+#endif // CHIRP_IDLE_H
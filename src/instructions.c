@@ -1,7 +1,10 @@
 #include <stdlib.h>
 
 #include "instructions.h"
+#include "chirp.h"
 #include "display.h"
+#include "idle.h"
+#include "log.h"
 
 /**
  * Instruction: 00E0
@@ -10,13 +13,11 @@
  */
 void clear_display(Chirp* chirp)
 {
-  if (chirp->config->is_debug)
-  {
-    SDL_Log("[00E0] clearing display\n");
-  }
+  CHIRP_TRACE(chirp, "[00E0] clearing display\n");
 
   chirp_display_clear(chirp->display);
   chirp->need_draw_screen = true;
+  chirp->loop.effects |= CHIRP_LOOP_SIDE_EFFECT;
 }
 
 /**
@@ -36,11 +37,9 @@ void draw(Chirp* chirp, const int x, const int y, const uint8_t n)
 
   // set VF = 0
   chirp_registers_write(chirp->registers, 0xF, 0);
+  chirp->loop.effects |= CHIRP_LOOP_SIDE_EFFECT;
 
-  if (chirp->config->is_debug)
-  {
-    SDL_Log("[DXYN] drawing with position (%d, %d), with %d rows\n", x_value, y_value, n);
-  }
+  CHIRP_TRACE(chirp, "[DXYN] drawing with position (%d, %d), with %d rows\n", x_value, y_value, n);
 
   // draw row by row
   for (int dy = 0; dy < n; dy++)
@@ -76,6 +75,12 @@ void draw(Chirp* chirp, const int x, const int y, const uint8_t n)
   }
 
   chirp->need_draw_screen = true;
+
+  // the original interpreter draws during the vertical blank, so nothing else runs until the next tick
+  if (chirp->config->vblank_wait)
+  {
+    chirp_idle_wait(chirp, CHIRP_WAKE_VBLANK, 1, 0);
+  }
 }
 
 /**
@@ -85,12 +90,15 @@ void draw(Chirp* chirp, const int x, const int y, const uint8_t n)
  */
 void subroutine_return(Chirp* chirp)
 {
-  const uint16_t popped_addr = chirp_stack_pop(chirp->stack);
-  if (chirp->config->is_debug)
+  uint16_t popped_addr;
+  if (!chirp_stack_pop(chirp->stack, &popped_addr))
   {
-    SDL_Log("[00EE] returning from subroutine, back to %04X\n", popped_addr);
+    chirp_raise_fault(chirp, CHIRP_FAULT_STACK_UNDERFLOW, 0x00EE);
+    return;
   }
 
+  CHIRP_TRACE(chirp, "[00EE] returning from subroutine, back to %04X\n", popped_addr);
+
   chirp->program_counter = popped_addr;
 }
 
@@ -103,11 +111,12 @@ void subroutine_return(Chirp* chirp)
  */
 void subroutine_call(Chirp* chirp, const uint16_t nnn)
 {
-  if (chirp->config->is_debug)
+  CHIRP_TRACE(chirp, "[2NNN] calling subroutine at %04X, pushed %04X on stack\n", nnn, chirp->program_counter);
+  if (!chirp_stack_push(chirp->stack, chirp->program_counter))
   {
-    SDL_Log("[2NNN] calling subroutine at %04X, pushed %04X on stack\n", nnn, chirp->program_counter);
+    chirp_raise_fault(chirp, CHIRP_FAULT_STACK_OVERFLOW, 0x2000 | nnn);
+    return;
   }
-  chirp_stack_push(chirp->stack, chirp->program_counter);
   chirp->program_counter = nnn;
 }
 
@@ -120,9 +129,16 @@ void subroutine_call(Chirp* chirp, const uint16_t nnn)
  */
 void jump(Chirp* chirp, const uint16_t nnn)
 {
-  if (chirp->config->is_debug)
+  CHIRP_TRACE(chirp, "[1NNN] jumping to %04X, current program counter is %04X\n", nnn, chirp->program_counter);
+
+  // a jump onto itself can never be left, so halt instead of spinning on it forever
+  if (nnn == chirp->program_counter - 2)
+  {
+    chirp_raise_fault(chirp, CHIRP_FAULT_INFINITE_LOOP, 0x1000 | nnn);
+  }
+  else if (nnn < chirp->program_counter)
   {
-    SDL_Log("[1NNN] jumping to %04X, current program counter is %04X\n", nnn, chirp->program_counter);
+    chirp_idle_on_backward_jump(chirp, nnn);
   }
   chirp->program_counter = nnn;
 }
@@ -137,14 +153,11 @@ void jump(Chirp* chirp, const uint16_t nnn)
 void jump_with_offset_nnn(Chirp* chirp, const uint16_t nnn)
 {
   const uint16_t destination = (uint16_t)chirp_registers_read(chirp->registers, 0x0) + nnn;
-  if (chirp->config->is_debug)
-  {
-    SDL_Log(
-      "[BNNN] jumping to %04X with offset of %d, current program counter is %04X\n",
-      destination,
-      nnn,
-      chirp->program_counter);
-  }
+  CHIRP_TRACE(chirp,
+              "[BNNN] jumping to %04X with offset of %d, current program counter is %04X\n",
+              destination,
+              nnn,
+              chirp->program_counter);
   chirp->program_counter = destination;
 }
 
@@ -156,14 +169,11 @@ void jump_with_offset_nnn(Chirp* chirp, const uint16_t nnn)
 void jump_with_offset_nnn_vx(Chirp* chirp, const int x, const uint16_t nnn)
 {
   const uint16_t destination = (uint16_t)chirp_registers_read(chirp->registers, x) + nnn;
-  if (chirp->config->is_debug)
-  {
-    SDL_Log(
-      "[BNNN] jumping to %04X with offset of %d, current program counter is %04X\n",
-      destination,
-      nnn,
-      chirp->program_counter);
-  }
+  CHIRP_TRACE(chirp,
+              "[BNNN] jumping to %04X with offset of %d, current program counter is %04X\n",
+              destination,
+              nnn,
+              chirp->program_counter);
   chirp->program_counter = destination;
 }
 
@@ -177,23 +187,12 @@ void skip_if_vx_eq_nn(Chirp* chirp, const int x, const uint8_t nn)
   const uint8_t x_value = chirp_registers_read(chirp->registers, x);
   if (x_value == nn)
   {
-    if (chirp->config->is_debug)
-    {
-      SDL_Log(
-        "[3XNN] skipping instruction because %d == %d\n",
-        x_value,
-        nn
-      );
-    }
+    CHIRP_TRACE(chirp, "[3XNN] skipping instruction because %d == %d\n", x_value, nn);
     chirp->program_counter += 2;
   }
-  else if (chirp->config->is_debug)
+  else
   {
-    SDL_Log(
-      "[3XNN] NOT skipping instruction because %d != %d\n",
-      x_value,
-      nn
-    );
+    CHIRP_TRACE(chirp, "[3XNN] NOT skipping instruction because %d != %d\n", x_value, nn);
   }
 }
 
@@ -207,23 +206,12 @@ void skip_if_vx_neq_nn(Chirp* chirp, const int x, const uint8_t nn)
   const uint8_t x_value = chirp_registers_read(chirp->registers, x);
   if (x_value != nn)
   {
-    if (chirp->config->is_debug)
-    {
-      SDL_Log(
-        "[4XNN] skipping instruction because %d != %d\n",
-        x_value,
-        nn
-      );
-    }
+    CHIRP_TRACE(chirp, "[4XNN] skipping instruction because %d != %d\n", x_value, nn);
     chirp->program_counter += 2;
   }
-  else if (chirp->config->is_debug)
+  else
   {
-    SDL_Log(
-      "[4XNN] NOT skipping instruction because %d == %d\n",
-      x_value,
-      nn
-    );
+    CHIRP_TRACE(chirp, "[4XNN] NOT skipping instruction because %d == %d\n", x_value, nn);
   }
 }
 
@@ -238,23 +226,12 @@ void skip_if_vx_eq_vy(Chirp* chirp, const int x, const int y)
   const uint8_t y_value = chirp_registers_read(chirp->registers, y);
   if (x_value == y_value)
   {
-    if (chirp->config->is_debug)
-    {
-      SDL_Log(
-        "[5XY0] skipping instruction because %d == %d\n",
-        x_value,
-        y_value
-      );
-    }
+    CHIRP_TRACE(chirp, "[5XY0] skipping instruction because %d == %d\n", x_value, y_value);
     chirp->program_counter += 2;
   }
-  else if (chirp->config->is_debug)
+  else
   {
-    SDL_Log(
-      "[5XY0] NOT skipping instruction because %d != %d\n",
-      x_value,
-      y_value
-    );
+    CHIRP_TRACE(chirp, "[5XY0] NOT skipping instruction because %d != %d\n", x_value, y_value);
   }
 }
 
@@ -270,23 +247,12 @@ void skip_if_vx_neq_vy(Chirp* chirp, const int x, const int y)
 
   if (x_value != y_value)
   {
-    if (chirp->config->is_debug)
-    {
-      SDL_Log(
-        "[9XY0] skipping instruction because %d != %d\n",
-        x_value,
-        y_value
-      );
-    }
+    CHIRP_TRACE(chirp, "[9XY0] skipping instruction because %d != %d\n", x_value, y_value);
     chirp->program_counter += 2;
   }
-  else if (chirp->config->is_debug)
+  else
   {
-    SDL_Log(
-      "[9XY0] NOT skipping instruction because %d == %d\n",
-      x_value,
-      y_value
-    );
+    CHIRP_TRACE(chirp, "[9XY0] NOT skipping instruction because %d == %d\n", x_value, y_value);
   }
 }
 
@@ -298,23 +264,15 @@ void skip_if_vx_neq_vy(Chirp* chirp, const int x, const int y)
 void skip_if_key_vx_pressed(Chirp* chirp, const int x)
 {
   const uint8_t x_value = chirp_registers_read(chirp->registers, x);
+  chirp->loop.effects |= CHIRP_LOOP_READ_KEYS;
   if (chirp_keyboard_read(chirp->keyboard, x_value))
   {
-    if (chirp->config->is_debug)
-    {
-      SDL_Log(
-        "[EX9E] skipping instruction because key %d is pressed\n",
-        x_value
-      );
-    }
+    CHIRP_TRACE(chirp, "[EX9E] skipping instruction because key %d is pressed\n", x_value);
     chirp->program_counter += 2;
   }
-  else if (chirp->config->is_debug)
+  else
   {
-    SDL_Log(
-      "[EX9E] NOT skipping instruction because key %d is NOT pressed\n",
-      x_value
-    );
+    CHIRP_TRACE(chirp, "[EX9E] NOT skipping instruction because key %d is NOT pressed\n", x_value);
   }
 }
 
@@ -326,23 +284,15 @@ void skip_if_key_vx_pressed(Chirp* chirp, const int x)
 void skip_if_key_vx_not_pressed(Chirp* chirp, const int x)
 {
   const uint8_t x_value = chirp_registers_read(chirp->registers, x);
+  chirp->loop.effects |= CHIRP_LOOP_READ_KEYS;
   if (!chirp_keyboard_read(chirp->keyboard, x_value))
   {
-    if (chirp->config->is_debug)
-    {
-      SDL_Log(
-        "[EXA1] skipping instruction because key %d is NOT pressed\n",
-        x_value
-      );
-    }
+    CHIRP_TRACE(chirp, "[EXA1] skipping instruction because key %d is NOT pressed\n", x_value);
     chirp->program_counter += 2;
   }
-  else if (chirp->config->is_debug)
+  else
   {
-    SDL_Log(
-      "[EXA1] NOT skipping instruction because key %d is pressed\n",
-      x_value
-    );
+    CHIRP_TRACE(chirp, "[EXA1] NOT skipping instruction because key %d is pressed\n", x_value);
   }
 }
 
@@ -353,14 +303,7 @@ void skip_if_key_vx_not_pressed(Chirp* chirp, const int x)
  */
 void set_vx_eq_nn(Chirp* chirp, const int x, const uint8_t nn)
 {
-  if (chirp->config->is_debug)
-  {
-    SDL_Log(
-      "[6XNN] setting mem[V%d] = %d\n",
-      x,
-      nn
-    );
-  }
+  CHIRP_TRACE(chirp, "[6XNN] setting mem[V%d] = %d\n", x, nn);
   chirp_registers_write(chirp->registers, x, nn);
 }
 
@@ -374,16 +317,7 @@ void set_vx_eq_vx_plus_nn(Chirp* chirp, const int x, const uint8_t nn)
   const uint8_t x_value = chirp_registers_read(chirp->registers, x);
   const uint8_t result = x_value + nn;
 
-  if (chirp->config->is_debug)
-  {
-    SDL_Log(
-      "[7XNN] setting mem[V%d] = mem[V%d] + %d (%d)\n",
-      x,
-      x,
-      nn,
-      result
-    );
-  }
+  CHIRP_TRACE(chirp, "[7XNN] setting mem[V%d] = mem[V%d] + %d (%d)\n", x, x, nn, result);
 
   chirp_registers_write(chirp->registers, x, result);
 }
@@ -397,15 +331,7 @@ void set_vx_eq_vy(Chirp* chirp, const int x, const int y)
 {
   const uint8_t y_value = chirp_registers_read(chirp->registers, y);
 
-  if (chirp->config->is_debug)
-  {
-    SDL_Log(
-      "[8XY0] setting mem[V%d] = mem[V%d] (%d)\n",
-      x,
-      y,
-      y_value
-    );
-  }
+  CHIRP_TRACE(chirp, "[8XY0] setting mem[V%d] = mem[V%d] (%d)\n", x, y, y_value);
 
   chirp_registers_write(chirp->registers, x, y_value);
 }
@@ -420,16 +346,7 @@ void set_vx_eq_vx_or_vy(Chirp* chirp, const int x, const int y)
   const uint8_t x_value = chirp_registers_read(chirp->registers, x);
   const uint8_t y_value = chirp_registers_read(chirp->registers, y);
   const uint8_t result = x_value | y_value;
-  if (chirp->config->is_debug)
-  {
-    SDL_Log(
-      "[8XY1] setting mem[V%d] = mem[V%d] | mem[V%d] (%d)\n",
-      x,
-      x,
-      y,
-      result
-    );
-  }
+  CHIRP_TRACE(chirp, "[8XY1] setting mem[V%d] = mem[V%d] | mem[V%d] (%d)\n", x, x, y, result);
 
   chirp_registers_write(chirp->registers, x, result);
 }
@@ -445,16 +362,7 @@ void set_vx_eq_vx_and_vy(Chirp* chirp, const int x, const int y)
   const uint8_t y_value = chirp_registers_read(chirp->registers, y);
   const uint8_t result = x_value & y_value;
 
-  if (chirp->config->is_debug)
-  {
-    SDL_Log(
-      "[8XY2] setting mem[V%d] = mem[V%d] & mem[V%d] (%d)\n",
-      x,
-      x,
-      y,
-      result
-    );
-  }
+  CHIRP_TRACE(chirp, "[8XY2] setting mem[V%d] = mem[V%d] & mem[V%d] (%d)\n", x, x, y, result);
 
   chirp_registers_write(chirp->registers, x, result);
 }
@@ -470,16 +378,7 @@ void set_vx_eq_vx_xor_vy(Chirp* chirp, const int x, const int y)
   const uint8_t y_value = chirp_registers_read(chirp->registers, y);
   const uint8_t result = x_value ^ y_value;
 
-  if (chirp->config->is_debug)
-  {
-    SDL_Log(
-      "[8XY3] setting mem[V%d] = mem[V%d] ^ mem[V%d] (%d)\n",
-      x,
-      x,
-      y,
-      result
-    );
-  }
+  CHIRP_TRACE(chirp, "[8XY3] setting mem[V%d] = mem[V%d] ^ mem[V%d] (%d)\n", x, x, y, result);
 
   chirp_registers_write(chirp->registers, x, result);
 }
@@ -500,19 +399,13 @@ void set_vx_eq_vx_plus_vy(Chirp* chirp, const int x, const int y)
 
   const uint8_t result = sum & 0xFF;
 
-  if (chirp->config->is_debug)
-  {
-    SDL_Log(
-      "[8XY4] setting mem[V%d] = mem[V%d] + mem[V%d] %s (%d)\n",
-      x,
-      x,
-      y,
-      has_overflow
-        ? "with overflow"
-        : "without overflow",
-      result
-    );
-  }
+  CHIRP_TRACE(chirp,
+              "[8XY4] setting mem[V%d] = mem[V%d] + mem[V%d] %s (%d)\n",
+              x,
+              x,
+              y,
+              has_overflow ? "with overflow" : "without overflow",
+              result);
 
   chirp_registers_write(chirp->registers, x, result);
 
@@ -534,19 +427,13 @@ void set_vx_eq_vx_minus_vy(Chirp* chirp, const int x, const int y)
 
   const uint8_t result = x_value - y_value;
 
-  if (chirp->config->is_debug)
-  {
-    SDL_Log(
-      "[8XY5] setting mem[V%d] = mem[V%d] - mem[V%d] %s (%d)\n",
-      x,
-      x,
-      y,
-      has_carry
-        ? "with underflow"
-        : "without underflow",
-      result
-    );
-  }
+  CHIRP_TRACE(chirp,
+              "[8XY5] setting mem[V%d] = mem[V%d] - mem[V%d] %s (%d)\n",
+              x,
+              x,
+              y,
+              has_carry ? "with underflow" : "without underflow",
+              result);
 
   chirp_registers_write(chirp->registers, x, result);
 
@@ -570,18 +457,12 @@ void set_vx_eq_vy_shift_right(Chirp* chirp, const int x, const int y)
 
   const uint8_t result = y_value >> 1;
 
-  if (chirp->config->is_debug)
-  {
-    SDL_Log(
-      "[8XY6] setting mem[V%d] = mem[V%d] >> 1 %s (%d)\n",
-      x,
-      y,
-      has_carry
-        ? "with carry"
-        : "without carry",
-      result
-    );
-  }
+  CHIRP_TRACE(chirp,
+              "[8XY6] setting mem[V%d] = mem[V%d] >> 1 %s (%d)\n",
+              x,
+              y,
+              has_carry ? "with carry" : "without carry",
+              result);
 
   chirp_registers_write(chirp->registers, x, result);
 
@@ -603,18 +484,12 @@ void set_vx_eq_vx_shift_right(Chirp* chirp, const int x)
 
   const uint8_t result = x_value >> 1;
 
-  if (chirp->config->is_debug)
-  {
-    SDL_Log(
-      "[8XY6] setting mem[V%d] = mem[V%d] >> 1 %s (%d)\n",
-      x,
-      x,
-      has_carry
-        ? "with carry"
-        : "without carry",
-      result
-    );
-  }
+  CHIRP_TRACE(chirp,
+              "[8XY6] setting mem[V%d] = mem[V%d] >> 1 %s (%d)\n",
+              x,
+              x,
+              has_carry ? "with carry" : "without carry",
+              result);
 
   chirp_registers_write(chirp->registers, x, result);
 
@@ -636,19 +511,13 @@ void set_vx_eq_vy_minus_vx(Chirp* chirp, const int x, const int y)
 
   const uint8_t result = y_value - x_value;
 
-  if (chirp->config->is_debug)
-  {
-    SDL_Log(
-      "[8XY7] setting mem[V%d] = mem[V%d] - mem[V%d] %s (%d)\n",
-      x,
-      y,
-      x,
-      has_carry
-        ? "with underflow"
-        : "without underflow",
-      result
-    );
-  }
+  CHIRP_TRACE(chirp,
+              "[8XY7] setting mem[V%d] = mem[V%d] - mem[V%d] %s (%d)\n",
+              x,
+              y,
+              x,
+              has_carry ? "with underflow" : "without underflow",
+              result);
 
   chirp_registers_write(chirp->registers, x, result);
 
@@ -672,18 +541,12 @@ void set_vx_eq_vy_shift_left(Chirp* chirp, const int x, const int y)
 
   const uint8_t result = y_value << 1;
 
-  if (chirp->config->is_debug)
-  {
-    SDL_Log(
-      "[8XYE] setting mem[V%d] = mem[V%d] << 1 %s (%d)\n",
-      x,
-      y,
-      has_carry
-        ? "with carry"
-        : "without carry",
-      result
-    );
-  }
+  CHIRP_TRACE(chirp,
+              "[8XYE] setting mem[V%d] = mem[V%d] << 1 %s (%d)\n",
+              x,
+              y,
+              has_carry ? "with carry" : "without carry",
+              result);
 
   chirp_registers_write(chirp->registers, x, result);
 
@@ -705,18 +568,12 @@ void set_vx_eq_vx_shift_left(Chirp* chirp, const int x)
 
   const uint8_t result = x_value << 1;
 
-  if (chirp->config->is_debug)
-  {
-    SDL_Log(
-      "[8XYE] setting mem[V%d] = mem[V%d] << 1 %s (%d)\n",
-      x,
-      x,
-      has_carry
-        ? "with carry"
-        : "without carry",
-      result
-    );
-  }
+  CHIRP_TRACE(chirp,
+              "[8XYE] setting mem[V%d] = mem[V%d] << 1 %s (%d)\n",
+              x,
+              x,
+              has_carry ? "with carry" : "without carry",
+              result);
 
   chirp_registers_write(chirp->registers, x, result);
 
@@ -730,19 +587,11 @@ void set_vx_eq_vx_shift_left(Chirp* chirp, const int x)
  */
 void set_vx_eq_random(Chirp* chirp, const int x, const uint8_t nn)
 {
-  const uint8_t random = rand() % 256;
+  const uint8_t random = chirp_random(chirp);
   const uint8_t result = random & nn;
+  chirp->loop.effects |= CHIRP_LOOP_SIDE_EFFECT;
 
-  if (chirp->config->is_debug)
-  {
-    SDL_Log(
-      "[CXNN] setting mem[V%d] = %d && %d (%d)\n",
-      x,
-      random,
-      nn,
-      result
-    );
-  }
+  CHIRP_TRACE(chirp, "[CXNN] setting mem[V%d] = %d && %d (%d)\n", x, random, nn, result);
 
   chirp_registers_write(chirp->registers, x, result);
 }
@@ -755,15 +604,9 @@ void set_vx_eq_random(Chirp* chirp, const int x, const uint8_t nn)
 void set_vx_eq_delay(Chirp* chirp, const int x)
 {
   const uint8_t delay = chirp->delay_timer;
+  chirp->loop.effects |= CHIRP_LOOP_READ_DELAY;
 
-  if (chirp->config->is_debug)
-  {
-    SDL_Log(
-      "[FX07] setting mem[V%d] = %d \n",
-      x,
-      delay
-    );
-  }
+  CHIRP_TRACE(chirp, "[FX07] setting mem[V%d] = %d \n", x, delay);
 
   chirp_registers_write(chirp->registers, x, delay);
 }
@@ -775,10 +618,7 @@ void set_vx_eq_delay(Chirp* chirp, const int x)
  */
 void set_index_eq_nnn(Chirp* chirp, const uint16_t nnn)
 {
-  if (chirp->config->is_debug)
-  {
-    SDL_Log("[ANNN] setting I = %d\n", nnn);
-  }
+  CHIRP_TRACE(chirp, "[ANNN] setting I = %d\n", nnn);
 
   chirp->index_register = nnn;
 }
@@ -793,10 +633,7 @@ void set_index_eq_index_plus_vx(Chirp* chirp, const int x)
   const uint8_t x_value = chirp_registers_read(chirp->registers, x);
   const uint16_t result = chirp->index_register + x_value;
 
-  if (chirp->config->is_debug)
-  {
-    SDL_Log("[FX1E] setting I = I + mem[V%d] (%d)\n", x, result);
-  }
+  CHIRP_TRACE(chirp, "[FX1E] setting I = I + mem[V%d] (%d)\n", x, result);
 
   chirp->index_register = result;
 }
@@ -811,10 +648,7 @@ void set_index_eq_font(Chirp* chirp, const int x)
   const uint8_t x_value = chirp_registers_read(chirp->registers, x);
   const uint16_t hex = CHIRP_FONTS_ADDR_START + x_value * 0x5;
 
-  if (chirp->config->is_debug)
-  {
-    SDL_Log("[FX29] setting I = %d (font character)\n", hex);
-  }
+  CHIRP_TRACE(chirp, "[FX29] setting I = %d (font character)\n", hex);
 
   chirp->index_register = hex;
 }
@@ -828,15 +662,13 @@ void set_index_eq_font(Chirp* chirp, const int x)
  */
 void set_registers(Chirp* chirp, const int x)
 {
+  chirp->loop.effects |= CHIRP_LOOP_SIDE_EFFECT;
   for (int i = 0; i <= x; i++)
   {
     const uint8_t value = chirp_registers_read(chirp->registers, i);
     chirp_mem_write(chirp->mem, chirp->index_register + i, value);
 
-    if (chirp->config->is_debug)
-    {
-      SDL_Log("[FX55] setting (I + %d) = %d\n", i, value);
-    }
+    CHIRP_TRACE(chirp, "[FX55] setting (I + %d) = %d\n", i, value);
   }
 }
 
@@ -849,15 +681,13 @@ void set_registers(Chirp* chirp, const int x)
  */
 void set_registers_inc(Chirp* chirp, const int x)
 {
+  chirp->loop.effects |= CHIRP_LOOP_SIDE_EFFECT;
   for (int i = 0; i <= x; i++)
   {
     const uint8_t value = chirp_registers_read(chirp->registers, i);
     chirp_mem_write(chirp->mem, chirp->index_register++, value);
 
-    if (chirp->config->is_debug)
-    {
-      SDL_Log("[FX55] setting (I + %d) = %d\n", i, value);
-    }
+    CHIRP_TRACE(chirp, "[FX55] setting (I + %d) = %d\n", i, value);
   }
 }
 
@@ -875,10 +705,7 @@ void load_registers(Chirp* chirp, const int x)
     const uint8_t value = chirp_mem_read(chirp->mem, chirp->index_register + i);
     chirp_registers_write(chirp->registers, i, value);
 
-    if (chirp->config->is_debug)
-    {
-      SDL_Log("[FX65] setting mem[V%d] = %d\n", i, value);
-    }
+    CHIRP_TRACE(chirp, "[FX65] setting mem[V%d] = %d\n", i, value);
   }
 }
 
@@ -896,10 +723,7 @@ void load_registers_inc(Chirp* chirp, const int x)
     const uint8_t value = chirp_mem_read(chirp->mem, chirp->index_register++);
     chirp_registers_write(chirp->registers, i, value);
 
-    if (chirp->config->is_debug)
-    {
-      SDL_Log("[FX65] setting mem[V%d] = %d\n", i, value);
-    }
+    CHIRP_TRACE(chirp, "[FX65] setting mem[V%d] = %d\n", i, value);
   }
 }
 
@@ -912,11 +736,9 @@ void set_delay_eq_vx(Chirp* chirp, const int x)
 {
   const uint8_t x_value = chirp_registers_read(chirp->registers, x);
   chirp->delay_timer = x_value;
+  chirp->loop.effects |= CHIRP_LOOP_SIDE_EFFECT;
 
-  if (chirp->config->is_debug)
-  {
-    SDL_Log("[FX15] setting delay timer = mem[V%d] (%d)\n", x, x_value);
-  }
+  CHIRP_TRACE(chirp, "[FX15] setting delay timer = mem[V%d] (%d)\n", x, x_value);
 }
 
 /**
@@ -928,38 +750,60 @@ void set_sound_eq_vx(Chirp* chirp, const int x)
 {
   const uint8_t x_value = chirp_registers_read(chirp->registers, x);
   chirp->sound_timer = x_value;
+  chirp->loop.effects |= CHIRP_LOOP_SIDE_EFFECT;
 
-  if (chirp->config->is_debug)
-  {
-    SDL_Log("[FX18] setting sound timer = mem[V%d] (%d)\n", x, x_value);
-  }
+  CHIRP_TRACE(chirp, "[FX18] setting sound timer = mem[V%d] (%d)\n", x, x_value);
 }
 
 /**
  * Instruction: FX0A
  *
- * Blocks CPU processing until any key is pressed and store into VX.
+ * Blocks CPU processing until a key is released and stores it into VX. Like the VIP, which waits for a key to go
+ * down and then up again, a key held when FX0A starts counts once it is let go.
+ *
+ * The machine parks on the instruction without re-executing it; the release itself, in chirp_set_key, completes it.
  */
 void get_key(Chirp* chirp, const int x)
 {
-  for (int i = 0; i < CHIRP_KEYBOARD_SIZE; i++)
-  {
-    if (chirp_keyboard_read(chirp->keyboard, i))
-    {
-      chirp_registers_write(chirp->registers, x, i);
-      if (chirp->config->is_debug)
-      {
-        SDL_Log("[FX0A] key %d pressed\n", i);
-      }
-      return;
-    }
-  }
+  CHIRP_TRACE(chirp, "[FX0A] waiting for a key release into V%d\n", x);
+
+  // time keeps passing at the cost of the instruction, as if it was spinning
+  chirp->key_wait = (int8_t)x;
+  chirp_idle_wait(chirp, CHIRP_WAKE_KEY, chirp_instruction_cost(chirp, 0xF00A | x << 8, false), 0);
+}
 
-  if (chirp->config->is_debug)
+/**
+ * Instruction: F002 (XO-CHIP)
+ *
+ * Loads the 16 bytes starting at mem[I] into the audio pattern buffer, played as 128 1-bit samples while the sound
+ * timer is running.
+ */
+void load_audio_pattern(Chirp* chirp)
+{
+  for (int i = 0; i < CHIRP_AUDIO_PATTERN_BYTES; i++)
   {
-    SDL_Log("[FX0A] no key pressed yet\n");
+    chirp->audio_pattern[i] = chirp_mem_read(chirp->mem, chirp->index_register + i);
   }
-  chirp->program_counter -= 2;
+  chirp->has_audio_pattern = true;
+  chirp->need_update_audio = true;
+  chirp->loop.effects |= CHIRP_LOOP_SIDE_EFFECT;
+
+  CHIRP_TRACE(chirp, "[F002] loading audio pattern from mem[I] (%d)\n", chirp->index_register);
+}
+
+/**
+ * Instruction: FX3A (XO-CHIP)
+ *
+ * Sets the audio pattern playback rate to 4000 * 2^((VX - 64) / 48) samples per second.
+ */
+void set_pitch_eq_vx(Chirp* chirp, const int x)
+{
+  const uint8_t x_value = chirp_registers_read(chirp->registers, x);
+  chirp->audio_pitch = x_value;
+  chirp->need_update_audio = true;
+  chirp->loop.effects |= CHIRP_LOOP_SIDE_EFFECT;
+
+  CHIRP_TRACE(chirp, "[FX3A] setting pitch = V%d (%d)\n", x, x_value);
 }
 
 /**
@@ -970,6 +814,7 @@ void get_key(Chirp* chirp, const int x)
 void binary_coded_decimal_conversion(Chirp* chirp, const int x)
 {
   uint8_t x_value = chirp_registers_read(chirp->registers, x);
+  chirp->loop.effects |= CHIRP_LOOP_SIDE_EFFECT;
 
   for (int i = 0; i < 3; i++)
   {
@@ -978,9 +823,6 @@ void binary_coded_decimal_conversion(Chirp* chirp, const int x)
     chirp_mem_write(chirp->mem, chirp->index_register + 2 - i, digit);
     x_value = x_value / 10;
 
-    if (chirp->config->is_debug)
-    {
-      SDL_Log("[FX33] setting mem[I + %d] = %d\n", chirp->index_register + 2 - i, digit);
-    }
+    CHIRP_TRACE(chirp, "[FX33] setting mem[I + %d] = %d\n", chirp->index_register + 2 - i, digit);
   }
 }
@@ -59,6 +59,10 @@ void load_registers_inc(Chirp* chirp, int x); // FX65 (variation 2)
 void set_delay_eq_vx(Chirp* chirp, int x); // FX15
 void set_sound_eq_vx(Chirp* chirp, int x); // FX18
 
+// audio (XO-CHIP)
+void load_audio_pattern(Chirp* chirp);     // F002
+void set_pitch_eq_vx(Chirp* chirp, int x); // FX3A
+
 // others
 void get_key(Chirp* chirp, int x);                         // FX0A
 void binary_coded_decimal_conversion(Chirp* chirp, int x); // FX33
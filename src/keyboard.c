@@ -1,5 +1,6 @@
 #include "keyboard.h"
 #include <stdlib.h>
+#include <string.h>
 
 ChirpKeyboard* chirp_keyboard_new()
 {
@@ -7,22 +8,84 @@ ChirpKeyboard* chirp_keyboard_new()
   ChirpKeyboard* keyboard = malloc(sizeof(ChirpKeyboard));
 
   // force initialize to 0
-  for (int i = 0; i < CHIRP_KEYBOARD_SIZE; i++)
-  {
-    keyboard->keyboard[i] = false;
-  }
+  chirp_keyboard_clear(keyboard);
 
   return keyboard;
 }
 
+void chirp_keyboard_clear(ChirpKeyboard* keyboard)
+{
+  keyboard->pressed = 0;
+  memset(keyboard->edge_cycles, 0, sizeof(keyboard->edge_cycles));
+}
+
 uint8_t chirp_keyboard_read(const ChirpKeyboard* keyboard, const int addr)
 {
   if (addr < 0 || addr >= CHIRP_KEYBOARD_SIZE) return 0;
-  return keyboard->keyboard[addr & 0x0F];
+  return (keyboard->pressed >> addr) & 0x1;
 }
 
-void chirp_keyboard_write(ChirpKeyboard* keyboard, const int addr, const bool value)
+// cycle is the emulated time of the change, kept so that the order of events can be told apart afterwards
+void chirp_keyboard_write(ChirpKeyboard* keyboard, const int addr, const bool value, const uint64_t cycle)
 {
   if (addr < 0 || addr >= CHIRP_KEYBOARD_SIZE) return;
-  keyboard->keyboard[addr & 0x0F] = value;
+
+  const uint16_t bit = (uint16_t)(1u << addr);
+  keyboard->pressed = value ? keyboard->pressed | bit : keyboard->pressed & ~bit;
+  keyboard->edge_cycles[addr] = cycle;
+}
+
+// scancode of a letter or digit on a US layout; scancodes are physical keys, so other layouts keep the same block
+SDL_Scancode chirp_keymap_scancode(const char c)
+{
+  if (c >= 'a' && c <= 'z')
+  {
+    return SDL_SCANCODE_A + (c - 'a');
+  }
+  if (c >= 'A' && c <= 'Z')
+  {
+    return SDL_SCANCODE_A + (c - 'A');
+  }
+  if (c >= '1' && c <= '9')
+  {
+    return SDL_SCANCODE_1 + (c - '1');
+  }
+  if (c == '0')
+  {
+    return SDL_SCANCODE_0;
+  }
+
+  return SDL_SCANCODE_UNKNOWN;
+}
+
+/**
+ * Builds the table from 16 letters or digits, the host key for each of 0-F in order, as in CHIRP_KEYMAP_DEFAULT.
+ * Returns false if there are not exactly 16, or one is not a letter or digit, or one is used twice.
+ */
+bool chirp_keymap_parse(ChirpKeymap* keymap, const char* keys)
+{
+  memset(keymap->keys, -1, sizeof(keymap->keys));
+  if (strlen(keys) != CHIRP_KEYBOARD_SIZE)
+  {
+    return false;
+  }
+
+  for (int i = 0; i < CHIRP_KEYBOARD_SIZE; i++)
+  {
+    const SDL_Scancode scancode = chirp_keymap_scancode(keys[i]);
+    if (scancode == SDL_SCANCODE_UNKNOWN || keymap->keys[scancode] >= 0)
+    {
+      return false;
+    }
+    keymap->keys[scancode] = (int8_t)i;
+  }
+
+  return true;
+}
+
+// key for a scancode, -1 if it is not mapped
+int chirp_keymap_lookup(const ChirpKeymap* keymap, const SDL_Scancode scancode)
+{
+  if (scancode < 0 || scancode >= SDL_SCANCODE_COUNT) return -1;
+  return keymap->keys[scancode];
 }
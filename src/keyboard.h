@@ -1,18 +1,32 @@
 #ifndef CHIRP_KEYBOARD_H
 #define CHIRP_KEYBOARD_H
 
+#include "SDL3/SDL.h"
+
 #include <stdint.h>
 #include <stdbool.h>
 
 #define CHIRP_KEYBOARD_SIZE 16
+#define CHIRP_KEYMAP_DEFAULT "x123qweasdzc4rfv" // host key for each of 0-F, the usual 4x4 block on the left
 
 typedef struct ChirpKeyboard
 {
-    bool keyboard[CHIRP_KEYBOARD_SIZE];
+    uint16_t pressed;                          // one bit per key, key 0 in the lowest bit
+    uint64_t edge_cycles[CHIRP_KEYBOARD_SIZE]; // emulated cycle each key last went up or down at
 } ChirpKeyboard;
 
+// host scancode to key, looked up directly on every key event
+typedef struct ChirpKeymap
+{
+    int8_t keys[SDL_SCANCODE_COUNT]; // -1 for scancodes that are not mapped
+} ChirpKeymap;
+
 ChirpKeyboard* chirp_keyboard_new();
+void chirp_keyboard_clear(ChirpKeyboard* keyboard);
 uint8_t chirp_keyboard_read(const ChirpKeyboard* keyboard, int addr);
-void chirp_keyboard_write(ChirpKeyboard* keyboard, int addr, bool value);
+void chirp_keyboard_write(ChirpKeyboard* keyboard, int addr, bool value, uint64_t cycle);
+
+bool chirp_keymap_parse(ChirpKeymap* keymap, const char* keys);
+int chirp_keymap_lookup(const ChirpKeymap* keymap, SDL_Scancode scancode);
 
 #endif // CHIRP_KEYBOARD_H
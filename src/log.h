@@ -0,0 +1,36 @@
+#ifndef CHIRP_LOG_H
+#define CHIRP_LOG_H
+
+#include "SDL3/SDL.h"
+
+// logging with --debug, in levels picked at compile time. Anything above CHIRP_LOG_LEVEL is compiled out: the
+// condition folds to false, so the compiler drops the call, the check on is_debug and the arguments altogether
+
+#define CHIRP_LOG_NONE 0
+#define CHIRP_LOG_INFO 1  // rare events, such as a loop going idle
+#define CHIRP_LOG_TRACE 2 // every instruction
+
+// release builds (-DNDEBUG) keep only what does not happen on every instruction
+#ifndef CHIRP_LOG_LEVEL
+#ifdef NDEBUG
+#define CHIRP_LOG_LEVEL CHIRP_LOG_INFO
+#else
+#define CHIRP_LOG_LEVEL CHIRP_LOG_TRACE
+#endif
+#endif
+
+#define CHIRP_LOG_IS_ON(chirp, level) (CHIRP_LOG_LEVEL >= (level) && (chirp)->config->is_debug)
+
+#define CHIRP_LOG(chirp, level, ...)                                                                                 \
+  do                                                                                                                 \
+  {                                                                                                                  \
+    if (CHIRP_LOG_IS_ON(chirp, level))                                                                               \
+    {                                                                                                                \
+      SDL_Log(__VA_ARGS__);                                                                                          \
+    }                                                                                                                \
+  } while (0)
+
+#define CHIRP_INFO(chirp, ...) CHIRP_LOG(chirp, CHIRP_LOG_INFO, __VA_ARGS__)
+#define CHIRP_TRACE(chirp, ...) CHIRP_LOG(chirp, CHIRP_LOG_TRACE, __VA_ARGS__)
+
+#endif // CHIRP_LOG_H
@@ -1,11 +1,115 @@
+#include "analysis.h"
 #include "chirp.h"
+#include "debugger.h"
+#include "detect.h"
+#include "diff.h"
+#include "gdbstub.h"
+#include "metrics.h"
+#include "plugin.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <getopt.h>
 
+#ifdef CHIRP_AOT_PROGRAM
+// a ROM translated ahead of time and linked in by make aot
+#include "aot.h"
+extern const ChirpAotProgram CHIRP_AOT_PROGRAM;
+#endif
+
 ChirpConfig* parse_args(int argc, char* argv[]);
 void usage(const char* prog);
 
+// runs the configured number of frames as fast as possible, stopping early once the ROM halts
+void run_headless(Chirp* chirp, ChirpGdbStub* gdb, ChirpMetrics* metrics)
+{
+  while (chirp->frame_count < (uint64_t)chirp->config->frames && chirp->is_running)
+  {
+    if (gdb == NULL)
+    {
+      const ChirpFault fault = chirp_run_frame(chirp);
+      if (metrics != NULL)
+      {
+        chirp_metrics_record_frame(metrics, chirp->instruction_count);
+        chirp_metrics_report(metrics);
+      }
+      if (fault != CHIRP_FAULT_NONE)
+      {
+        break;
+      }
+      continue;
+    }
+
+    chirp_gdb_poll(gdb);
+    if (chirp_gdb_is_stopped(gdb))
+    {
+      if (metrics != NULL)
+      {
+        chirp_metrics_pause(metrics);
+      }
+      chirp_gdb_wait(gdb, 100);
+      continue;
+    }
+
+    // a breakpoint can stop the machine partway through a frame, so frames follow the fixed schedule from the reset
+    const uint64_t frame_end = chirp_frame_end(chirp);
+    if (chirp_cycles(chirp) < frame_end)
+    {
+      chirp_run(chirp, frame_end - chirp_cycles(chirp));
+    }
+    if (chirp_cycles(chirp) >= frame_end)
+    {
+      chirp_tick_timers(chirp);
+      if (metrics != NULL)
+      {
+        chirp_metrics_record_frame(metrics, chirp->instruction_count);
+        chirp_metrics_report(metrics);
+      }
+    }
+  }
+
+  if (chirp->config->is_debug)
+  {
+    printf("ran %llu instructions in %llu cycles over %llu frames\n",
+           (unsigned long long)chirp->instruction_count,
+           (unsigned long long)chirp->cycle_count,
+           (unsigned long long)chirp->frame_count);
+  }
+}
+
+/**
+ * Runs the ROM on the reference interpreter and on the engine the instance would otherwise use, side by side on the
+ * same generated key presses, for the configured number of frames. Returns false if they diverged.
+ */
+bool run_diff(const Chirp* chirp)
+{
+  ChirpDiff* diff = chirp_diff_new(chirp, chirp->engine, chirp->config->diff_interval);
+  if (diff == NULL)
+  {
+    return false;
+  }
+
+  const uint64_t frames = chirp->config->frames;
+  const int capacity = frames / CHIRP_DIFF_INPUT_INTERVAL * 2 + 2;
+  ChirpDiffInput* inputs = malloc(sizeof(ChirpDiffInput) * capacity);
+  chirp_diff_set_inputs(diff, inputs, chirp_diff_make_inputs(inputs, capacity, frames, CHIRP_RANDOM_SEED));
+
+  const bool agreed = chirp_diff_run(diff, frames);
+  if (agreed)
+  {
+    const Chirp* reference = diff->sides[0].chirp;
+    printf("%s and %s agree over %llu instructions in %llu frames (%llu comparisons)\n",
+           chirp_engine_name(CHIRP_ENGINE_REFERENCE),
+           chirp_engine_name(chirp->engine),
+           (unsigned long long)reference->instruction_count,
+           (unsigned long long)reference->frame_count,
+           (unsigned long long)diff->comparisons);
+  }
+
+  chirp_diff_free(diff);
+  free(inputs);
+  return agreed;
+}
+
 int main(int argc, char* argv[])
 {
   if (argc < 2)
@@ -24,30 +128,255 @@ int main(int argc, char* argv[])
     printf("loading ROM at path %s\n", config->rom_path);
   }
 
-  // TODO: Add stats for how long the emulator is running for
+  // the default database is optional, one asked for is not
+  const bool is_rom_db_optional = config->rom_db_path == NULL;
+  ChirpRomDb* rom_db =
+    chirp_romdb_open(is_rom_db_optional ? CHIRP_ROMDB_DEFAULT_PATH : config->rom_db_path, is_rom_db_optional);
+  if (rom_db == NULL && !is_rom_db_optional)
+  {
+    free(config);
+    return 1;
+  }
+  config->rom_db = rom_db;
+
   Chirp* chirp = chirp_new(config);
+  if (config->is_debug && config->rom_entry != NULL)
+  {
+    printf("found %s (%s) in the ROM database\n", config->rom_entry->title, config->rom_entry->platform);
+  }
 
   if (config->is_debug)
   {
     printf("ROM loaded...\n");
-    printf("creating window for chirp...\n");
     chirp_mem_view(chirp->mem);
   }
 
-  SDLWindow* window = sdl_window_new();
+  if (config->analyse)
+  {
+    ChirpAnalysis* analysis = malloc(sizeof(ChirpAnalysis));
+    if (analysis == NULL)
+    {
+      fprintf(stderr, "out of memory\n");
+      exit(1);
+    }
+    chirp_analyse(chirp->boot->mem->mem, CHIRP_INSTRUCTIONS_ADDR_START, analysis);
+    chirp_apply_analysis(chirp, analysis);
+
+    if (config->is_debug)
+    {
+      printf("analysis found %d instructions in %d blocks, %d indirect jumps and %d invalid instructions\n",
+             analysis->instruction_count,
+             analysis->block_count,
+             analysis->indirect_jump_count,
+             analysis->invalid_count);
+    }
+    free(analysis);
+  }
+
+#ifdef CHIRP_AOT_PROGRAM
+  if (!chirp_aot_attach(chirp, &CHIRP_AOT_PROGRAM))
+  {
+    fprintf(stderr, "%s is not the ROM this binary was translated from, interpreting it\n", config->rom_path);
+  }
+#endif
+
+  // the profiles run on clones of the instance as it was loaded, then the instance runs on the config they changed;
+  // there is nothing to detect for a ROM the database knows, and quirk flags given on the command line stay on
+  if (config->detect_quirks && config->rom_entry == NULL)
+  {
+    const int quirks = chirp_detect_quirks(chirp, CHIRP_DETECT_FRAMES, chirp_quirks_given(config), config->is_debug);
+    chirp_quirks_apply(config, quirks);
+
+    char flags[128];
+    chirp_quirks_format(quirks, flags, sizeof(flags));
+    printf("detected quirks: %s\n", flags);
+  }
+
+  // plugins hook into the instance itself, which a diff run never runs
+  ChirpPluginHost* plugins = NULL;
+  if (config->plugin_count > 0 && config->diff_interval == 0)
+  {
+    plugins = chirp_plugins_new(chirp);
+    for (int i = 0; i < config->plugin_count; i++)
+    {
+      if (!chirp_plugins_load(plugins, config->plugins[i]))
+      {
+        chirp_plugins_free(plugins);
+        chirp_free(chirp);
+        if (rom_db != NULL)
+        {
+          chirp_romdb_close(rom_db);
+        }
+        free(config);
+        return 1;
+      }
+    }
+  }
+
+  // a diff run never runs this instance itself, only clones of it
+  ChirpCapture* capture = NULL;
+  if (config->capture_path != NULL && config->diff_interval == 0)
+  {
+    capture = chirp_capture_new(config->capture_path);
+    if (capture == NULL)
+    {
+      if (plugins != NULL)
+      {
+        chirp_plugins_free(plugins);
+      }
+      chirp_free(chirp);
+      if (rom_db != NULL)
+      {
+        chirp_romdb_close(rom_db);
+      }
+      free(config);
+      return 1;
+    }
+    chirp->capture = capture;
+  }
+
+  // the interactive debugger already stops the machine itself, so the stub only serves the other modes
+  ChirpGdbStub* gdb = NULL;
+  if (config->gdb_address != NULL && !config->is_debugger)
+  {
+    gdb = chirp_gdb_new(chirp, config->gdb_address);
+    if (gdb == NULL)
+    {
+      if (capture != NULL)
+      {
+        chirp_capture_free(capture);
+      }
+      if (plugins != NULL)
+      {
+        chirp_plugins_free(plugins);
+      }
+      chirp_free(chirp);
+      if (rom_db != NULL)
+      {
+        chirp_romdb_close(rom_db);
+      }
+      free(config);
+      return 1;
+    }
+    printf("waiting for gdb on %s\n", config->gdb_address);
+  }
+
+  // the debugger stops the clock whenever it likes and a diff run is not about speed, so neither is measured
+  ChirpMetrics* metrics = NULL;
+  if (config->has_metrics && !config->is_debugger && config->diff_interval == 0)
+  {
+    metrics = chirp_metrics_new(!config->is_headless);
+  }
+
+  bool has_diverged = false;
+  if (config->is_debugger)
+  {
+    // the window only mirrors the display, so it is left out entirely when headless
+    SDLWindow* window =
+      config->is_headless ? NULL : sdl_window_new(config->scaling, config->persistence, config->has_scanlines);
+    ChirpDebugger* debugger = chirp_debugger_new(chirp, window);
+    chirp_debugger_run(debugger);
+    chirp_debugger_free(debugger);
+
+    if (window != NULL)
+    {
+      sdl_window_free(window);
+    }
+  }
+  else if (config->diff_interval > 0)
+  {
+    has_diverged = !run_diff(chirp);
+  }
+  else if (config->is_headless)
+  {
+    run_headless(chirp, gdb, metrics);
+  }
+  else
+  {
+    if (config->is_debug)
+    {
+      printf("creating window for chirp...\n");
+    }
 
-  chirp_start_emulator_loop(chirp, window);
+    SDLWindow* window = sdl_window_new(config->scaling, config->persistence, config->has_scanlines);
+    sdl_window_set_metrics(window, metrics);
+    chirp_start_emulator_loop(chirp, window, gdb);
+    sdl_window_free(window);
+  }
+
+  // the plugins see the machine as the run left it
+  if (plugins != NULL)
+  {
+    chirp_plugins_free(plugins);
+  }
+
+  if (gdb != NULL)
+  {
+    chirp_gdb_free(gdb);
+  }
+
+  // waits for the encoder to catch up
+  if (capture != NULL)
+  {
+    chirp_capture_free(capture);
+  }
+
+  if (metrics != NULL)
+  {
+    FILE* file = config->metrics_path != NULL ? fopen(config->metrics_path, "w") : stdout;
+    if (file == NULL)
+    {
+      fprintf(stderr, "could not write metrics to %s\n", config->metrics_path);
+    }
+    else
+    {
+      chirp_metrics_write_json(metrics, file);
+      if (file != stdout)
+      {
+        fclose(file);
+      }
+    }
+    chirp_metrics_free(metrics);
+  }
 
   if (config->is_debug)
   {
+    const ChirpMemStats* stats = &chirp->mem->stats;
+    printf("self-modifying code: %llu writes to code changed %llu bytes in %d granules of %d bytes",
+           (unsigned long long)stats->code_writes,
+           (unsigned long long)stats->code_changes,
+           stats->changed_granule_count,
+           1 << CHIRP_MEM_GRANULE_SHIFT);
+    if (stats->code_changes > 0)
+    {
+      printf(", the first at %03X", stats->first_change);
+    }
+    printf("\n");
+#ifdef CHIRP_INSTRUMENT
+    chirp_mem_heat_report(chirp->mem, 8);
+#endif
     printf("stopping chirp...\n");
   }
 
-  // make sure to release all resources
-  sdl_window_free(window);
+  const ChirpFault fault = chirp->fault;
+  if (chirp_fault_is_error(fault))
+  {
+    fprintf(stderr,
+            "%s: %04X at %04X\n",
+            chirp_fault_name(fault),
+            chirp->fault_instruction,
+            chirp->fault_address);
+  }
+
+  // make sure to release all resources; the config can point into the database
   chirp_free(chirp);
+  if (rom_db != NULL)
+  {
+    chirp_romdb_close(rom_db);
+  }
+  free(config);
 
-  return 0;
+  return chirp_fault_is_error(fault) || has_diverged ? 1 : 0;
 }
 
 void usage(const char* prog)
@@ -59,8 +388,28 @@ void usage(const char* prog)
           "  [--jump-with-vx]\n"
           "  [--set-registers-increment-index]\n"
           "  [--load-registers-increment-index]\n"
+          "  [--detect-quirks]\n"
           "  [--has-audio]\n"
-          "  [--cpu=N]\n",
+          "  [--vip-timing]\n"
+          "  [--vblank-wait]\n"
+          "  [--xo-chip]\n"
+          "  [--analyse]\n"
+          "  [--cpu=N]\n"
+          "  [--run-ahead=N]\n"
+          "  [--keymap=KEYS]\n"
+          "  [--scale=integer|fit|stretch]\n"
+          "  [--persistence=PERCENT]\n"
+          "  [--scanlines]\n"
+          "  [--deflicker=PERCENT]\n"
+          "  [--capture=PATH]\n"
+          "  [--plugin=PATH[,ARGS]]...\n"
+          "  [--rom-db=PATH]\n"
+          "  [--headless]\n"
+          "  [--debugger]\n"
+          "  [--gdb=PORT|PATH]\n"
+          "  [--frames=N]\n"
+          "  [--diff=N]\n"
+          "  [--metrics[=PATH]]\n",
           prog);
 }
 
@@ -68,14 +417,38 @@ ChirpConfig* parse_args(int argc, char* argv[])
 {
   ChirpConfig* config = malloc(sizeof(ChirpConfig));
   config->cpu_speed = 500;
+  config->frames = 600;
+  config->keymap = CHIRP_KEYMAP_DEFAULT;
+  config->run_ahead = 0;
+  config->diff_interval = 0;
+  config->scaling = SDL_SCALING_INTEGER;
+  config->persistence = 0;
+  config->has_scanlines = false;
+  config->deflicker = 0;
+  config->capture_path = NULL;
+  config->plugin_count = 0;
+  config->rom_db_path = NULL;
+  config->rom_db = NULL;
+  config->rom_entry = NULL;
+  config->given = 0;
   config->rom_path = "";
 
   config->is_debug = false;
   config->has_audio = false;
+  config->is_headless = false;
+  config->is_debugger = false;
+  config->gdb_address = NULL;
+  config->has_metrics = false;
+  config->metrics_path = NULL;
+  config->vip_timing = false;
+  config->vblank_wait = false;
+  config->xo_chip = false;
+  config->analyse = false;
   config->jump_with_vx = false;
   config->load_registers_increment_index = false;
   config->set_registers_increment_index = false;
   config->shift_vx = false;
+  config->detect_quirks = false;
 
   // all argument parsing handled after
   static struct option long_opts[] = {
@@ -84,8 +457,28 @@ ChirpConfig* parse_args(int argc, char* argv[])
     {"jump-with-vx", no_argument, 0, 0},
     {"set-registers-increment-index", no_argument, 0, 0},
     {"load-registers-increment-index", no_argument, 0, 0},
+    {"detect-quirks", no_argument, 0, 0},
     {"audio", no_argument, 0, 0},
+    {"vip-timing", no_argument, 0, 0},
+    {"vblank-wait", no_argument, 0, 0},
+    {"xo-chip", no_argument, 0, 0},
+    {"analyse", no_argument, 0, 0},
     {"cpu", optional_argument, 0, 0},
+    {"run-ahead", required_argument, 0, 0},
+    {"keymap", required_argument, 0, 0},
+    {"scale", required_argument, 0, 0},
+    {"persistence", required_argument, 0, 0},
+    {"scanlines", no_argument, 0, 0},
+    {"deflicker", required_argument, 0, 0},
+    {"capture", required_argument, 0, 0},
+    {"plugin", required_argument, 0, 0},
+    {"rom-db", required_argument, 0, 0},
+    {"headless", no_argument, 0, 0},
+    {"debugger", no_argument, 0, 0},
+    {"gdb", required_argument, 0, 0},
+    {"frames", required_argument, 0, 0},
+    {"diff", required_argument, 0, 0},
+    {"metrics", optional_argument, 0, 0},
     {0, 0, 0, 0}, // sentinel to inform that the array has ended
   };
 
@@ -110,12 +503,75 @@ ChirpConfig* parse_args(int argc, char* argv[])
     const char* argval = optarg;
 
     if (strcmp(name, "debug") == 0) config->is_debug = true;
-    else if (strcmp(name, "shift-vx") == 0) config->shift_vx = true;
-    else if (strcmp(name, "jump-with-vx") == 0) config->jump_with_vx = true;
-    else if (strcmp(name, "set-registers-increment-index") == 0) config->set_registers_increment_index = true;
-    else if (strcmp(name, "load-registers-increment-index") == 0) config->load_registers_increment_index = true;
+    else if (strcmp(name, "shift-vx") == 0)
+    {
+      config->shift_vx = true;
+      config->given |= CHIRP_GIVEN_QUIRK(CHIRP_QUIRK_SHIFT_VX);
+    }
+    else if (strcmp(name, "jump-with-vx") == 0)
+    {
+      config->jump_with_vx = true;
+      config->given |= CHIRP_GIVEN_QUIRK(CHIRP_QUIRK_JUMP_WITH_VX);
+    }
+    else if (strcmp(name, "set-registers-increment-index") == 0)
+    {
+      config->set_registers_increment_index = true;
+      config->given |= CHIRP_GIVEN_QUIRK(CHIRP_QUIRK_SET_REGISTERS_INCREMENT_INDEX);
+    }
+    else if (strcmp(name, "load-registers-increment-index") == 0)
+    {
+      config->load_registers_increment_index = true;
+      config->given |= CHIRP_GIVEN_QUIRK(CHIRP_QUIRK_LOAD_REGISTERS_INCREMENT_INDEX);
+    }
+    else if (strcmp(name, "detect-quirks") == 0) config->detect_quirks = true;
     else if (strcmp(name, "audio") == 0) config->has_audio = true;
-    else if (strcmp(name, "cpu") == 0) config->cpu_speed = atoi(argval);
+    else if (strcmp(name, "vip-timing") == 0) config->vip_timing = true;
+    else if (strcmp(name, "vblank-wait") == 0) config->vblank_wait = true;
+    else if (strcmp(name, "xo-chip") == 0) config->xo_chip = true;
+    else if (strcmp(name, "analyse") == 0) config->analyse = true;
+    else if (strcmp(name, "cpu") == 0)
+    {
+      config->cpu_speed = atoi(argval);
+      config->given |= CHIRP_GIVEN_CPU_SPEED;
+    }
+    else if (strcmp(name, "run-ahead") == 0) config->run_ahead = atoi(argval);
+    else if (strcmp(name, "keymap") == 0)
+    {
+      config->keymap = argval;
+      config->given |= CHIRP_GIVEN_KEYMAP;
+    }
+    else if (strcmp(name, "persistence") == 0) config->persistence = atoi(argval);
+    else if (strcmp(name, "scanlines") == 0) config->has_scanlines = true;
+    else if (strcmp(name, "deflicker") == 0) config->deflicker = atoi(argval);
+    else if (strcmp(name, "capture") == 0) config->capture_path = argval;
+    else if (strcmp(name, "plugin") == 0)
+    {
+      if (config->plugin_count == CHIRP_PLUGIN_MAX)
+      {
+        fprintf(stderr, "no more than %d plugins can be loaded\n", CHIRP_PLUGIN_MAX);
+        exit(1);
+      }
+      config->plugins[config->plugin_count++] = argval;
+    }
+    else if (strcmp(name, "rom-db") == 0) config->rom_db_path = argval;
+    else if (strcmp(name, "scale") == 0)
+    {
+      if (!sdl_window_parse_scaling(argval, &config->scaling))
+      {
+        fprintf(stderr, "scale must be integer, fit or stretch\n");
+        exit(1);
+      }
+    }
+    else if (strcmp(name, "headless") == 0) config->is_headless = true;
+    else if (strcmp(name, "debugger") == 0) config->is_debugger = true;
+    else if (strcmp(name, "gdb") == 0) config->gdb_address = argval;
+    else if (strcmp(name, "frames") == 0) config->frames = atoi(argval);
+    else if (strcmp(name, "diff") == 0) config->diff_interval = atoi(argval);
+    else if (strcmp(name, "metrics") == 0)
+    {
+      config->has_metrics = true;
+      config->metrics_path = argval;
+    }
   }
 
   if (optind < argc)
@@ -134,5 +590,26 @@ ChirpConfig* parse_args(int argc, char* argv[])
     exit(1);
   }
 
+  // going backwards in the debugger replays history, which would record the replayed frames a second time
+  if (config->is_debugger && config->capture_path != NULL)
+  {
+    fprintf(stderr, "--capture cannot be used with --debugger\n");
+    exit(1);
+  }
+
+  // going backwards in the debugger replays history, which would run the plugins' hooks a second time
+  if (config->is_debugger && config->plugin_count > 0)
+  {
+    fprintf(stderr, "--plugin cannot be used with --debugger\n");
+    exit(1);
+  }
+
+  ChirpKeymap keymap;
+  if (!chirp_keymap_parse(&keymap, config->keymap))
+  {
+    fprintf(stderr, "keymap must be 16 different letters or digits, the keys for 0-F in order\n");
+    exit(1);
+  }
+
   return config;
 }
@@ -49,26 +49,181 @@ char* join_string(const char* strings[], const char* separator, const size_t cou
 
 ChirpMemory* chirp_mem_new()
 {
-  // we don't allocate the inner array because it's fixed size
-  ChirpMemory* mem = malloc(sizeof(ChirpMemory));
+  // we don't allocate the inner array because it's fixed size; zeroed, nothing is code and nobody is watching
+  ChirpMemory* mem = calloc(1, sizeof(ChirpMemory));
+#ifdef CHIRP_INSTRUMENT
+  mem->heat = calloc(1, sizeof(ChirpMemHeat));
+#endif
 
-  // force initialize to 0
-  for (int i = 0; i < CHIRP_MEMORY_SIZE; i++)
+  return mem;
+}
+
+void chirp_mem_free(ChirpMemory* mem)
+{
+#ifdef CHIRP_INSTRUMENT
+  free(mem->heat);
+#endif
+  free(mem);
+}
+
+void chirp_mem_notify(ChirpMemory* mem, const uint16_t start, const uint16_t end)
+{
+  for (int i = 0; i < mem->watcher_count; i++)
   {
-    mem->mem[i] = 0;
+    mem->watchers[i].code_written(mem->watchers[i].context, start, end);
   }
+}
 
-  return mem;
+void chirp_mem_clear(ChirpMemory* mem)
+{
+  memset(mem->mem, 0, sizeof(mem->mem));
+  chirp_mem_notify(mem, 0, CHIRP_MEMORY_SIZE);
+}
+
+/**
+ * Copies the contents and the statistics of src into dst, which keeps its watchers and its marks; the code marks of
+ * src are added to them, so that code either of them has run stays behind the write barrier. All of memory may have
+ * changed as far as the watchers of dst are concerned.
+ */
+void chirp_mem_copy(ChirpMemory* dst, const ChirpMemory* src)
+{
+  memcpy(dst->mem, src->mem, sizeof(dst->mem));
+  for (int i = 0; i < CHIRP_MEM_GRANULE_COUNT / 64; i++)
+  {
+    dst->code[i] |= src->code[i];
+    dst->barrier[i] |= src->code[i];
+  }
+  dst->stats = src->stats;
+
+  chirp_mem_notify(dst, 0, CHIRP_MEMORY_SIZE);
 }
 
 uint8_t chirp_mem_read(const ChirpMemory* mem, const uint16_t addr)
 {
+#ifdef CHIRP_INSTRUMENT
+  mem->heat->counts[CHIRP_MEM_ACCESS_READ][addr & 0x0FFF]++;
+#endif
   return mem->mem[addr & 0x0FFF];
 }
 
+// the instruction at addr, as the CPU fetches it
+uint16_t chirp_mem_fetch(const ChirpMemory* mem, const uint16_t addr)
+{
+#ifdef CHIRP_INSTRUMENT
+  mem->heat->counts[CHIRP_MEM_ACCESS_EXECUTE][addr & 0x0FFF]++;
+#endif
+  return (uint16_t)mem->mem[addr & 0x0FFF] << 8 | mem->mem[(addr + 1) & 0x0FFF];
+}
+
+// the slow side of the write barrier, for writes to code
+void chirp_mem_write_code(ChirpMemory* mem, const uint16_t addr, const uint8_t value)
+{
+  ChirpMemStats* stats = &mem->stats;
+  stats->code_writes++;
+  if (mem->mem[addr] == value)
+  {
+    return;
+  }
+
+  mem->mem[addr] = value;
+  if (stats->code_changes++ == 0)
+  {
+    stats->first_change = addr;
+  }
+
+  const uint16_t granule = addr >> CHIRP_MEM_GRANULE_SHIFT;
+  if ((stats->changed_granules[granule >> 6] >> (granule & 63) & 1) == 0)
+  {
+    stats->changed_granules[granule >> 6] |= (uint64_t)1 << (granule & 63);
+    stats->changed_granule_count++;
+  }
+
+  chirp_mem_notify(mem, addr, addr + 1);
+}
+
+// a write to a granule that is neither code nor watched, which is nearly all of them, costs a single test over a bare
+// store
 void chirp_mem_write(ChirpMemory* mem, const uint16_t addr, const uint8_t value)
 {
-  mem->mem[addr & 0x0FFF] = value;
+  const uint16_t address = addr & 0x0FFF;
+#ifdef CHIRP_INSTRUMENT
+  mem->heat->counts[CHIRP_MEM_ACCESS_WRITE][address]++;
+#endif
+  if (chirp_mem_is_marked(mem->barrier, address))
+  {
+    if (chirp_mem_is_code(mem, address))
+    {
+      chirp_mem_write_code(mem, address, value);
+    }
+    else
+    {
+      mem->mem[address] = value;
+    }
+    if (chirp_mem_is_marked(mem->watched, address) && mem->written != NULL)
+    {
+      mem->written(mem->written_context, address, value);
+    }
+    return;
+  }
+
+  mem->mem[address] = value;
+}
+
+// registers a hook for changes to code; false if there are CHIRP_MEM_MAX_WATCHERS already
+bool chirp_mem_watch(ChirpMemory* mem, const ChirpMemCodeWritten code_written, void* context)
+{
+  if (mem->watcher_count == CHIRP_MEM_MAX_WATCHERS)
+  {
+    return false;
+  }
+
+  mem->watchers[mem->watcher_count++] = (ChirpMemWatcher){code_written, context};
+  return true;
+}
+
+// sets the bit of every granule the size bytes from addr on touch, in marks and in the barrier
+void chirp_mem_mark(ChirpMemory* mem, uint64_t* marks, const uint16_t addr, const uint16_t size)
+{
+  if (size == 0)
+  {
+    return;
+  }
+
+  const int last = ((addr + size - 1) & 0x0FFF) >> CHIRP_MEM_GRANULE_SHIFT;
+  for (int granule = (addr & 0x0FFF) >> CHIRP_MEM_GRANULE_SHIFT;; granule = (granule + 1) % CHIRP_MEM_GRANULE_COUNT)
+  {
+    marks[granule >> 6] |= (uint64_t)1 << (granule & 63);
+    mem->barrier[granule >> 6] |= (uint64_t)1 << (granule & 63);
+    if (granule == last)
+    {
+      break;
+    }
+  }
+}
+
+// marks every granule the size bytes from addr on touch as code
+void chirp_mem_mark_code(ChirpMemory* mem, const uint16_t addr, const uint16_t size)
+{
+  chirp_mem_mark(mem, mem->code, addr, size);
+}
+
+// sets the hook for writes to watched granules; there is only one, for the host to pass on as it sees fit. NULL stops
+// watching altogether, taking the watched granules that are not code out of the write barrier again
+void chirp_mem_watch_writes(ChirpMemory* mem, const ChirpMemWritten written, void* context)
+{
+  mem->written = written;
+  mem->written_context = context;
+  if (written == NULL)
+  {
+    memset(mem->watched, 0, sizeof(mem->watched));
+    memcpy(mem->barrier, mem->code, sizeof(mem->barrier));
+  }
+}
+
+// every write to the granules the size bytes from addr on touch goes to the write hook from now on
+void chirp_mem_mark_watched(ChirpMemory* mem, const uint16_t addr, const uint16_t size)
+{
+  chirp_mem_mark(mem, mem->watched, addr, size);
 }
 
 void chirp_mem_print_memory_block(
@@ -80,7 +235,7 @@ void chirp_mem_print_memory_block(
 {
   for (uint16_t i = start_addr; i <= end_addr; i += row_size)
   {
-    const uint16_t remaining = CHIRP_EMULATOR_ADDR_END - i + 1;
+    const uint16_t remaining = end_addr - i + 1;
     const uint16_t current_row_size = remaining < row_size ? remaining : row_size;
 
     char block[current_row_size][3]; // 2 hex digits + null
@@ -114,3 +269,45 @@ void chirp_mem_view(const ChirpMemory* mem)
   chirp_mem_print_memory_block(mem, CHIRP_INSTRUCTIONS_ADDR_START, CHIRP_INSTRUCTIONS_ADDR_END, 50);
   printf("=== instructions ===\n");
 }
+
+#ifdef CHIRP_INSTRUMENT
+/**
+ * Prints the count addresses accessed most of each kind, with how often, which is where the hot data structures of a
+ * ROM are; only addresses that were accessed at all are listed.
+ */
+void chirp_mem_heat_report(const ChirpMemory* mem, const int count)
+{
+  static const char* const kinds[CHIRP_MEM_ACCESS_KINDS] = {"read", "written", "executed"};
+
+  for (int kind = 0; kind < CHIRP_MEM_ACCESS_KINDS; kind++)
+  {
+    const uint32_t* counts = mem->heat->counts[kind];
+    printf("most %s:", kinds[kind]);
+
+    // a selection pass per place, each taking the hottest address below the previous one
+    uint32_t below = UINT32_MAX;
+    int below_addr = -1;
+    for (int place = 0; place < count; place++)
+    {
+      int hottest = -1;
+      for (int addr = 0; addr < CHIRP_MEMORY_SIZE; addr++)
+      {
+        const bool is_below = counts[addr] < below || (counts[addr] == below && addr > below_addr);
+        if (counts[addr] > 0 && is_below && (hottest < 0 || counts[addr] > counts[hottest]))
+        {
+          hottest = addr;
+        }
+      }
+      if (hottest < 0)
+      {
+        break;
+      }
+
+      printf(" %03X (%u)", hottest, counts[hottest]);
+      below = counts[hottest];
+      below_addr = hottest;
+    }
+    printf("\n");
+  }
+}
+#endif
@@ -1,6 +1,7 @@
 #ifndef CHIRP_MEMORY_H
 #define CHIRP_MEMORY_H
 
+#include <stdbool.h>
 #include <stdint.h>
 
 #define CHIRP_MEMORY_SIZE 4096
@@ -18,14 +19,95 @@
 #define CHIRP_INSTRUCTIONS_ADDR_END 0xFFF
 #define CHIRP_INSTRUCTIONS_REGION_SIZE (CHIRP_INSTRUCTIONS_ADDR_END - CHIRP_INSTRUCTIONS_ADDR_START)
 
+// self-modifying code: memory is split into granules, and a granule is marked as code once an instruction is fetched
+// from it or translated from it. Marks are only ever added, so that anything derived from code can count on a write to
+// it going through the write barrier in chirp_mem_write, which tells the watchers about every byte of code it changes.
+// Granules can also be marked as watched, for the host to hear of every write to them, see plugin.h
+#define CHIRP_MEM_GRANULE_SHIFT 4 // 16 bytes, 8 instructions
+#define CHIRP_MEM_GRANULE_COUNT (CHIRP_MEMORY_SIZE >> CHIRP_MEM_GRANULE_SHIFT)
+#define CHIRP_MEM_MAX_WATCHERS 4
+
+// told that the code from start up to end changed, or may have
+typedef void (*ChirpMemCodeWritten)(void* context, uint16_t start, uint16_t end);
+
+// told about every write to a watched granule once it is stored, whether or not it changed anything
+typedef void (*ChirpMemWritten)(void* context, uint16_t addr, uint8_t value);
+
+typedef struct ChirpMemWatcher
+{
+  ChirpMemCodeWritten code_written;
+  void* context;
+} ChirpMemWatcher;
+
+// how often the ROM writes to its own code
+typedef struct ChirpMemStats
+{
+  uint64_t code_writes;      // writes that landed in a granule marked as code
+  uint64_t code_changes;     // the ones among them that changed the byte, which the watchers were told about
+  uint16_t first_change;     // address of the first byte of code that changed
+  int changed_granule_count; // granules with at least one change
+  uint64_t changed_granules[CHIRP_MEM_GRANULE_COUNT / 64];
+} ChirpMemStats;
+
+#ifdef CHIRP_INSTRUMENT
+// instrumented builds (make instrument) count every access to every address, for the heatmap in the window (F2) and
+// the hottest addresses --debug prints on exit; the counters only ever go up, so readers keep their own last values
+#define CHIRP_MEM_ACCESS_READ 0
+#define CHIRP_MEM_ACCESS_WRITE 1
+#define CHIRP_MEM_ACCESS_EXECUTE 2 // instruction fetches, which are not counted as reads
+#define CHIRP_MEM_ACCESS_KINDS 3
+
+typedef struct ChirpMemHeat
+{
+  uint32_t counts[CHIRP_MEM_ACCESS_KINDS][CHIRP_MEMORY_SIZE];
+} ChirpMemHeat;
+#endif
+
+// only ever copied with chirp_mem_copy, since the watchers belong to the instance the memory is part of
 typedef struct ChirpMemory
 {
   uint8_t mem[CHIRP_MEMORY_SIZE];
+  uint64_t code[CHIRP_MEM_GRANULE_COUNT / 64];    // one bit per granule marked as code
+  uint64_t watched[CHIRP_MEM_GRANULE_COUNT / 64]; // one bit per granule whose writes go to written
+  uint64_t barrier[CHIRP_MEM_GRANULE_COUNT / 64]; // code or watched, so writes to it take the slow path
+  ChirpMemStats stats;
+
+  ChirpMemWatcher watchers[CHIRP_MEM_MAX_WATCHERS];
+  int watcher_count;
+  ChirpMemWritten written; // NULL unless writes are watched
+  void* written_context;
+
+#ifdef CHIRP_INSTRUMENT
+  ChirpMemHeat* heat; // behind a pointer so that reads through a const memory can count, and never copied
+#endif
 } ChirpMemory;
 
 ChirpMemory* chirp_mem_new();
+void chirp_mem_free(ChirpMemory* mem);
+void chirp_mem_clear(ChirpMemory* mem);
+void chirp_mem_copy(ChirpMemory* dst, const ChirpMemory* src);
 uint8_t chirp_mem_read(const ChirpMemory* mem, uint16_t addr);
 void chirp_mem_write(ChirpMemory* mem, uint16_t addr, uint8_t value);
+uint16_t chirp_mem_fetch(const ChirpMemory* mem, uint16_t addr);
 void chirp_mem_view(const ChirpMemory* mem);
 
+bool chirp_mem_watch(ChirpMemory* mem, ChirpMemCodeWritten code_written, void* context);
+void chirp_mem_mark_code(ChirpMemory* mem, uint16_t addr, uint16_t size);
+void chirp_mem_watch_writes(ChirpMemory* mem, ChirpMemWritten written, void* context);
+void chirp_mem_mark_watched(ChirpMemory* mem, uint16_t addr, uint16_t size);
+#ifdef CHIRP_INSTRUMENT
+void chirp_mem_heat_report(const ChirpMemory* mem, int count);
+#endif
+
+static inline bool chirp_mem_is_marked(const uint64_t* marks, const uint16_t addr)
+{
+  const uint16_t granule = (addr & 0x0FFF) >> CHIRP_MEM_GRANULE_SHIFT;
+  return (marks[granule >> 6] >> (granule & 63) & 1) != 0;
+}
+
+static inline bool chirp_mem_is_code(const ChirpMemory* mem, const uint16_t addr)
+{
+  return chirp_mem_is_marked(mem->code, addr);
+}
+
 #endif // CHIRP_MEMORY_H
@@ -0,0 +1,261 @@
+#include "metrics.h"
+
+#include <stdlib.h>
+
+#define CHIRP_HISTOGRAM_SUB_BITS 4 // log2 of CHIRP_HISTOGRAM_SUB_BUCKETS
+
+double chirp_metrics_seconds(const uint64_t from, const uint64_t to)
+{
+  return (double)(to - from) / (double)SDL_GetPerformanceFrequency();
+}
+
+int chirp_histogram_bucket(int64_t value)
+{
+  if (value < 0)
+  {
+    value = 0;
+  }
+  if (value > INT32_MAX)
+  {
+    value = INT32_MAX;
+  }
+  if (value < 2 * CHIRP_HISTOGRAM_SUB_BUCKETS)
+  {
+    return (int)value;
+  }
+
+  int msb = 0;
+  while ((value >> (msb + 1)) != 0)
+  {
+    msb++;
+  }
+
+  const int shift = msb - CHIRP_HISTOGRAM_SUB_BITS;
+  return (shift + 1) * CHIRP_HISTOGRAM_SUB_BUCKETS + (int)(value >> shift) - CHIRP_HISTOGRAM_SUB_BUCKETS;
+}
+
+// middle of the range of values counted in a bucket
+int chirp_histogram_value(const int bucket)
+{
+  if (bucket < 2 * CHIRP_HISTOGRAM_SUB_BUCKETS)
+  {
+    return bucket;
+  }
+
+  const int shift = bucket / CHIRP_HISTOGRAM_SUB_BUCKETS - 1;
+  const int64_t low = (int64_t)(bucket % CHIRP_HISTOGRAM_SUB_BUCKETS + CHIRP_HISTOGRAM_SUB_BUCKETS) << shift;
+  const int64_t middle = low + ((int64_t)1 << shift) / 2;
+  return middle > INT32_MAX ? INT32_MAX : (int)middle;
+}
+
+void chirp_histogram_record(ChirpHistogram* histogram, const int64_t value)
+{
+  SDL_AddAtomicInt(&histogram->counts[chirp_histogram_bucket(value)], 1);
+  SDL_AddAtomicInt(&histogram->total, 1);
+
+  // a single writer means nothing else can raise the maximum in between
+  const int clamped = value < 0 ? 0 : value > INT32_MAX ? INT32_MAX : (int)value;
+  if (clamped > SDL_GetAtomicInt(&histogram->max))
+  {
+    SDL_SetAtomicInt(&histogram->max, clamped);
+  }
+}
+
+// smallest value at least the given fraction of the recorded values are below, 0 if nothing was recorded
+int chirp_histogram_percentile(ChirpHistogram* histogram, const double percentile)
+{
+  const int total = SDL_GetAtomicInt(&histogram->total);
+  if (total == 0)
+  {
+    return 0;
+  }
+
+  const int64_t rank = (int64_t)(percentile * total + 0.5);
+  int64_t seen = 0;
+  for (int i = 0; i < CHIRP_HISTOGRAM_BUCKETS; i++)
+  {
+    seen += SDL_GetAtomicInt(&histogram->counts[i]);
+    if (seen >= rank && seen > 0)
+    {
+      const int value = chirp_histogram_value(i);
+      const int max = SDL_GetAtomicInt(&histogram->max);
+      return value < max ? value : max;
+    }
+  }
+
+  return SDL_GetAtomicInt(&histogram->max);
+}
+
+ChirpMetrics* chirp_metrics_new(const bool is_realtime)
+{
+  // zeroed memory is a valid empty histogram and a valid zero atomic
+  ChirpMetrics* metrics = calloc(1, sizeof(ChirpMetrics));
+  if (metrics == NULL)
+  {
+    fprintf(stderr, "failed to allocate memory for metrics\n");
+    exit(1);
+  }
+
+  metrics->is_realtime = is_realtime;
+  metrics->start = SDL_GetPerformanceCounter();
+  metrics->report_start = metrics->start;
+
+  return metrics;
+}
+
+void chirp_metrics_free(ChirpMetrics* metrics)
+{
+  free(metrics);
+}
+
+// called once per 60Hz frame, after the instructions for it have run, unless the frame was only catching up
+void chirp_metrics_record_frame(ChirpMetrics* metrics, const uint64_t instruction_count)
+{
+  const uint64_t now = SDL_GetPerformanceCounter();
+  if (metrics->last_frame != 0)
+  {
+    const int64_t frame_us = (int64_t)(chirp_metrics_seconds(metrics->last_frame, now) * 1e6);
+    chirp_histogram_record(&metrics->frame_time, frame_us);
+    if (metrics->is_realtime)
+    {
+      chirp_histogram_record(&metrics->tick_jitter, llabs(frame_us - CHIRP_METRICS_FRAME_US));
+    }
+  }
+
+  metrics->last_frame = now;
+  metrics->instructions = instruction_count;
+  metrics->frames++;
+}
+
+// a frame that only makes up for lost time comes right after the one before it, so timing it would record a frame
+// of nearly nothing; the frame that follows the catching up is timed instead and shows the whole stall
+void chirp_metrics_record_catchup(ChirpMetrics* metrics)
+{
+  metrics->frames++;
+  metrics->catchup_frames++;
+}
+
+// time spent paused or stopped in a debugger is not a stall, so the next frame starts the measurement over
+void chirp_metrics_pause(ChirpMetrics* metrics)
+{
+  metrics->last_frame = 0;
+}
+
+// start is the performance counter from right before the draw
+void chirp_metrics_record_render(ChirpMetrics* metrics, const uint64_t start)
+{
+  chirp_histogram_record(&metrics->render_time,
+                         (int64_t)(chirp_metrics_seconds(start, SDL_GetPerformanceCounter()) * 1e6));
+}
+
+/**
+ * Called from the audio callback with what was still queued when it was called and what it supplied.
+ *
+ * The device buffers roughly what it asked for last time, so a callback that comes more than twice as late as that
+ * means the device ran dry and played silence in between.
+ */
+void chirp_metrics_record_audio(ChirpMetrics* metrics,
+                                const int queued_samples,
+                                const int supplied_samples,
+                                const int sample_rate)
+{
+  const uint64_t now = SDL_GetPerformanceCounter();
+  if (metrics->audio_last_callback != 0 && chirp_metrics_seconds(metrics->audio_last_callback, now) >
+                                             2.0 * metrics->audio_last_supplied)
+  {
+    SDL_AddAtomicInt(&metrics->audio_underruns, 1);
+  }
+
+  metrics->audio_last_callback = now;
+  metrics->audio_last_supplied = (double)supplied_samples / (double)sample_rate;
+  chirp_histogram_record(&metrics->audio_queue, queued_samples);
+  SDL_AddAtomicInt(&metrics->audio_callbacks, 1);
+}
+
+/**
+ * Once every CHIRP_METRICS_REPORT_INTERVAL, works out the instructions per second since the last report and prints
+ * a summary line to stderr. Returns whether it did, so that the caller knows to refresh the overlay.
+ */
+bool chirp_metrics_report(ChirpMetrics* metrics)
+{
+  const uint64_t now = SDL_GetPerformanceCounter();
+  const double elapsed = chirp_metrics_seconds(metrics->report_start, now);
+  if (elapsed < CHIRP_METRICS_REPORT_INTERVAL)
+  {
+    return false;
+  }
+
+  metrics->ips = (double)(metrics->instructions - metrics->report_instructions) / elapsed;
+  metrics->report_start = now;
+  metrics->report_instructions = metrics->instructions;
+
+  fprintf(stderr,
+          "ips %.0f  frame p50 %.2fms p99 %.2fms  catch-up %llu  jitter p99 %.2fms  render p99 %.2fms"
+          "  audio queue p50 %d  underruns %d\n",
+          metrics->ips,
+          chirp_histogram_percentile(&metrics->frame_time, 0.5) / 1000.0,
+          chirp_histogram_percentile(&metrics->frame_time, 0.99) / 1000.0,
+          (unsigned long long)metrics->catchup_frames,
+          chirp_histogram_percentile(&metrics->tick_jitter, 0.99) / 1000.0,
+          chirp_histogram_percentile(&metrics->render_time, 0.99) / 1000.0,
+          chirp_histogram_percentile(&metrics->audio_queue, 0.5),
+          SDL_GetAtomicInt(&metrics->audio_underruns));
+
+  return true;
+}
+
+// one metric per line, short enough to fit across the window in the debug font
+void chirp_metrics_format_overlay(ChirpMetrics* metrics, char* out, const size_t size)
+{
+  snprintf(out,
+           size,
+           "IPS     %.0f\n"
+           "FRAME   %.1f %.1f %.1f ms\n"
+           "JITTER  %.1f %.1f ms\n"
+           "RENDER  %.1f %.1f ms\n"
+           "AUDIO   %d queued %d under",
+           metrics->ips,
+           chirp_histogram_percentile(&metrics->frame_time, 0.5) / 1000.0,
+           chirp_histogram_percentile(&metrics->frame_time, 0.99) / 1000.0,
+           SDL_GetAtomicInt(&metrics->frame_time.max) / 1000.0,
+           chirp_histogram_percentile(&metrics->tick_jitter, 0.5) / 1000.0,
+           chirp_histogram_percentile(&metrics->tick_jitter, 0.99) / 1000.0,
+           chirp_histogram_percentile(&metrics->render_time, 0.5) / 1000.0,
+           chirp_histogram_percentile(&metrics->render_time, 0.99) / 1000.0,
+           chirp_histogram_percentile(&metrics->audio_queue, 0.5),
+           SDL_GetAtomicInt(&metrics->audio_underruns));
+}
+
+void chirp_metrics_write_histogram(FILE* file, const char* name, ChirpHistogram* histogram, const bool is_last)
+{
+  fprintf(file,
+          "  \"%s\": {\"count\": %d, \"p50\": %d, \"p90\": %d, \"p99\": %d, \"p999\": %d, \"max\": %d}%s\n",
+          name,
+          SDL_GetAtomicInt(&histogram->total),
+          chirp_histogram_percentile(histogram, 0.5),
+          chirp_histogram_percentile(histogram, 0.9),
+          chirp_histogram_percentile(histogram, 0.99),
+          chirp_histogram_percentile(histogram, 0.999),
+          SDL_GetAtomicInt(&histogram->max),
+          is_last ? "" : ",");
+}
+
+// everything collected since the metrics were created
+void chirp_metrics_write_json(ChirpMetrics* metrics, FILE* file)
+{
+  const double uptime = chirp_metrics_seconds(metrics->start, SDL_GetPerformanceCounter());
+
+  fprintf(file, "{\n");
+  fprintf(file, "  \"uptime_seconds\": %.3f,\n", uptime);
+  fprintf(file, "  \"instructions\": %llu,\n", (unsigned long long)metrics->instructions);
+  fprintf(file, "  \"frames\": %llu,\n", (unsigned long long)metrics->frames);
+  fprintf(file, "  \"catchup_frames\": %llu,\n", (unsigned long long)metrics->catchup_frames);
+  fprintf(file, "  \"ips\": %.0f,\n", uptime > 0.0 ? (double)metrics->instructions / uptime : 0.0);
+  fprintf(file, "  \"audio_callbacks\": %d,\n", SDL_GetAtomicInt(&metrics->audio_callbacks));
+  fprintf(file, "  \"audio_underruns\": %d,\n", SDL_GetAtomicInt(&metrics->audio_underruns));
+  chirp_metrics_write_histogram(file, "frame_time_us", &metrics->frame_time, false);
+  chirp_metrics_write_histogram(file, "tick_jitter_us", &metrics->tick_jitter, false);
+  chirp_metrics_write_histogram(file, "render_time_us", &metrics->render_time, false);
+  chirp_metrics_write_histogram(file, "audio_queue_samples", &metrics->audio_queue, true);
+  fprintf(file, "}\n");
+}
@@ -0,0 +1,70 @@
+#ifndef CHIRP_METRICS_H
+#define CHIRP_METRICS_H
+
+#include "SDL3/SDL.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// runtime metrics: counters and latency histograms filled in by the emulator loop, the renderer and the audio
+// callback, read back for the on-screen overlay, a periodic line on stderr and a JSON dump at exit
+
+// values below 2 * CHIRP_HISTOGRAM_SUB_BUCKETS are counted exactly; above that, every power of two is split into
+// CHIRP_HISTOGRAM_SUB_BUCKETS buckets, so a recorded value is never more than 1/16 off
+#define CHIRP_HISTOGRAM_SUB_BUCKETS 16
+#define CHIRP_HISTOGRAM_BUCKETS (CHIRP_HISTOGRAM_SUB_BUCKETS * 28) // up to INT32_MAX
+
+#define CHIRP_METRICS_REPORT_INTERVAL 1.0 // seconds between lines on stderr and overlay updates
+#define CHIRP_METRICS_FRAME_US 16667      // length of a 60Hz frame, for the tick jitter
+#define CHIRP_METRICS_OVERLAY_SIZE 512
+
+// lock-free so that any one thread can record into it while another reads it; only one thread records into each
+typedef struct ChirpHistogram
+{
+  SDL_AtomicInt counts[CHIRP_HISTOGRAM_BUCKETS];
+  SDL_AtomicInt total;
+  SDL_AtomicInt max;
+} ChirpHistogram;
+
+typedef struct ChirpMetrics
+{
+  bool is_realtime; // paced by the wall clock; frames run as fast as possible otherwise, so they have no jitter
+  uint64_t start;   // performance counter when the metrics were created
+
+  // only ever touched by the emulator
+  uint64_t instructions;
+  uint64_t frames;
+  uint64_t catchup_frames; // frames run back to back to make up for a stall, which are counted but not timed
+  uint64_t last_frame; // performance counter at the last frame, 0 after a pause
+  uint64_t report_start;
+  uint64_t report_instructions;
+  double ips;                 // instructions per second over the last report interval
+  ChirpHistogram frame_time;  // microseconds between two 60Hz frames
+  ChirpHistogram tick_jitter; // microseconds a frame came early or late by
+  ChirpHistogram render_time; // microseconds spent in sdl_window_draw_display
+
+  // only ever touched from the audio callback
+  uint64_t audio_last_callback;
+  double audio_last_supplied; // seconds of audio supplied by the last callback
+  ChirpHistogram audio_queue; // samples still queued when the device asks for more
+
+  SDL_AtomicInt audio_callbacks;
+  SDL_AtomicInt audio_underruns; // callbacks that came too late for the device to have kept playing
+} ChirpMetrics;
+
+void chirp_histogram_record(ChirpHistogram* histogram, int64_t value);
+int chirp_histogram_percentile(ChirpHistogram* histogram, double percentile);
+
+ChirpMetrics* chirp_metrics_new(bool is_realtime);
+void chirp_metrics_free(ChirpMetrics* metrics);
+void chirp_metrics_record_frame(ChirpMetrics* metrics, uint64_t instruction_count);
+void chirp_metrics_record_catchup(ChirpMetrics* metrics);
+void chirp_metrics_pause(ChirpMetrics* metrics);
+void chirp_metrics_record_render(ChirpMetrics* metrics, uint64_t start);
+void chirp_metrics_record_audio(ChirpMetrics* metrics, int queued_samples, int supplied_samples, int sample_rate);
+bool chirp_metrics_report(ChirpMetrics* metrics);
+void chirp_metrics_format_overlay(ChirpMetrics* metrics, char* out, size_t size);
+void chirp_metrics_write_json(ChirpMetrics* metrics, FILE* file);
+
+#endif // CHIRP_METRICS_H
@@ -0,0 +1,295 @@
+// dlopen is POSIX, outside of what -std=c11 exposes
+#define _POSIX_C_SOURCE 200809L
+
+#include "plugin.h"
+
+#include <dlfcn.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "idle.h"
+
+// whatever a plugin changes comes from outside of the machine, which a loop parked as idle has to see
+void chirp_plugin_changed(ChirpPluginHost* host)
+{
+  chirp_idle_catch_up(host->chirp);
+  chirp_idle_clear(host->chirp);
+}
+
+void chirp_plugin_mark(uint64_t* bits, const uint16_t address)
+{
+  bits[address >> 6] |= (uint64_t)1 << (address & 63);
+}
+
+bool chirp_plugin_on_frame(ChirpPluginHost* host, const ChirpPluginFrameHook hook, void* user)
+{
+  if (host->frame_hook_count == CHIRP_PLUGIN_HOOKS)
+  {
+    return false;
+  }
+
+  host->frame_hooks[host->frame_hook_count++] = (ChirpPluginFrame){hook, user};
+  return true;
+}
+
+bool chirp_plugin_on_pc(ChirpPluginHost* host, const uint16_t address, const ChirpPluginPcHook hook, void* user)
+{
+  if (host->pc_hook_count == CHIRP_PLUGIN_HOOKS || address >= CHIRP_MEMORY_SIZE)
+  {
+    return false;
+  }
+
+  host->pc_hooks[host->pc_hook_count++] = (ChirpPluginPc){address, hook, user};
+  chirp_plugin_mark(host->pc_hooked, address);
+  return true;
+}
+
+bool chirp_plugin_on_write(
+  ChirpPluginHost* host,
+  const uint16_t start,
+  const uint16_t end,
+  const ChirpPluginWriteHook hook,
+  void* user
+)
+{
+  if (host->write_hook_count == CHIRP_PLUGIN_HOOKS || start >= end || end > CHIRP_MEMORY_SIZE)
+  {
+    return false;
+  }
+
+  host->write_hooks[host->write_hook_count++] = (ChirpPluginWrite){start, end, hook, user};
+  for (uint16_t address = start; address < end; address++)
+  {
+    chirp_plugin_mark(host->write_hooked, address);
+  }
+  chirp_mem_mark_watched(host->chirp->mem, start, end - start);
+  return true;
+}
+
+uint8_t chirp_plugin_read_register(ChirpPluginHost* host, const int index)
+{
+  return chirp_registers_read(host->chirp->registers, index & 0xF);
+}
+
+void chirp_plugin_write_register(ChirpPluginHost* host, const int index, const uint8_t value)
+{
+  chirp_registers_write(host->chirp->registers, index & 0xF, value);
+  chirp_plugin_changed(host);
+}
+
+uint16_t chirp_plugin_read_index(ChirpPluginHost* host)
+{
+  return host->chirp->index_register;
+}
+
+void chirp_plugin_write_index(ChirpPluginHost* host, const uint16_t value)
+{
+  host->chirp->index_register = value;
+  chirp_plugin_changed(host);
+}
+
+uint16_t chirp_plugin_read_pc(ChirpPluginHost* host)
+{
+  return host->chirp->program_counter;
+}
+
+void chirp_plugin_write_pc(ChirpPluginHost* host, const uint16_t value)
+{
+  host->chirp->program_counter = value;
+  chirp_plugin_changed(host);
+}
+
+uint8_t chirp_plugin_read_memory(ChirpPluginHost* host, const uint16_t address)
+{
+  return chirp_mem_read(host->chirp->mem, address);
+}
+
+void chirp_plugin_write_memory(ChirpPluginHost* host, const uint16_t address, const uint8_t value)
+{
+  chirp_mem_write(host->chirp->mem, address, value);
+  chirp_plugin_changed(host);
+}
+
+bool chirp_plugin_read_key(ChirpPluginHost* host, const int key)
+{
+  return key >= 0 && key < CHIRP_KEYBOARD_SIZE && chirp_keyboard_read(host->chirp->keyboard, key);
+}
+
+// the machine wakes up for keys on its own
+void chirp_plugin_set_key(ChirpPluginHost* host, const int key, const bool is_pressed)
+{
+  chirp_set_key(host->chirp, key, is_pressed);
+}
+
+bool chirp_plugin_read_pixel(ChirpPluginHost* host, const int x, const int y)
+{
+  return x >= 0 && x < DISPLAY_WIDTH && y >= 0 && y < DISPLAY_HEIGHT
+         && chirp_display_get_pixel(host->chirp->display, x, y);
+}
+
+uint64_t chirp_plugin_frame_count(ChirpPluginHost* host)
+{
+  return host->chirp->frame_count;
+}
+
+uint64_t chirp_plugin_instruction_count(ChirpPluginHost* host)
+{
+  return host->chirp->instruction_count;
+}
+
+void chirp_plugin_stop(ChirpPluginHost* host)
+{
+  host->chirp->is_running = false;
+}
+
+// the memory's write hook, passed on to the plugins whose range the address is in
+void chirp_plugins_written(void* context, const uint16_t address, const uint8_t value)
+{
+  ChirpPluginHost* host = context;
+  if ((host->write_hooked[address >> 6] >> (address & 63) & 1) == 0)
+  {
+    return;
+  }
+
+  for (int i = 0; i < host->write_hook_count; i++)
+  {
+    const ChirpPluginWrite* write = &host->write_hooks[i];
+    if (address >= write->start && address < write->end)
+    {
+      write->hook(host, write->user, address, value);
+    }
+  }
+}
+
+// a host without any plugins, which the instance calls into from then on
+ChirpPluginHost* chirp_plugins_new(Chirp* chirp)
+{
+  ChirpPluginHost* host = calloc(1, sizeof(ChirpPluginHost));
+  if (host == NULL)
+  {
+    fprintf(stderr, "out of memory\n");
+    exit(1);
+  }
+
+  host->chirp = chirp;
+  host->api = (ChirpPluginApi){
+    .abi_version = CHIRP_PLUGIN_ABI_VERSION,
+    .size = sizeof(ChirpPluginApi),
+    .host = host,
+    .on_frame = chirp_plugin_on_frame,
+    .on_pc = chirp_plugin_on_pc,
+    .on_write = chirp_plugin_on_write,
+    .read_register = chirp_plugin_read_register,
+    .write_register = chirp_plugin_write_register,
+    .read_index = chirp_plugin_read_index,
+    .write_index = chirp_plugin_write_index,
+    .read_pc = chirp_plugin_read_pc,
+    .write_pc = chirp_plugin_write_pc,
+    .read_memory = chirp_plugin_read_memory,
+    .write_memory = chirp_plugin_write_memory,
+    .read_key = chirp_plugin_read_key,
+    .set_key = chirp_plugin_set_key,
+    .read_pixel = chirp_plugin_read_pixel,
+    .frame_count = chirp_plugin_frame_count,
+    .instruction_count = chirp_plugin_instruction_count,
+    .stop = chirp_plugin_stop,
+  };
+
+  chirp->plugins = host;
+  chirp_mem_watch_writes(chirp->mem, chirp_plugins_written, host);
+  return host;
+}
+
+// calls every plugin's exit in the order they were loaded, then unloads them and detaches the host from the instance
+void chirp_plugins_free(ChirpPluginHost* host)
+{
+  for (int i = 0; i < host->plugin_count; i++)
+  {
+    if (host->plugins[i].exit != NULL)
+    {
+      host->plugins[i].exit(&host->api);
+    }
+  }
+  for (int i = 0; i < host->plugin_count; i++)
+  {
+    dlclose(host->plugins[i].handle);
+  }
+
+  host->chirp->plugins = NULL;
+  chirp_mem_watch_writes(host->chirp->mem, NULL, NULL);
+  free(host);
+}
+
+/**
+ * Loads the plugin spec names, PATH or PATH,ARGS, and lets it register its hooks. Returns false with a message on
+ * stderr if it cannot be loaded or turns itself down; the hooks it registered before that stay.
+ */
+bool chirp_plugins_load(ChirpPluginHost* host, const char* spec)
+{
+  if (host->plugin_count == CHIRP_PLUGIN_MAX)
+  {
+    fprintf(stderr, "no more than %d plugins can be loaded\n", CHIRP_PLUGIN_MAX);
+    return false;
+  }
+
+  char path[1024];
+  const char* comma = strchr(spec, ',');
+  const size_t length = comma != NULL ? (size_t)(comma - spec) : strlen(spec);
+  if (length >= sizeof(path))
+  {
+    fprintf(stderr, "plugin path is too long: %s\n", spec);
+    return false;
+  }
+  memcpy(path, spec, length);
+  path[length] = '\0';
+
+  // without a slash dlopen would search the library path rather than load the file named
+  char local[sizeof(path) + 2];
+  snprintf(local, sizeof(local), "%s%s", strchr(path, '/') != NULL ? "" : "./", path);
+  void* handle = dlopen(local, RTLD_NOW | RTLD_LOCAL);
+  if (handle == NULL)
+  {
+    fprintf(stderr, "could not load the plugin %s: %s\n", path, dlerror());
+    return false;
+  }
+
+  const ChirpPluginInit init = (ChirpPluginInit)dlsym(handle, CHIRP_PLUGIN_INIT);
+  if (init == NULL)
+  {
+    fprintf(stderr, "%s is not a chirp plugin, it has no %s\n", path, CHIRP_PLUGIN_INIT);
+    dlclose(handle);
+    return false;
+  }
+
+  ChirpPlugin* plugin = &host->plugins[host->plugin_count++];
+  plugin->handle = handle;
+  plugin->exit = (ChirpPluginExit)dlsym(handle, CHIRP_PLUGIN_EXIT);
+  if (!init(&host->api, comma != NULL ? comma + 1 : ""))
+  {
+    fprintf(stderr, "the plugin %s failed to start\n", path);
+    plugin->exit = NULL;
+    return false;
+  }
+
+  return true;
+}
+
+void chirp_plugins_end_frame(ChirpPluginHost* host)
+{
+  for (int i = 0; i < host->frame_hook_count; i++)
+  {
+    host->frame_hooks[i].hook(host, host->frame_hooks[i].user, host->chirp->frame_count);
+  }
+}
+
+void chirp_plugins_reach(ChirpPluginHost* host, const uint16_t address)
+{
+  for (int i = 0; i < host->pc_hook_count; i++)
+  {
+    if (host->pc_hooks[i].address == address)
+    {
+      host->pc_hooks[i].hook(host, host->pc_hooks[i].user, address);
+    }
+  }
+}
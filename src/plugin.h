@@ -0,0 +1,71 @@
+#ifndef CHIRP_PLUGIN_H
+#define CHIRP_PLUGIN_H
+
+#include "chirp.h"
+#include "chirp_plugin.h"
+
+// the emulator's side of the plugin interface in chirp_plugin.h. The host belongs to a single instance and is never
+// copied, like a capture. Hooks are found through per-address bitmaps: a PC hook costs the instructions that do not
+// have one a single test, and only once any plugin is loaded; a write hook puts its granules behind the write barrier
+// in memory.h, so writes elsewhere cost nothing more
+
+#define CHIRP_PLUGIN_HOOKS 64 // hooks of each kind, over all plugins, which are at most CHIRP_PLUGIN_MAX
+
+typedef struct ChirpPlugin
+{
+  void* handle;
+  ChirpPluginExit exit; // NULL if the plugin has nothing to do on exit
+} ChirpPlugin;
+
+typedef struct ChirpPluginFrame
+{
+  ChirpPluginFrameHook hook;
+  void* user;
+} ChirpPluginFrame;
+
+typedef struct ChirpPluginPc
+{
+  uint16_t address;
+  ChirpPluginPcHook hook;
+  void* user;
+} ChirpPluginPc;
+
+typedef struct ChirpPluginWrite
+{
+  uint16_t start;
+  uint16_t end; // one past the last address
+  ChirpPluginWriteHook hook;
+  void* user;
+} ChirpPluginWrite;
+
+struct ChirpPluginHost
+{
+  Chirp* chirp;
+  ChirpPluginApi api;
+
+  ChirpPlugin plugins[CHIRP_PLUGIN_MAX];
+  int plugin_count;
+
+  ChirpPluginFrame frame_hooks[CHIRP_PLUGIN_HOOKS];
+  int frame_hook_count;
+  ChirpPluginPc pc_hooks[CHIRP_PLUGIN_HOOKS];
+  int pc_hook_count;
+  ChirpPluginWrite write_hooks[CHIRP_PLUGIN_HOOKS];
+  int write_hook_count;
+
+  uint64_t pc_hooked[CHIRP_MEMORY_SIZE / 64];    // one bit per address with a PC hook
+  uint64_t write_hooked[CHIRP_MEMORY_SIZE / 64]; // one bit per address with a write hook
+};
+
+ChirpPluginHost* chirp_plugins_new(Chirp* chirp);
+void chirp_plugins_free(ChirpPluginHost* host);
+bool chirp_plugins_load(ChirpPluginHost* host, const char* spec);
+void chirp_plugins_end_frame(ChirpPluginHost* host);
+void chirp_plugins_reach(ChirpPluginHost* host, uint16_t address);
+
+static inline bool chirp_plugins_is_pc_hooked(const ChirpPluginHost* host, const uint16_t address)
+{
+  return (host->pc_hooked[(address & 0x0FFF) >> 6] >> (address & 63) & 1) != 0;
+}
+
+#endif // CHIRP_PLUGIN_H
@@ -0,0 +1,71 @@
+#include "pool.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+// every instance in the pool is a clone of the prototype, sharing its config and boot image
+ChirpPool* chirp_pool_new(const Chirp* prototype, const int capacity)
+{
+  ChirpPool* pool = malloc(sizeof(ChirpPool));
+  if (pool == NULL)
+  {
+    fprintf(stderr, "out of memory\n");
+    exit(1);
+  }
+
+  pool->instances = malloc(sizeof(Chirp*) * capacity);
+  pool->available = malloc(sizeof(Chirp*) * capacity);
+  if (pool->instances == NULL || pool->available == NULL)
+  {
+    fprintf(stderr, "out of memory\n");
+    exit(1);
+  }
+
+  for (int i = 0; i < capacity; i++)
+  {
+    pool->instances[i] = chirp_clone(prototype);
+    pool->available[i] = pool->instances[i];
+  }
+
+  pool->capacity = capacity;
+  pool->available_count = capacity;
+
+  return pool;
+}
+
+void chirp_pool_free(ChirpPool* pool)
+{
+  for (int i = 0; i < pool->capacity; i++)
+  {
+    chirp_free(pool->instances[i]);
+  }
+
+  free(pool->instances);
+  free(pool->available);
+  free(pool);
+}
+
+// hands out an instance reset to its boot image, or NULL once the pool is exhausted
+Chirp* chirp_pool_acquire(ChirpPool* pool)
+{
+  if (pool->available_count == 0)
+  {
+    return NULL;
+  }
+
+  Chirp* chirp = pool->available[--pool->available_count];
+  chirp_reset(chirp);
+
+  return chirp;
+}
+
+void chirp_pool_release(ChirpPool* pool, Chirp* chirp)
+{
+  if (pool->available_count == pool->capacity)
+  {
+    // releasing more than was acquired means the instance is not from this pool
+    fprintf(stderr, "instance released to a full pool\n");
+    return;
+  }
+
+  pool->available[pool->available_count++] = chirp;
+}
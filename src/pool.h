@@ -0,0 +1,20 @@
+#ifndef CHIRP_POOL_H
+#define CHIRP_POOL_H
+
+#include "chirp.h"
+
+// fixed set of instances allocated up front so that steady-state restarts never allocate
+typedef struct ChirpPool
+{
+  Chirp** instances;
+  Chirp** available; // stack of instances that are not currently acquired
+  int capacity;
+  int available_count;
+} ChirpPool;
+
+ChirpPool* chirp_pool_new(const Chirp* prototype, int capacity);
+void chirp_pool_free(ChirpPool* pool);
+Chirp* chirp_pool_acquire(ChirpPool* pool);
+void chirp_pool_release(ChirpPool* pool, Chirp* chirp);
+
+#endif // CHIRP_POOL_H
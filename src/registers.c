@@ -1,5 +1,6 @@
 #include "registers.h"
 #include <stdlib.h>
+#include <string.h>
 
 ChirpRegisters* chirp_registers_new()
 {
@@ -7,14 +8,16 @@ ChirpRegisters* chirp_registers_new()
   ChirpRegisters* registers = malloc(sizeof(ChirpRegisters));
 
   // force initialize to 0
-  for (int i = 0; i < CHIRP_REGISTERS_SIZE; i++)
-  {
-    registers->registers[i] = 0;
-  }
+  chirp_registers_clear(registers);
 
   return registers;
 }
 
+void chirp_registers_clear(ChirpRegisters* registers)
+{
+  memset(registers->registers, 0, sizeof(registers->registers));
+}
+
 // TODO: Add guardrails to prevent out of bounds access
 uint8_t chirp_registers_read(const ChirpRegisters* registers, const int addr)
 {
@@ -11,6 +11,7 @@ typedef struct ChirpRegisters
 } ChirpRegisters;
 
 ChirpRegisters* chirp_registers_new();
+void chirp_registers_clear(ChirpRegisters* registers);
 uint8_t chirp_registers_read(const ChirpRegisters* registers, int addr);
 void chirp_registers_write(ChirpRegisters* registers, int addr, uint8_t value);
 
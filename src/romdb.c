@@ -0,0 +1,152 @@
+// mmap is POSIX, outside of what -std=c11 exposes
+#define _POSIX_C_SOURCE 200809L
+
+#include "romdb.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define CHIRP_ROM_HASH_BASIS 1469598103934665603ull
+#define CHIRP_ROM_HASH_PRIME 1099511628211ull
+
+// flag names as given on the command line, without the dashes, in CHIRP_QUIRK_* order
+static const char* const CHIRP_QUIRK_NAMES[CHIRP_QUIRK_COUNT] = {
+  "shift-vx",
+  "jump-with-vx",
+  "set-registers-increment-index",
+  "load-registers-increment-index",
+};
+
+// 64-bit FNV-1a of the ROM as loaded, without the fonts; diff.c hashes the state it reports on with it too
+uint64_t chirp_rom_hash(const uint8_t* rom, const size_t size)
+{
+  uint64_t hash = CHIRP_ROM_HASH_BASIS;
+  for (size_t i = 0; i < size; i++)
+  {
+    hash ^= rom[i];
+    hash *= CHIRP_ROM_HASH_PRIME;
+  }
+
+  return hash;
+}
+
+// name of the quirk behind bit number quirk of the CHIRP_QUIRK_* flags
+const char* chirp_quirk_name(const int quirk)
+{
+  return CHIRP_QUIRK_NAMES[quirk];
+}
+
+/**
+ * Maps the index at path and checks that it is one this build can read. Returns NULL with a message on stderr if it is
+ * not a usable index, or without a word if it is optional and there is no file there at all.
+ */
+ChirpRomDb* chirp_romdb_open(const char* path, const bool is_optional)
+{
+  const int fd = open(path, O_RDONLY);
+  if (fd < 0)
+  {
+    if (!is_optional || errno != ENOENT)
+    {
+      fprintf(stderr, "could not open the ROM database %s: %s\n", path, strerror(errno));
+    }
+    return NULL;
+  }
+
+  struct stat info;
+  if (fstat(fd, &info) != 0 || (size_t)info.st_size < sizeof(ChirpRomDbHeader))
+  {
+    fprintf(stderr, "%s is not a ROM database\n", path);
+    close(fd);
+    return NULL;
+  }
+
+  // the mapping stays valid once the descriptor is closed
+  const size_t size = info.st_size;
+  void* mapping = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (mapping == MAP_FAILED)
+  {
+    fprintf(stderr, "could not map the ROM database %s: %s\n", path, strerror(errno));
+    return NULL;
+  }
+
+  const ChirpRomDbHeader* header = mapping;
+  if (memcmp(header->magic, CHIRP_ROMDB_MAGIC, CHIRP_ROMDB_MAGIC_SIZE) != 0
+      || header->entry_size != sizeof(ChirpRomEntry)
+      || size != sizeof(ChirpRomDbHeader) + (size_t)header->entry_count * sizeof(ChirpRomEntry))
+  {
+    fprintf(stderr, "%s is not a ROM database this build can read, rebuild it with make db\n", path);
+    munmap(mapping, size);
+    return NULL;
+  }
+
+  ChirpRomDb* db = malloc(sizeof(ChirpRomDb));
+  if (db == NULL)
+  {
+    fprintf(stderr, "out of memory\n");
+    exit(1);
+  }
+
+  db->mapping = mapping;
+  db->size = size;
+  db->entries = (const ChirpRomEntry*)(header + 1);
+  db->entry_count = header->entry_count;
+
+  return db;
+}
+
+// entries found in the database point into it, so it has to outlive them
+void chirp_romdb_close(ChirpRomDb* db)
+{
+  munmap(db->mapping, db->size);
+  free(db);
+}
+
+// whether every string of the entry ends within its field, which only a corrupt or hand-made index gets wrong
+bool chirp_romdb_is_valid(const ChirpRomEntry* entry)
+{
+  return memchr(entry->title, '\0', sizeof(entry->title)) != NULL
+         && memchr(entry->platform, '\0', sizeof(entry->platform)) != NULL
+         && memchr(entry->keymap, '\0', sizeof(entry->keymap)) != NULL;
+}
+
+/**
+ * The entry for the ROM with the given hash, NULL if the database does not know it. Entries are only checked once they
+ * are found, so that opening the database stays free of work; one that does not hold up is reported on stderr and
+ * treated as unknown.
+ */
+const ChirpRomEntry* chirp_romdb_find(const ChirpRomDb* db, const uint64_t hash)
+{
+  uint32_t low = 0;
+  uint32_t high = db->entry_count;
+  while (low < high)
+  {
+    const uint32_t middle = low + (high - low) / 2;
+    const uint64_t found = db->entries[middle].hash;
+    if (found == hash)
+    {
+      if (!chirp_romdb_is_valid(&db->entries[middle]))
+      {
+        fprintf(stderr, "the ROM database entry for %016llx is corrupt, ignoring it\n", (unsigned long long)hash);
+        return NULL;
+      }
+      return &db->entries[middle];
+    }
+    if (found < hash)
+    {
+      low = middle + 1;
+    }
+    else
+    {
+      high = middle;
+    }
+  }
+
+  return NULL;
+}
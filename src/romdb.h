@@ -0,0 +1,62 @@
+#ifndef CHIRP_ROMDB_H
+#define CHIRP_ROMDB_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// ROM database: what is known about ROMs, keyed by a hash of their contents, so that a ROM runs with the right quirks,
+// speed and keys without anyone passing flags. chirp-db (tools/chirp_db.c) compiles it from roms/roms.tsv into an
+// index of fixed-size entries sorted by hash, which is memory-mapped as it is and binary searched in place, so nothing
+// is parsed or allocated at startup however large it grows. The index is in the byte order of the machine it was
+// built on, like the rest of out/
+
+#define CHIRP_ROMDB_MAGIC "CHIRPDB1"
+#define CHIRP_ROMDB_MAGIC_SIZE 8
+#define CHIRP_ROMDB_DEFAULT_PATH "out/roms.db" // where make db puts it
+
+#define CHIRP_ROMDB_TITLE_SIZE 48
+#define CHIRP_ROMDB_PLATFORM_SIZE 16
+#define CHIRP_ROMDB_KEYMAP_SIZE 17 // 16 keys and the terminator
+
+// the quirks a ROM can need, in the order of their flags on the command line
+#define CHIRP_QUIRK_SHIFT_VX 0x1
+#define CHIRP_QUIRK_JUMP_WITH_VX 0x2
+#define CHIRP_QUIRK_SET_REGISTERS_INCREMENT_INDEX 0x4
+#define CHIRP_QUIRK_LOAD_REGISTERS_INCREMENT_INDEX 0x8
+#define CHIRP_QUIRK_COUNT 4
+
+typedef struct ChirpRomDbHeader
+{
+  char magic[CHIRP_ROMDB_MAGIC_SIZE];
+  uint32_t entry_count;
+  uint32_t entry_size; // sizeof(ChirpRomEntry) when the index was built, so that a stale index is turned down
+} ChirpRomDbHeader;
+
+// strings are nul-terminated and empty when nothing is known
+typedef struct ChirpRomEntry
+{
+  uint64_t hash; // chirp_rom_hash of the ROM
+  char title[CHIRP_ROMDB_TITLE_SIZE];
+  char platform[CHIRP_ROMDB_PLATFORM_SIZE]; // chip-8, schip or xo-chip
+  char keymap[CHIRP_ROMDB_KEYMAP_SIZE];     // host keys for 0-F, see CHIRP_KEYMAP_DEFAULT
+  uint8_t quirks;                           // CHIRP_QUIRK_* flags
+  uint16_t cpu_speed;                       // 0 to leave the speed alone
+} ChirpRomEntry;
+
+typedef struct ChirpRomDb
+{
+  void* mapping;
+  size_t size;
+  const ChirpRomEntry* entries; // sorted by hash, right after the header
+  uint32_t entry_count;
+} ChirpRomDb;
+
+uint64_t chirp_rom_hash(const uint8_t* rom, size_t size);
+const char* chirp_quirk_name(int quirk);
+
+ChirpRomDb* chirp_romdb_open(const char* path, bool is_optional);
+void chirp_romdb_close(ChirpRomDb* db);
+const ChirpRomEntry* chirp_romdb_find(const ChirpRomDb* db, uint64_t hash);
+
+#endif // CHIRP_ROMDB_H
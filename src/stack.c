@@ -1,63 +1,65 @@
 #include "stack.h"
-#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 ChirpStack* chirp_stack_new()
 {
   // we don't allocate the inner array because it's fixed size
   ChirpStack* chirp_stack = malloc(sizeof(ChirpStack));
-  chirp_stack->current_size = 0;
-  chirp_stack->ptr = 0;
 
   // force initialize to 0
-  for (int i = 0; i < CHIRP_STACK_SIZE; i++)
-  {
-    chirp_stack->stack[i] = 0;
-  }
+  chirp_stack_clear(chirp_stack);
 
   return chirp_stack;
 }
 
-void chirp_stack_push(ChirpStack* stack, const uint16_t element)
+void chirp_stack_clear(ChirpStack* stack)
+{
+  memset(stack->stack, 0, sizeof(stack->stack));
+  stack->current_size = 0;
+  stack->ptr = 0;
+}
+
+// returns false without pushing if the stack would overflow
+bool chirp_stack_push(ChirpStack* stack, const uint16_t element)
 {
   if (stack->current_size == CHIRP_STACK_SIZE)
   {
-    // once at size, we should abort and error that there's a stack overflow
-    printf("stack overflow, exceeds capacity %d\n", CHIRP_STACK_SIZE);
-    exit(1);
+    return false;
   }
 
   stack->stack[stack->ptr++] = element;
   stack->current_size++;
+
+  return true;
 }
 
-uint16_t chirp_stack_pop(ChirpStack* stack)
+// returns false without popping if the stack is empty
+bool chirp_stack_pop(ChirpStack* stack, uint16_t* element)
 {
   if (stack->current_size == 0)
   {
-    // if there's nothing to pop, abort and error
-    printf("stack->is empty\n");
-    exit(1);
+    return false;
   }
 
-  uint16_t value = stack->stack[stack->ptr - 1];
-
-  stack->stack[stack->ptr--] = 0;
+  *element = stack->stack[--stack->ptr];
+  stack->stack[stack->ptr] = 0;
   stack->current_size--;
 
-  return value;
+  return true;
 }
 
-uint16_t chirp_stack_peek(const ChirpStack* stack)
+// returns false if the stack is empty
+bool chirp_stack_peek(const ChirpStack* stack, uint16_t* element)
 {
   if (stack->current_size == 0)
   {
-    // if there's nothing to pop, abort and error
-    printf("stack->is empty\n");
-    exit(1);
+    return false;
   }
 
-  return stack->stack[stack->ptr - 1];
+  *element = stack->stack[stack->ptr - 1];
+
+  return true;
 }
 
 bool chirp_stack_is_empty(const ChirpStack* stack)
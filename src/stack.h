@@ -15,9 +15,10 @@ typedef struct ChirpStack
 } ChirpStack;
 
 ChirpStack* chirp_stack_new();
-void chirp_stack_push(ChirpStack* stack, uint16_t addr);
-uint16_t chirp_stack_pop(ChirpStack* stack);
-uint16_t chirp_stack_peek(const ChirpStack* stack);
+void chirp_stack_clear(ChirpStack* stack);
+bool chirp_stack_push(ChirpStack* stack, uint16_t addr);
+bool chirp_stack_pop(ChirpStack* stack, uint16_t* addr);
+bool chirp_stack_peek(const ChirpStack* stack, uint16_t* addr);
 bool chirp_stack_is_empty(const ChirpStack* stack);
 bool chirp_stack_is_full(const ChirpStack* stack);
 
@@ -0,0 +1,71 @@
+#include "timing.h"
+
+// approximate machine cycles spent by the original VIP interpreter on each instruction, including fetch and decode,
+// based on published timing measurements of the CHIP-8 interpreter; 0 marks opcodes that need a closer look
+static const uint32_t CHIRP_OPCODE_COSTS[16] = {
+  0,  // 0NNN: 00E0 and 00EE differ
+  23, // 1NNN
+  23, // 2NNN
+  12, // 3XNN
+  12, // 4XNN
+  16, // 5XY0
+  6,  // 6XNN
+  10, // 7XNN
+  44, // 8XYN
+  16, // 9XY0
+  12, // ANNN
+  23, // BNNN
+  36, // CXNN
+  0,  // DXYN: depends on the sprite height
+  16, // EX9E and EXA1
+  0,  // FXNN: depends on the instruction
+};
+
+#define CHIRP_SKIP_COST 2 // taking a skip costs a couple more cycles to move the PC again
+
+uint32_t chirp_timing_cost_fxnn(const uint8_t x, const uint8_t nn)
+{
+  switch (nn)
+  {
+  case 0x07:
+  case 0x15:
+  case 0x18:
+    return 10;
+  case 0x0A:
+    return 19;
+  case 0x1E:
+    return 19;
+  case 0x29:
+    return 20;
+  case 0x33:
+    return 204;
+  case 0x55:
+  case 0x65:
+    // every register is its own load or store
+    return 14 + 14 * (x + 1);
+  default:
+    return 10;
+  }
+}
+
+// cost of an instruction that has just been executed, in VIP machine cycles
+uint32_t chirp_timing_cost(const uint16_t instruction, const bool has_skipped)
+{
+  const uint8_t opcode = (instruction & 0xF000) >> 12;
+  const uint8_t x = (instruction & 0x0F00) >> 8;
+  const uint8_t n = instruction & 0x000F;
+  const uint8_t nn = instruction & 0x00FF;
+
+  switch (opcode)
+  {
+  case 0x0:
+    return instruction == 0x00E0 ? 24 : 23;
+  case 0xD:
+    // every row is read from memory, shifted into place and XORed into the display
+    return 47 + 15 * n;
+  case 0xF:
+    return chirp_timing_cost_fxnn(x, nn);
+  default:
+    return CHIRP_OPCODE_COSTS[opcode] + (has_skipped ? CHIRP_SKIP_COST : 0);
+  }
+}
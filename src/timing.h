@@ -0,0 +1,13 @@
+#ifndef CHIRP_TIMING_H
+#define CHIRP_TIMING_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// COSMAC VIP: 1.76064MHz clock with 8 clock pulses per machine cycle
+#define CHIRP_VIP_CYCLES_PER_SECOND 220080
+#define CHIRP_VIP_CYCLES_PER_FRAME (CHIRP_VIP_CYCLES_PER_SECOND / 60)
+
+uint32_t chirp_timing_cost(uint16_t instruction, bool has_skipped);
+
+#endif // CHIRP_TIMING_H
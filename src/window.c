@@ -1,24 +1,135 @@
 #include "window.h"
 
-#include <math.h>
 #include <stdlib.h>
+#include <string.h>
+
+#define SDL_BEEPER_CHUNK_SAMPLES 256
+#define SDL_BEEPER_RAMP_MS 5 // time taken to fade the tone in or out, short enough to sound instant without clicking
+
+#define SDL_BEEPER_PATTERN_BYTES 16                             // matches the XO-CHIP audio pattern buffer
+#define SDL_BEEPER_PATTERN_SAMPLES (SDL_BEEPER_PATTERN_BYTES * 8) // one sample per bit, most significant bit first
+#define SDL_BEEPER_SLOT_FRESH 0x4 // set on the shared slot once the emulator has published a pattern into it
+
+// half the pattern high and half low, played fast enough to make the usual 440Hz square wave
+static const uint8_t SDL_BEEPER_DEFAULT_PATTERN[SDL_BEEPER_PATTERN_BYTES] = {
+  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+};
+#define SDL_BEEPER_DEFAULT_RATE (440.0f * SDL_BEEPER_PATTERN_SAMPLES)
+
+#define SDL_DISPLAY_BACKGROUND 44, 78, 138
+#define SDL_DISPLAY_LIT 0xFF93B4ED // ARGB8888 for 147, 180, 237
+
+#define SDL_SCANLINE_ROWS 4          // texture rows per display row, the last of which is darkened
+#define SDL_SCANLINE_DARK 0x60000000 // ARGB8888, black at a little over a third
+
+#ifdef CHIRP_INSTRUMENT
+#define SDL_HEATMAP_WIDTH 64 // addresses to a row, so that the ROM starts on row 8
+#define SDL_HEATMAP_HEIGHT (CHIRP_MEMORY_SIZE / SDL_HEATMAP_WIDTH)
+#define SDL_HEATMAP_DECAY 0.9f // heat left after a frame, so that an access has faded out in about a second
+#define SDL_HEATMAP_KNEE 4.0f  // heat at which a channel is half lit; it approaches full brightness from there
+#endif
+
+typedef struct SDLBeeperPattern
+{
+  uint8_t samples[SDL_BEEPER_PATTERN_BYTES];
+  float rate; // samples per second
+} SDLBeeperPattern;
 
 struct SDLBeeper
 {
-  SDL_AudioDeviceID dev;
   SDL_AudioStream* stream;
 
   int sample_rate;
-  float freq;
   float volume;
 
-  float* tone; // array of tones
-  int tone_samples;
+  SDL_AtomicInt is_beeping; // published by the emulator on every timer tick, read by the audio callback
+
+  // triple buffer: the emulator fills its back slot then swaps it with the shared one, and the callback swaps the
+  // shared slot with its front one whenever it is fresh, so neither side ever waits on the other
+  SDLBeeperPattern patterns[3];
+  SDL_AtomicInt shared_slot;
+  int back_slot;  // only ever touched by the emulator
+  int front_slot; // only ever touched from the audio callback
+
+  // only ever touched from the audio callback
+  float position; // position within the pattern, in samples from 0 to SDL_BEEPER_PATTERN_SAMPLES
+  float gain;     // current amplitude, ramping towards volume while beeping and towards 0 otherwise
+
+  ChirpMetrics* metrics; // only ever changed with the stream locked, so never while the callback runs
 };
 
+/**
+ * Synthesises the tone on demand from SDL's audio thread.
+ *
+ * The current 1-bit pattern is resampled to the device rate by holding each bit for as long as it lasts at the
+ * pattern's own rate. The position keeps running whether or not the tone is audible, and starting or stopping only
+ * ramps the gain, so the waveform stays continuous and never clicks. Nothing is ever queued ahead, so any change
+ * takes effect on the next buffer the device asks for.
+ */
+void SDLCALL sdl_beeper_callback(void* userdata, SDL_AudioStream* stream, int additional_amount, int total_amount)
+{
+  SDLBeeper* beeper = userdata;
+
+  if ((SDL_GetAtomicInt(&beeper->shared_slot) & SDL_BEEPER_SLOT_FRESH) != 0)
+  {
+    beeper->front_slot = SDL_SetAtomicInt(&beeper->shared_slot, beeper->front_slot) & ~SDL_BEEPER_SLOT_FRESH;
+  }
+  const SDLBeeperPattern* pattern = &beeper->patterns[beeper->front_slot];
+
+  const float target = SDL_GetAtomicInt(&beeper->is_beeping) != 0 ? beeper->volume : 0.0f;
+  const float ramp_step = beeper->volume / (float)(beeper->sample_rate * SDL_BEEPER_RAMP_MS / 1000);
+  const float position_step = pattern->rate / (float)beeper->sample_rate;
+
+  float samples[SDL_BEEPER_CHUNK_SAMPLES];
+  int remaining = additional_amount / (int)sizeof(float);
+
+  while (remaining > 0)
+  {
+    const int count = remaining < SDL_BEEPER_CHUNK_SAMPLES ? remaining : SDL_BEEPER_CHUNK_SAMPLES;
+
+    for (int i = 0; i < count; i++)
+    {
+      if (beeper->gain < target)
+      {
+        beeper->gain = beeper->gain + ramp_step > target ? target : beeper->gain + ramp_step;
+      }
+      else if (beeper->gain > target)
+      {
+        beeper->gain = beeper->gain - ramp_step < target ? target : beeper->gain - ramp_step;
+      }
+
+      const int bit = (int)beeper->position;
+      const bool is_high = (pattern->samples[bit >> 3] >> (7 - (bit & 7))) & 0x1;
+      samples[i] = is_high ? beeper->gain : -beeper->gain;
+
+      beeper->position += position_step;
+      while (beeper->position >= (float)SDL_BEEPER_PATTERN_SAMPLES)
+      {
+        beeper->position -= (float)SDL_BEEPER_PATTERN_SAMPLES;
+      }
+    }
+
+    SDL_PutAudioStreamData(stream, samples, count * (int)sizeof(float));
+    remaining -= count;
+  }
+
+  if (beeper->metrics != NULL)
+  {
+    chirp_metrics_record_audio(beeper->metrics,
+                               (total_amount - additional_amount) / (int)sizeof(float),
+                               additional_amount / (int)sizeof(float),
+                               beeper->sample_rate);
+  }
+}
+
 SDLBeeper* sdl_beeper_new()
 {
   SDLBeeper* beeper = malloc(sizeof(SDLBeeper));
+  if (beeper == NULL)
+  {
+    SDL_LogError(SDL_LOG_CATEGORY_ERROR, "failed to allocate memory for beeper\n");
+    exit(1);
+  }
 
   SDL_AudioSpec spec;
   SDL_zero(spec);
@@ -26,67 +137,105 @@ SDLBeeper* sdl_beeper_new()
   spec.freq = 48000;
   spec.format = SDL_AUDIO_F32;
   spec.channels = 1;
-  beeper->dev = SDL_OpenAudioDevice(SDL_AUDIO_DEVICE_DEFAULT_PLAYBACK, &spec);
-  if (beeper->dev == 0)
-  {
-    SDL_LogError(SDL_LOG_CATEGORY_ERROR, "failed to open the audio device\n");
-    exit(1);
-  }
-
-  beeper->stream = SDL_CreateAudioStream(&spec, &spec);
-  if (beeper->stream == 0)
-  {
-    SDL_LogError(SDL_LOG_CATEGORY_ERROR, "failed to create stream\n");
-    exit(1);
-  }
-  SDL_BindAudioStream(beeper->dev, beeper->stream);
-  SDL_ResumeAudioDevice(beeper->dev);
 
   beeper->sample_rate = spec.freq;
-  beeper->freq = 440.0f;
   beeper->volume = 0.2f;
+  beeper->position = 0.0f;
+  beeper->gain = 0.0f;
+  beeper->metrics = NULL;
+  SDL_SetAtomicInt(&beeper->is_beeping, 0);
 
-  const int ms = 50;
-  beeper->tone_samples = (beeper->sample_rate * ms) / 1000;
-  beeper->tone = (float*)SDL_malloc(beeper->tone_samples * sizeof(float));
-  if (beeper->tone == NULL)
+  for (int i = 0; i < 3; i++)
   {
-    SDL_LogError(SDL_LOG_CATEGORY_ERROR, "failed to allocate memory for beeper tone\n");
-    exit(1);
+    SDL_memcpy(beeper->patterns[i].samples, SDL_BEEPER_DEFAULT_PATTERN, SDL_BEEPER_PATTERN_BYTES);
+    beeper->patterns[i].rate = SDL_BEEPER_DEFAULT_RATE;
   }
+  beeper->front_slot = 0;
+  SDL_SetAtomicInt(&beeper->shared_slot, 1);
+  beeper->back_slot = 2;
 
-  for (int i = 0; i < beeper->tone_samples; i++)
+  // the stream starts paused so the callback never sees a half-initialised beeper
+  beeper->stream = SDL_OpenAudioDeviceStream(SDL_AUDIO_DEVICE_DEFAULT_PLAYBACK, &spec, sdl_beeper_callback, beeper);
+  if (beeper->stream == NULL)
   {
-    float t = (float)i / (float)beeper->sample_rate;
-    beeper->tone[i] = beeper->volume * sinf(2.0f * (float)M_PI * beeper->freq * t);
+    SDL_LogError(SDL_LOG_CATEGORY_ERROR, "failed to open the audio device\n");
+    exit(1);
   }
+  SDL_ResumeAudioStreamDevice(beeper->stream);
 
   return beeper;
 }
 
 void sdl_beeper_free(SDLBeeper* beeper)
 {
-  SDL_free(beeper->tone);
+  // destroying the stream also closes the device it opened
   SDL_DestroyAudioStream(beeper->stream);
-  SDL_CloseAudioDevice(beeper->dev);
   free(beeper);
 }
 
-void sdl_beeper_beep(SDLBeeper* beeper)
+void sdl_beeper_set_beeping(SDLBeeper* beeper, const bool is_beeping)
+{
+  SDL_SetAtomicInt(&beeper->is_beeping, is_beeping ? 1 : 0);
+}
+
+// publishes a new pattern without waiting on the audio thread; NULL goes back to the default beep
+void sdl_beeper_set_pattern(SDLBeeper* beeper, const uint8_t* pattern, const float rate)
 {
-  const int want_bytes = (beeper->sample_rate / 10) * (int)sizeof(float);
-  while (SDL_GetAudioStreamQueued(beeper->stream) < want_bytes)
+  SDLBeeperPattern* back = &beeper->patterns[beeper->back_slot];
+  SDL_memcpy(back->samples, pattern != NULL ? pattern : SDL_BEEPER_DEFAULT_PATTERN, SDL_BEEPER_PATTERN_BYTES);
+  back->rate = pattern != NULL ? rate : SDL_BEEPER_DEFAULT_RATE;
+
+  beeper->back_slot = SDL_SetAtomicInt(&beeper->shared_slot, beeper->back_slot | SDL_BEEPER_SLOT_FRESH) &
+                      ~SDL_BEEPER_SLOT_FRESH;
+}
+
+// NULL if the texture could not be created
+SDL_Texture* sdl_window_create_texture(SDL_Renderer* renderer, const SDL_TextureAccess access, const int w, const int h)
+{
+  SDL_Texture* texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, access, w, h);
+  if (texture == NULL)
   {
-    SDL_PutAudioStreamData(beeper->stream, beeper->tone, beeper->tone_samples * (int)sizeof(float));
+    SDL_LogError(SDL_LOG_CATEGORY_ERROR, "could not create texture. SDL error: %s\n", SDL_GetError());
+    return NULL;
   }
+
+  // nearest keeps the pixels sharp at any scale; the scanlines are lined up with them
+  SDL_SetTextureScaleMode(texture, SDL_SCALEMODE_NEAREST);
+  SDL_SetTextureBlendMode(texture, access == SDL_TEXTUREACCESS_TARGET ? SDL_BLENDMODE_NONE : SDL_BLENDMODE_BLEND);
+  return texture;
 }
 
-void sdl_beeper_stop(SDLBeeper* beeper)
+// writes the display into the frame texture, which is the only time pixels go from the CPU to the GPU
+void sdl_window_upload_display(SDLWindow* window, const ChirpDisplay* display)
 {
-  SDL_ClearAudioStream(beeper->stream);
+  void* pixels;
+  int pitch;
+  if (SDL_LockTexture(window->frame, NULL, &pixels, &pitch) == false)
+  {
+    SDL_LogError(SDL_LOG_CATEGORY_ERROR, "could not lock texture. SDL error: %s\n", SDL_GetError());
+    return;
+  }
+
+  for (int y = 0; y < DISPLAY_HEIGHT; y++)
+  {
+    uint32_t* row = (uint32_t*)((uint8_t*)pixels + y * pitch);
+    for (int x = 0; x < DISPLAY_WIDTH; x++)
+    {
+      row[x] = chirp_display_get_pixel(display, x, y) ? SDL_DISPLAY_LIT : 0;
+    }
+  }
+
+  SDL_UnlockTexture(window->frame);
+  window->shown = *display;
 }
 
-SDLWindow* sdl_window_new()
+/**
+ * Creates the window with the display scaled to fit it, however it is resized.
+ *
+ * persistence is the percentage of a pixel's brightness left one frame after it goes dark, as on a CRT whose phosphor
+ * keeps glowing for a while; anything above 0 hides the flicker of sprites that are erased and redrawn every frame.
+ */
+SDLWindow* sdl_window_new(const SDLScaling scaling, const int persistence, const bool has_scanlines)
 {
   if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_AUDIO) == false)
   {
@@ -96,7 +245,7 @@ SDLWindow* sdl_window_new()
 
   SDL_Window* window = SDL_CreateWindow(
     "chirp", WINDOW_WIDTH, WINDOW_HEIGHT,
-    SDL_WINDOW_HIGH_PIXEL_DENSITY | SDL_WINDOW_OPENGL);
+    SDL_WINDOW_HIGH_PIXEL_DENSITY | SDL_WINDOW_OPENGL | SDL_WINDOW_RESIZABLE);
 
   if (window == NULL)
   {
@@ -105,6 +254,7 @@ SDLWindow* sdl_window_new()
     SDL_Quit();
     exit(1);
   }
+  SDL_SetWindowMinimumSize(window, DISPLAY_WIDTH, DISPLAY_HEIGHT);
 
   SDL_Renderer* renderer = SDL_CreateRenderer(window, NULL);
   if (renderer == NULL)
@@ -118,6 +268,30 @@ SDLWindow* sdl_window_new()
   SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_NONE);
   SDL_SetRenderVSync(renderer, 1);
 
+  SDL_Texture* frame = sdl_window_create_texture(renderer, SDL_TEXTUREACCESS_STREAMING, DISPLAY_WIDTH, DISPLAY_HEIGHT);
+  SDL_Texture* phosphor = sdl_window_create_texture(renderer, SDL_TEXTUREACCESS_TARGET, DISPLAY_WIDTH, DISPLAY_HEIGHT);
+  SDL_Texture* scanlines =
+    sdl_window_create_texture(renderer, SDL_TEXTUREACCESS_STATIC, 1, DISPLAY_HEIGHT * SDL_SCANLINE_ROWS);
+  if (frame == NULL || phosphor == NULL || scanlines == NULL)
+  {
+    SDL_DestroyRenderer(renderer);
+    SDL_DestroyWindow(window);
+    SDL_Quit();
+    exit(1);
+  }
+
+  uint32_t column[DISPLAY_HEIGHT * SDL_SCANLINE_ROWS];
+  for (int i = 0; i < DISPLAY_HEIGHT * SDL_SCANLINE_ROWS; i++)
+  {
+    column[i] = i % SDL_SCANLINE_ROWS == SDL_SCANLINE_ROWS - 1 ? SDL_SCANLINE_DARK : 0;
+  }
+  SDL_UpdateTexture(scanlines, NULL, column, sizeof(uint32_t));
+
+  SDL_SetRenderTarget(renderer, phosphor);
+  SDL_SetRenderDrawColor(renderer, SDL_DISPLAY_BACKGROUND, 255);
+  SDL_RenderClear(renderer);
+  SDL_SetRenderTarget(renderer, NULL);
+
   SDLBeeper* beeper = sdl_beeper_new();
 
   SDLWindow* chirp_window = malloc(sizeof(SDLWindow));
@@ -133,6 +307,34 @@ SDLWindow* sdl_window_new()
   chirp_window->window = window;
   chirp_window->renderer = renderer;
   chirp_window->beeper = beeper;
+  chirp_window->frame = frame;
+  chirp_window->phosphor = phosphor;
+  chirp_window->scanlines = scanlines;
+  chirp_window->scaling = scaling;
+  chirp_window->has_scanlines = has_scanlines;
+  chirp_window->metrics = NULL;
+  chirp_window->is_overlay_visible = false;
+
+#ifdef CHIRP_INSTRUMENT
+  chirp_window->heatmap =
+    sdl_window_create_texture(renderer, SDL_TEXTUREACCESS_STREAMING, SDL_HEATMAP_WIDTH, SDL_HEATMAP_HEIGHT);
+  memset(chirp_window->heat, 0, sizeof(chirp_window->heat));
+  memset(chirp_window->seen, 0, sizeof(chirp_window->seen));
+  chirp_window->is_heatmap_visible = false;
+#endif
+
+  // blending the background over phosphor at this alpha leaves persistence percent of the difference from it
+  const int kept = persistence < 0 ? 0 : persistence > 99 ? 99 : persistence;
+  chirp_window->decay = (uint8_t)(255 * (100 - kept) / 100);
+  chirp_window->fade_length = 0;
+  for (int level = 255 * kept / 100; level > 0; level = level * kept / 100)
+  {
+    chirp_window->fade_length++;
+  }
+  chirp_window->fade_frames = 0;
+
+  memset(&chirp_window->shown, 0, sizeof(ChirpDisplay));
+  sdl_window_upload_display(chirp_window, &chirp_window->shown);
 
   SDL_SetRenderDrawColor(renderer, 0, 0, 0, 0);
   SDL_RenderClear(renderer);
@@ -143,6 +345,15 @@ SDLWindow* sdl_window_new()
 
 void sdl_window_free(SDLWindow* window)
 {
+  SDL_DestroyTexture(window->frame);
+  SDL_DestroyTexture(window->phosphor);
+  SDL_DestroyTexture(window->scanlines);
+#ifdef CHIRP_INSTRUMENT
+  if (window->heatmap != NULL)
+  {
+    SDL_DestroyTexture(window->heatmap);
+  }
+#endif
   SDL_DestroyWindow(window->window);
   SDL_DestroyRenderer(window->renderer);
   sdl_beeper_free(window->beeper);
@@ -150,37 +361,268 @@ void sdl_window_free(SDLWindow* window)
   SDL_Quit();
 }
 
-void sdl_window_draw_display(SDLWindow* window, const ChirpDisplay* display)
+// false if the name is not one of integer, fit or stretch
+bool sdl_window_parse_scaling(const char* name, SDLScaling* scaling)
 {
-  SDL_SetRenderDrawColor(window->renderer, 44, 78, 138, 255);
+  if (strcmp(name, "integer") == 0) *scaling = SDL_SCALING_INTEGER;
+  else if (strcmp(name, "fit") == 0) *scaling = SDL_SCALING_FIT;
+  else if (strcmp(name, "stretch") == 0) *scaling = SDL_SCALING_STRETCH;
+  else return false;
+
+  return true;
+}
+
+// where the display goes in the window, in pixels, centred
+SDL_FRect sdl_window_layout(SDLWindow* window)
+{
+  int width;
+  int height;
+  SDL_GetCurrentRenderOutputSize(window->renderer, &width, &height);
+
+  float w = (float)width;
+  float h = (float)height;
+  if (window->scaling == SDL_SCALING_INTEGER)
+  {
+    const int x_scale = width / DISPLAY_WIDTH;
+    const int y_scale = height / DISPLAY_HEIGHT;
+    const int scale = x_scale < y_scale ? x_scale : y_scale;
+    w = (float)(DISPLAY_WIDTH * (scale > 1 ? scale : 1));
+    h = (float)(DISPLAY_HEIGHT * (scale > 1 ? scale : 1));
+  }
+  else if (window->scaling == SDL_SCALING_FIT)
+  {
+    const float x_scale = (float)width / DISPLAY_WIDTH;
+    const float y_scale = (float)height / DISPLAY_HEIGHT;
+    const float scale = x_scale < y_scale ? x_scale : y_scale;
+    w = DISPLAY_WIDTH * scale;
+    h = DISPLAY_HEIGHT * scale;
+  }
+
+  return (SDL_FRect){
+    .x = SDL_floorf(((float)width - w) / 2),
+    .y = SDL_floorf(((float)height - h) / 2),
+    .w = w,
+    .h = h,
+  };
+}
+
+// metrics in the debug font, one line at a time since it does not wrap
+void sdl_window_draw_overlay(SDLWindow* window)
+{
+  char text[CHIRP_METRICS_OVERLAY_SIZE];
+  chirp_metrics_format_overlay(window->metrics, text, sizeof(text));
+
+  SDL_SetRenderDrawColor(window->renderer, 255, 255, 255, 255);
+  float y = SDL_DEBUG_TEXT_FONT_CHARACTER_SIZE;
+  for (char* line = strtok(text, "\n"); line != NULL; line = strtok(NULL, "\n"))
+  {
+    SDL_RenderDebugText(window->renderer, SDL_DEBUG_TEXT_FONT_CHARACTER_SIZE, y, line);
+    y += SDL_DEBUG_TEXT_FONT_CHARACTER_SIZE * 1.5f;
+  }
+}
+
+#ifdef CHIRP_INSTRUMENT
+// channel brightness for an amount of heat, rising steeply at first so that a single access still shows
+uint32_t sdl_window_heat_level(const float heat)
+{
+  return (uint32_t)(255.0f * heat / (heat + SDL_HEATMAP_KNEE));
+}
+
+/**
+ * Decays the heat of every address and adds the accesses counted since the last frame, which is meant to happen once
+ * per emulated frame whether or not the heatmap is shown, so that it does not light up with everything that happened
+ * while it was hidden. The texture is only uploaded while it is shown.
+ */
+void sdl_window_update_heatmap(SDLWindow* window, const ChirpMemHeat* heat)
+{
+  for (int kind = 0; kind < CHIRP_MEM_ACCESS_KINDS; kind++)
+  {
+    for (int addr = 0; addr < CHIRP_MEMORY_SIZE; addr++)
+    {
+      const uint32_t count = heat->counts[kind][addr];
+      const uint32_t accesses = count - window->seen[kind][addr];
+      window->heat[kind][addr] = window->heat[kind][addr] * SDL_HEATMAP_DECAY + (float)accesses;
+      window->seen[kind][addr] = count;
+    }
+  }
+
+  void* pixels;
+  int pitch;
+  if (!window->is_heatmap_visible || window->heatmap == NULL)
+  {
+    return;
+  }
+  if (SDL_LockTexture(window->heatmap, NULL, &pixels, &pitch) == false)
+  {
+    SDL_LogError(SDL_LOG_CATEGORY_ERROR, "could not lock texture. SDL error: %s\n", SDL_GetError());
+    return;
+  }
+
+  for (int y = 0; y < SDL_HEATMAP_HEIGHT; y++)
+  {
+    uint32_t* row = (uint32_t*)((uint8_t*)pixels + y * pitch);
+    for (int x = 0; x < SDL_HEATMAP_WIDTH; x++)
+    {
+      const int addr = y * SDL_HEATMAP_WIDTH + x;
+      row[x] = 0xFF000000 | sdl_window_heat_level(window->heat[CHIRP_MEM_ACCESS_WRITE][addr]) << 16
+               | sdl_window_heat_level(window->heat[CHIRP_MEM_ACCESS_READ][addr]) << 8
+               | sdl_window_heat_level(window->heat[CHIRP_MEM_ACCESS_EXECUTE][addr]);
+    }
+  }
+  SDL_UnlockTexture(window->heatmap);
+}
+
+// the heatmap as a square in the bottom right corner, half the height of the window
+void sdl_window_draw_heatmap(SDLWindow* window)
+{
+  int width;
+  int height;
+  SDL_GetCurrentRenderOutputSize(window->renderer, &width, &height);
+
+  const float side = SDL_floorf((float)height / 2);
+  const SDL_FRect area = {(float)width - side, (float)height - side, side, side};
+  SDL_RenderTexture(window->renderer, window->heatmap, NULL, &area);
+}
+#endif
+
+/**
+ * Draws whatever was last uploaded into the frame texture scaled to the window, then waits for vsync.
+ *
+ * Everything here happens on the GPU: the background is blended over the phosphor texture to fade what was lit
+ * before, the frame is blended on top of that, and the result is scaled to the window, so the cost does not grow with
+ * the size of the window.
+ */
+void sdl_window_present(SDLWindow* window, const uint64_t start)
+{
+  // the last draw of a fade covers the phosphor completely, rather than leave what rounding never quite fades out
+  SDL_SetRenderTarget(window->renderer, window->phosphor);
+  SDL_SetRenderDrawBlendMode(window->renderer, SDL_BLENDMODE_BLEND);
+  SDL_SetRenderDrawColor(window->renderer, SDL_DISPLAY_BACKGROUND, window->fade_frames > 0 ? window->decay : 255);
+  SDL_RenderFillRect(window->renderer, NULL);
+  SDL_SetRenderDrawBlendMode(window->renderer, SDL_BLENDMODE_NONE);
+  SDL_RenderTexture(window->renderer, window->frame, NULL, NULL);
+  SDL_SetRenderTarget(window->renderer, NULL);
+
+  SDL_SetRenderDrawColor(window->renderer, 0, 0, 0, 255);
   SDL_RenderClear(window->renderer);
 
-  SDL_SetRenderDrawColor(window->renderer, 147, 180, 237, 255);
-  for (int y = 0; y < DISPLAY_HEIGHT; y++)
+  const SDL_FRect area = sdl_window_layout(window);
+  SDL_RenderTexture(window->renderer, window->phosphor, NULL, &area);
+  if (window->has_scanlines)
   {
-    for (int x = 0; x < DISPLAY_WIDTH; x++)
+    SDL_RenderTexture(window->renderer, window->scanlines, NULL, &area);
+  }
+
+  if (window->metrics != NULL && window->is_overlay_visible)
+  {
+    sdl_window_draw_overlay(window);
+  }
+#ifdef CHIRP_INSTRUMENT
+  if (window->heatmap != NULL && window->is_heatmap_visible)
+  {
+    sdl_window_draw_heatmap(window);
+  }
+#endif
+  SDL_RenderPresent(window->renderer);
+
+  // includes waiting for vsync in SDL_RenderPresent, which is where a slow frame shows up
+  if (window->metrics != NULL)
+  {
+    chirp_metrics_record_render(window->metrics, start);
+  }
+}
+
+// draws the display as it is, only uploading it when it has changed
+void sdl_window_draw_display(SDLWindow* window, const ChirpDisplay* display)
+{
+  const uint64_t start = SDL_GetPerformanceCounter();
+
+  if (memcmp(display->display, window->shown.display, sizeof(display->display)) != 0)
+  {
+    sdl_window_upload_display(window, display);
+    window->fade_frames = window->fade_length;
+  }
+  else if (window->fade_frames > 0)
+  {
+    window->fade_frames--;
+  }
+
+  sdl_window_present(window, start);
+}
+
+/**
+ * Draws the display as the core's anti-flicker sees it, each pixel blended between the background and lit by its
+ * level. Only the band of rows that changed since the last draw is uploaded.
+ */
+void sdl_window_draw_levels(SDLWindow* window, ChirpDeflicker* deflicker)
+{
+  const uint64_t start = SDL_GetPerformanceCounter();
+
+  const uint64_t rows = chirp_deflicker_take_changes(deflicker);
+  if (rows != 0)
+  {
+    window->fade_frames = window->fade_length;
+  }
+  else if (window->fade_frames > 0)
+  {
+    window->fade_frames--;
+  }
+
+  int first = 0;
+  int last = DISPLAY_HEIGHT - 1;
+  while (first <= last && (rows >> first & 1) == 0)
+  {
+    first++;
+  }
+  while (last >= first && (rows >> last & 1) == 0)
+  {
+    last--;
+  }
+
+  void* pixels;
+  int pitch;
+  const SDL_Rect band = {0, first, DISPLAY_WIDTH, last - first + 1};
+  if (first <= last && SDL_LockTexture(window->frame, &band, &pixels, &pitch))
+  {
+    for (int y = first; y <= last; y++)
     {
-      if (chirp_display_get_pixel(display, x, y))
+      uint32_t* row = (uint32_t*)((uint8_t*)pixels + (y - first) * pitch);
+      for (int x = 0; x < DISPLAY_WIDTH; x++)
       {
-        SDL_FRect rect = (SDL_FRect){
-          .x = (float)x * UPSCALE_FACTOR,
-          .y = (float)y * UPSCALE_FACTOR,
-          .w = UPSCALE_FACTOR,
-          .h = UPSCALE_FACTOR,
-        };
-        SDL_RenderFillRect(window->renderer, &rect);
+        row[x] = (uint32_t)deflicker->levels[y][x] << 24 | (SDL_DISPLAY_LIT & 0xFFFFFF);
       }
     }
+    SDL_UnlockTexture(window->frame);
   }
-  SDL_RenderPresent(window->renderer);
+
+  sdl_window_present(window, start);
 }
 
-void sdl_window_start_beep(SDLWindow* window)
+// the display has to be drawn on every frame until what went dark has faded out, even if it does not change
+bool sdl_window_is_fading(const SDLWindow* window)
 {
-  sdl_beeper_beep(window->beeper);
+  return window->fade_frames > 0;
 }
 
-void sdl_window_stop_beep(SDLWindow* window)
+// cheap enough to call on every timer tick, the audio callback picks up the change on its own
+void sdl_window_set_beep(SDLWindow* window, const bool is_beeping)
 {
-  sdl_beeper_stop(window->beeper);
+  sdl_beeper_set_beeping(window->beeper, is_beeping);
+}
+
+// pattern is 16 bytes of 1-bit samples played at rate samples per second, or NULL for the default beep
+void sdl_window_set_audio_pattern(SDLWindow* window, const uint8_t* pattern, const float rate)
+{
+  sdl_beeper_set_pattern(window->beeper, pattern, rate);
+}
+
+// metrics from the renderer and the audio callback are recorded into metrics from now on, and the overlay shown
+void sdl_window_set_metrics(SDLWindow* window, ChirpMetrics* metrics)
+{
+  window->metrics = metrics;
+  window->is_overlay_visible = metrics != NULL;
+
+  SDL_LockAudioStream(window->beeper->stream);
+  window->beeper->metrics = metrics;
+  SDL_UnlockAudioStream(window->beeper->stream);
 }
@@ -2,21 +2,64 @@
 #define CHIRP_WINDOW_H
 
 #include "SDL3/SDL.h"
+#include "deflicker.h"
 #include "display.h"
+#include "memory.h"
+#include "metrics.h"
 
 typedef struct SDLBeeper SDLBeeper;
 
+// how the display is fitted into a window of any size; the part of the window it does not cover is left black
+typedef enum SDLScaling
+{
+  SDL_SCALING_INTEGER, // largest whole multiple of the display that fits, so every pixel is the same size
+  SDL_SCALING_FIT,     // as large as fits while keeping the 2:1 aspect ratio
+  SDL_SCALING_STRETCH, // the whole window, whatever its shape
+} SDLScaling;
+
 typedef struct SDLWindow
 {
   SDL_Window* window;
   SDL_Renderer* renderer;
   SDLBeeper* beeper;
+
+  // the display goes through the GPU as three textures: frame is uploaded whenever the display changes, blended into
+  // phosphor, which fades out what is no longer lit, and phosphor is scaled to the window with scanlines over it
+  SDL_Texture* frame;     // DISPLAY_WIDTH x DISPLAY_HEIGHT, lit pixels opaque and the rest transparent
+  SDL_Texture* phosphor;  // render target of the same size, the screen as it is shown
+  SDL_Texture* scanlines; // a single column, darkening the bottom of every display row
+  ChirpDisplay shown;     // display last uploaded into frame
+
+  SDLScaling scaling;
+  bool has_scanlines;
+  uint8_t decay;   // alpha the background is blended over phosphor with on every draw, 255 without persistence
+  int fade_length; // draws it takes a pixel that went dark to fade into the background
+  int fade_frames; // draws left until phosphor has settled since the display last changed
+
+  ChirpMetrics* metrics;   // NULL unless metrics were asked for
+  bool is_overlay_visible; // metrics drawn over the display, toggled with F1
+
+#ifdef CHIRP_INSTRUMENT
+  // memory heatmap over the corner of the display, toggled with F2: a texel per address, 64 addresses to a row, with
+  // writes in red, reads in green and executes in blue, each brighter the more it happened in the last few frames
+  SDL_Texture* heatmap;
+  float heat[CHIRP_MEM_ACCESS_KINDS][CHIRP_MEMORY_SIZE];    // accesses per address, decayed on every frame
+  uint32_t seen[CHIRP_MEM_ACCESS_KINDS][CHIRP_MEMORY_SIZE]; // the counters as of the last frame
+  bool is_heatmap_visible;
+#endif
 } SDLWindow;
 
-SDLWindow* sdl_window_new();
+SDLWindow* sdl_window_new(SDLScaling scaling, int persistence, bool has_scanlines);
 void sdl_window_free(SDLWindow* window);
 void sdl_window_draw_display(SDLWindow* window, const ChirpDisplay* display);
-void sdl_window_start_beep(SDLWindow* window);
-void sdl_window_stop_beep(SDLWindow* window);
+void sdl_window_draw_levels(SDLWindow* window, ChirpDeflicker* deflicker);
+bool sdl_window_is_fading(const SDLWindow* window);
+bool sdl_window_parse_scaling(const char* name, SDLScaling* scaling);
+void sdl_window_set_beep(SDLWindow* window, bool is_beeping);
+void sdl_window_set_audio_pattern(SDLWindow* window, const uint8_t* pattern, float rate);
+void sdl_window_set_metrics(SDLWindow* window, ChirpMetrics* metrics);
+#ifdef CHIRP_INSTRUMENT
+void sdl_window_update_heatmap(SDLWindow* window, const ChirpMemHeat* heat);
+#endif
 
 #endif // CHIRP_WINDOW_H
@@ -0,0 +1,422 @@
+// translates a CHIP-8 ROM ahead of time into C that runs in place of the interpreter, see src/aot.h
+//
+// build with: make aot ROM=roms/pong.ch8
+// or by hand: out/chirp-aot [--name=NAME] ROM OUT.c, then compile OUT.c with the core and call chirp_aot_attach with
+//             &chirp_aot_NAME
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "analysis.h"
+#include "rom.h"
+#include "timing.h"
+
+#define AOT_NAME_SIZE 64
+
+typedef struct AotTranslation
+{
+  uint8_t mem[CHIRP_MEMORY_SIZE];
+  uint16_t rom_end;
+  ChirpAnalysis analysis;
+
+  bool is_translated[CHIRP_MEMORY_SIZE];
+  uint16_t extent[CHIRP_MEMORY_SIZE];
+  uint16_t image_end;
+} AotTranslation;
+
+void usage(const char* prog)
+{
+  fprintf(stderr, "usage: %s [--name=NAME] ROM OUT.c\n", prog);
+}
+
+// the name of the ROM file without its directory or extension, made into a C identifier
+void default_name(const char* path, char* name, const size_t size)
+{
+  const char* base = strrchr(path, '/');
+  base = base != NULL ? base + 1 : path;
+
+  size_t length = 0;
+  while (base[length] != '\0' && base[length] != '.' && length + 1 < size)
+  {
+    name[length] = isalnum((unsigned char)base[length]) ? base[length] : '_';
+    length++;
+  }
+  name[length] = '\0';
+}
+
+bool is_identifier(const char* name)
+{
+  if (name[0] == '\0')
+  {
+    return false;
+  }
+
+  for (const char* c = name; *c != '\0'; c++)
+  {
+    if (!isalnum((unsigned char)*c) && *c != '_')
+    {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+// invalid instructions always go through the interpreter, which knows how to fault on them
+bool is_translatable(const AotTranslation* t, const uint16_t address)
+{
+  if ((t->analysis.flags[address] & CHIRP_BYTE_CODE) == 0)
+  {
+    return false;
+  }
+
+  const ChirpOp op = chirp_decode_op(chirp_decode_at(t->mem, address));
+  return op != CHIRP_OP_INVALID;
+}
+
+// control leaves straight-line code after these, or memory may no longer hold the code that comes next
+bool ends_run(const ChirpOp op)
+{
+  return chirp_analysis_ends_block(op) || op == CHIRP_OP_LD_B_VX || op == CHIRP_OP_STORE;
+}
+
+/**
+ * Splits the reachable code into runs of straight-line instructions and works out how much of memory each address
+ * depends on, from itself to the end of its run.
+ *
+ * Runs start at the lowest address not translated yet and go on until an instruction that ends them, or until the
+ * next instruction either has no translation or was already translated as part of another run. Returns false if
+ * there is no code to translate at all.
+ */
+bool plan_runs(AotTranslation* t)
+{
+  bool has_code = false;
+  t->image_end = t->rom_end;
+
+  for (uint16_t start = CHIRP_INSTRUCTIONS_ADDR_START; start < CHIRP_INSTRUCTIONS_ADDR_END; start++)
+  {
+    if (t->is_translated[start] || !is_translatable(t, start))
+    {
+      continue;
+    }
+
+    uint16_t end = start;
+    while (end < CHIRP_INSTRUCTIONS_ADDR_END && !t->is_translated[end] && is_translatable(t, end))
+    {
+      t->is_translated[end] = true;
+      end += 2;
+
+      if (ends_run(chirp_decode_op(chirp_decode_at(t->mem, end - 2))))
+      {
+        break;
+      }
+    }
+
+    for (uint16_t address = start; address < end; address += 2)
+    {
+      t->extent[address] = end - address;
+    }
+    if (end > t->image_end)
+    {
+      t->image_end = end;
+    }
+    has_code = true;
+  }
+
+  return has_code;
+}
+
+// writes the handler calls chirp_execute_op would make, with the quirks still picked at run time
+void emit_op(FILE* out, const ChirpDecoded* d)
+{
+  switch (d->op)
+  {
+  case CHIRP_OP_CLS:
+    fprintf(out, "    clear_display(chirp);\n");
+    break;
+  case CHIRP_OP_RET:
+    fprintf(out, "    subroutine_return(chirp);\n");
+    break;
+  case CHIRP_OP_JP:
+    fprintf(out, "    jump(chirp, 0x%03X);\n", d->nnn);
+    break;
+  case CHIRP_OP_CALL:
+    fprintf(out, "    subroutine_call(chirp, 0x%03X);\n", d->nnn);
+    break;
+  case CHIRP_OP_JP_V0:
+    fprintf(out, "    if (chirp->config->jump_with_vx)\n");
+    fprintf(out, "    {\n      jump_with_offset_nnn_vx(chirp, %d, 0x%03X);\n    }\n", d->x, d->nnn);
+    fprintf(out, "    else\n");
+    fprintf(out, "    {\n      jump_with_offset_nnn(chirp, 0x%03X);\n    }\n", d->nnn);
+    break;
+  case CHIRP_OP_SE_VX_NN:
+    fprintf(out, "    skip_if_vx_eq_nn(chirp, %d, 0x%02X);\n", d->x, d->nn);
+    break;
+  case CHIRP_OP_SNE_VX_NN:
+    fprintf(out, "    skip_if_vx_neq_nn(chirp, %d, 0x%02X);\n", d->x, d->nn);
+    break;
+  case CHIRP_OP_SE_VX_VY:
+    fprintf(out, "    skip_if_vx_eq_vy(chirp, %d, %d);\n", d->x, d->y);
+    break;
+  case CHIRP_OP_SNE_VX_VY:
+    fprintf(out, "    skip_if_vx_neq_vy(chirp, %d, %d);\n", d->x, d->y);
+    break;
+  case CHIRP_OP_SKP:
+    fprintf(out, "    skip_if_key_vx_pressed(chirp, %d);\n", d->x);
+    break;
+  case CHIRP_OP_SKNP:
+    fprintf(out, "    skip_if_key_vx_not_pressed(chirp, %d);\n", d->x);
+    break;
+  case CHIRP_OP_LD_VX_NN:
+    fprintf(out, "    set_vx_eq_nn(chirp, %d, 0x%02X);\n", d->x, d->nn);
+    break;
+  case CHIRP_OP_ADD_VX_NN:
+    fprintf(out, "    set_vx_eq_vx_plus_nn(chirp, %d, 0x%02X);\n", d->x, d->nn);
+    break;
+  case CHIRP_OP_LD_VX_VY:
+    fprintf(out, "    set_vx_eq_vy(chirp, %d, %d);\n", d->x, d->y);
+    break;
+  case CHIRP_OP_OR:
+    fprintf(out, "    set_vx_eq_vx_or_vy(chirp, %d, %d);\n", d->x, d->y);
+    break;
+  case CHIRP_OP_AND:
+    fprintf(out, "    set_vx_eq_vx_and_vy(chirp, %d, %d);\n", d->x, d->y);
+    break;
+  case CHIRP_OP_XOR:
+    fprintf(out, "    set_vx_eq_vx_xor_vy(chirp, %d, %d);\n", d->x, d->y);
+    break;
+  case CHIRP_OP_ADD_VX_VY:
+    fprintf(out, "    set_vx_eq_vx_plus_vy(chirp, %d, %d);\n", d->x, d->y);
+    break;
+  case CHIRP_OP_SUB:
+    fprintf(out, "    set_vx_eq_vx_minus_vy(chirp, %d, %d);\n", d->x, d->y);
+    break;
+  case CHIRP_OP_SHR:
+    fprintf(out, "    if (chirp->config->shift_vx)\n");
+    fprintf(out, "    {\n      set_vx_eq_vx_shift_right(chirp, %d);\n    }\n", d->x);
+    fprintf(out, "    else\n");
+    fprintf(out, "    {\n      set_vx_eq_vy_shift_right(chirp, %d, %d);\n    }\n", d->x, d->y);
+    break;
+  case CHIRP_OP_SUBN:
+    fprintf(out, "    set_vx_eq_vy_minus_vx(chirp, %d, %d);\n", d->x, d->y);
+    break;
+  case CHIRP_OP_SHL:
+    fprintf(out, "    if (chirp->config->shift_vx)\n");
+    fprintf(out, "    {\n      set_vx_eq_vx_shift_left(chirp, %d);\n    }\n", d->x);
+    fprintf(out, "    else\n");
+    fprintf(out, "    {\n      set_vx_eq_vy_shift_left(chirp, %d, %d);\n    }\n", d->x, d->y);
+    break;
+  case CHIRP_OP_RND:
+    fprintf(out, "    set_vx_eq_random(chirp, %d, 0x%02X);\n", d->x, d->nn);
+    break;
+  case CHIRP_OP_LD_VX_DT:
+    fprintf(out, "    set_vx_eq_delay(chirp, %d);\n", d->x);
+    break;
+  case CHIRP_OP_LD_VX_K:
+    fprintf(out, "    get_key(chirp, %d);\n", d->x);
+    break;
+  case CHIRP_OP_LD_I:
+    fprintf(out, "    set_index_eq_nnn(chirp, 0x%03X);\n", d->nnn);
+    break;
+  case CHIRP_OP_ADD_I_VX:
+    fprintf(out, "    set_index_eq_index_plus_vx(chirp, %d);\n", d->x);
+    break;
+  case CHIRP_OP_LD_F_VX:
+    fprintf(out, "    set_index_eq_font(chirp, %d);\n", d->x);
+    break;
+  case CHIRP_OP_DRW:
+    fprintf(out, "    draw(chirp, %d, %d, %d);\n", d->x, d->y, d->n);
+    break;
+  case CHIRP_OP_LD_DT_VX:
+    fprintf(out, "    set_delay_eq_vx(chirp, %d);\n", d->x);
+    break;
+  case CHIRP_OP_LD_ST_VX:
+    fprintf(out, "    set_sound_eq_vx(chirp, %d);\n", d->x);
+    break;
+  case CHIRP_OP_LD_B_VX:
+    fprintf(out, "    binary_coded_decimal_conversion(chirp, %d);\n", d->x);
+    break;
+  case CHIRP_OP_STORE:
+    fprintf(out, "    if (chirp->config->set_registers_increment_index)\n");
+    fprintf(out, "    {\n      set_registers_inc(chirp, %d);\n    }\n", d->x);
+    fprintf(out, "    else\n");
+    fprintf(out, "    {\n      set_registers(chirp, %d);\n    }\n", d->x);
+    break;
+  case CHIRP_OP_LOAD:
+    fprintf(out, "    if (chirp->config->load_registers_increment_index)\n");
+    fprintf(out, "    {\n      load_registers_inc(chirp, %d);\n    }\n", d->x);
+    fprintf(out, "    else\n");
+    fprintf(out, "    {\n      load_registers(chirp, %d);\n    }\n", d->x);
+    break;
+  case CHIRP_OP_AUDIO:
+    fprintf(out, "    if (!chirp->config->xo_chip)\n");
+    fprintf(out, "    {\n      chirp_raise_fault(chirp, CHIRP_FAULT_INVALID_INSTRUCTION, 0x%04X);\n    }\n", d->instruction);
+    fprintf(out, "    else\n");
+    fprintf(out, "    {\n      load_audio_pattern(chirp);\n    }\n");
+    break;
+  case CHIRP_OP_PITCH:
+    fprintf(out, "    if (!chirp->config->xo_chip)\n");
+    fprintf(out, "    {\n      chirp_raise_fault(chirp, CHIRP_FAULT_INVALID_INSTRUCTION, 0x%04X);\n    }\n", d->instruction);
+    fprintf(out, "    else\n");
+    fprintf(out, "    {\n      set_pitch_eq_vx(chirp, %d);\n    }\n", d->x);
+    break;
+  default:
+    // never translated, see is_translatable
+    break;
+  }
+}
+
+// one case per translated address, each falling through into the next instruction of its run
+void emit_instruction(FILE* out, const AotTranslation* t, const uint16_t address)
+{
+  char text[32];
+  const ChirpDecoded d = chirp_decode(chirp_decode_at(t->mem, address));
+  chirp_disassemble(&d, text, sizeof(text));
+
+  fprintf(out, "  case 0x%03X: // %s\n", address, text);
+  fprintf(out, "    chirp_aot_fetch(chirp, 0x%03X);\n", address);
+  emit_op(out, &d);
+
+  // chirp_execute_next charges the cost of a taken skip whenever the PC ends up two instructions on, so that is only
+  // known afterwards for skips and for returns and jumps whose target is not in the instruction
+  const uint32_t cost = chirp_timing_cost(d.instruction, false);
+  const uint32_t skipped_cost = chirp_timing_cost(d.instruction, true);
+  if (skipped_cost == cost)
+  {
+    fprintf(out, "    if (chirp_aot_retire(chirp, %u, end))\n", cost);
+  }
+  else if (chirp_op_is_skip(d.op) || d.op == CHIRP_OP_RET || d.op == CHIRP_OP_JP_V0)
+  {
+    fprintf(out,
+            "    if (chirp_aot_retire(chirp, chirp->program_counter == 0x%03X ? %u : %u, end))\n",
+            address + 4,
+            skipped_cost,
+            cost);
+  }
+  else if ((d.op == CHIRP_OP_JP || d.op == CHIRP_OP_CALL) && d.nnn == address + 4)
+  {
+    fprintf(out, "    if (chirp_aot_retire(chirp, %u, end))\n", skipped_cost);
+  }
+  else
+  {
+    fprintf(out, "    if (chirp_aot_retire(chirp, %u, end))\n", cost);
+  }
+  fprintf(out, "    {\n      return true;\n    }\n");
+
+  // the last instruction of a run goes back to chirp_run, which finds out where control went
+  fprintf(out, t->extent[address] == 2 ? "    return true;\n" : "    // fallthrough\n");
+}
+
+void emit(FILE* out, const AotTranslation* t, const char* name, const char* rom_path)
+{
+  fprintf(out, "// translated by chirp-aot from %s, do not edit\n\n", rom_path);
+  fprintf(out, "#include \"aot.h\"\n\n");
+
+  fprintf(out, "static const uint8_t chirp_aot_%s_image[] = {", name);
+  for (uint16_t address = CHIRP_INSTRUCTIONS_ADDR_START; address < t->image_end; address++)
+  {
+    const int column = (address - CHIRP_INSTRUCTIONS_ADDR_START) % 16;
+    fprintf(out, "%s0x%02X,", column == 0 ? "\n  " : " ", t->mem[address]);
+  }
+  fprintf(out, "\n};\n\n");
+
+  fprintf(out, "static const uint16_t chirp_aot_%s_extent[CHIRP_MEMORY_SIZE] = {\n", name);
+  for (int address = 0; address < CHIRP_MEMORY_SIZE; address++)
+  {
+    if (t->extent[address] != 0)
+    {
+      fprintf(out, "  [0x%03X] = %d,\n", address, t->extent[address]);
+    }
+  }
+  fprintf(out, "};\n\n");
+
+  fprintf(out, "extern const ChirpAotProgram chirp_aot_%s;\n\n", name);
+  fprintf(out, "static bool chirp_aot_%s_run(Chirp* chirp, const uint64_t end)\n{\n", name);
+  fprintf(out, "  if (!chirp_aot_is_intact(chirp, &chirp_aot_%s, chirp->program_counter))\n", name);
+  fprintf(out, "  {\n    return false;\n  }\n\n");
+  fprintf(out, "  switch (chirp->program_counter)\n  {\n");
+  for (uint16_t address = CHIRP_INSTRUCTIONS_ADDR_START; address < CHIRP_INSTRUCTIONS_ADDR_END; address++)
+  {
+    if (t->is_translated[address])
+    {
+      emit_instruction(out, t, address);
+    }
+  }
+  fprintf(out, "  default:\n    return false;\n  }\n}\n\n");
+
+  fprintf(out, "const ChirpAotProgram chirp_aot_%s = {\n", name);
+  fprintf(out, "  .name = \"%s\",\n", name);
+  fprintf(out, "  .image = chirp_aot_%s_image,\n", name);
+  fprintf(out, "  .image_size = sizeof(chirp_aot_%s_image),\n", name);
+  fprintf(out, "  .extent = chirp_aot_%s_extent,\n", name);
+  fprintf(out, "  .run = chirp_aot_%s_run,\n", name);
+  fprintf(out, "};\n");
+}
+
+int main(int argc, char* argv[])
+{
+  char name[AOT_NAME_SIZE] = "";
+  const char* paths[2] = {NULL, NULL};
+  int path_count = 0;
+
+  for (int i = 1; i < argc; i++)
+  {
+    if (strncmp(argv[i], "--name=", 7) == 0)
+    {
+      snprintf(name, sizeof(name), "%s", argv[i] + 7);
+    }
+    else if (path_count < 2)
+    {
+      paths[path_count++] = argv[i];
+    }
+    else
+    {
+      usage(argv[0]);
+      return 1;
+    }
+  }
+
+  if (path_count != 2)
+  {
+    usage(argv[0]);
+    return 1;
+  }
+
+  if (name[0] == '\0')
+  {
+    default_name(paths[0], name, sizeof(name));
+  }
+  if (!is_identifier(name))
+  {
+    fprintf(stderr, "%s is not a valid name, pick another with --name\n", name);
+    return 1;
+  }
+
+  static AotTranslation translation;
+  translation.rom_end = load_rom(paths[0], translation.mem);
+  if (translation.rom_end == 0)
+  {
+    return 1;
+  }
+
+  chirp_analyse(translation.mem, CHIRP_INSTRUCTIONS_ADDR_START, &translation.analysis);
+  if (!plan_runs(&translation))
+  {
+    fprintf(stderr, "%s has no code to translate\n", paths[0]);
+    return 1;
+  }
+
+  FILE* out = fopen(paths[1], "w");
+  if (out == NULL)
+  {
+    fprintf(stderr, "could not open %s\n", paths[1]);
+    return 1;
+  }
+
+  emit(out, &translation, name, paths[0]);
+  fclose(out);
+
+  return 0;
+}
@@ -0,0 +1,291 @@
+// compiles the ROM database from its tab-separated source into the index the emulator maps, see src/romdb.h
+//
+// build with: make db
+// or by hand: out/chirp-db roms/roms.tsv out/roms.db
+//             out/chirp-db --hash ROM... for the hashes of new entries
+//
+// every line of the source is one ROM, with the fields separated by tabs and - for a field that is not known:
+//
+//   HASH  TITLE  PLATFORM  QUIRKS  CPU  KEYMAP
+//
+// HASH is the 16 hex digits --hash prints, PLATFORM is chip-8, schip or xo-chip, QUIRKS are the quirk flags without
+// their dashes separated by spaces, CPU is the speed in instructions per second and KEYMAP is 16 keys as for --keymap.
+// Lines starting with # are comments
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "memory.h"
+#include "romdb.h"
+
+#define DB_LINE_SIZE 512
+#define DB_FIELD_COUNT 6
+
+typedef struct DbEntries
+{
+  ChirpRomEntry* entries;
+  uint32_t count;
+  uint32_t capacity;
+} DbEntries;
+
+void usage(const char* prog)
+{
+  fprintf(stderr, "usage: %s SOURCE.tsv OUT.db\n       %s --hash ROM...\n", prog, prog);
+}
+
+// prints the hash the database knows every ROM by
+int print_hashes(const int count, char* paths[])
+{
+  static uint8_t rom[CHIRP_INSTRUCTIONS_REGION_SIZE + 1];
+  for (int i = 0; i < count; i++)
+  {
+    FILE* file = fopen(paths[i], "rb");
+    if (file == NULL)
+    {
+      fprintf(stderr, "could not open %s\n", paths[i]);
+      return 1;
+    }
+
+    const size_t size = fread(rom, 1, sizeof(rom), file);
+    fclose(file);
+    if (size > CHIRP_INSTRUCTIONS_REGION_SIZE)
+    {
+      fprintf(stderr, "%s is too large to fit in memory\n", paths[i]);
+      return 1;
+    }
+
+    printf("%016llx  %s\n", (unsigned long long)chirp_rom_hash(rom, size), paths[i]);
+  }
+
+  return 0;
+}
+
+// copies a field into a fixed-size string, - standing for an empty one; false if it does not fit
+bool copy_field(char* out, const size_t size, const char* field)
+{
+  if (strcmp(field, "-") == 0)
+  {
+    out[0] = '\0';
+    return true;
+  }
+  if (strlen(field) >= size)
+  {
+    return false;
+  }
+
+  strcpy(out, field);
+  return true;
+}
+
+// QUIRKS field into CHIRP_QUIRK_* flags; -1 if it names a quirk there is no such flag for
+int parse_quirks(char* field)
+{
+  if (strcmp(field, "-") == 0)
+  {
+    return 0;
+  }
+
+  int quirks = 0;
+  for (char* name = strtok(field, " "); name != NULL; name = strtok(NULL, " "))
+  {
+    int quirk = 0;
+    while (quirk < CHIRP_QUIRK_COUNT && strcmp(name, chirp_quirk_name(quirk)) != 0)
+    {
+      quirk++;
+    }
+    if (quirk == CHIRP_QUIRK_COUNT)
+    {
+      return -1;
+    }
+    quirks |= 1 << quirk;
+  }
+
+  return quirks;
+}
+
+// one line of the source into an entry; prints what is wrong with it and returns false if it is not valid
+bool parse_entry(char* line, ChirpRomEntry* entry, const char* path, const int line_number)
+{
+  char* fields[DB_FIELD_COUNT];
+  int field_count = 0;
+  char* field = line;
+  while (field != NULL && field_count < DB_FIELD_COUNT)
+  {
+    fields[field_count++] = field;
+    field = strchr(field, '\t');
+    if (field != NULL)
+    {
+      *field++ = '\0';
+    }
+  }
+  if (field_count != DB_FIELD_COUNT || field != NULL)
+  {
+    fprintf(stderr, "%s:%d: expected %d fields separated by tabs\n", path, line_number, DB_FIELD_COUNT);
+    return false;
+  }
+
+  memset(entry, 0, sizeof(ChirpRomEntry));
+
+  char* end;
+  entry->hash = strtoull(fields[0], &end, 16);
+  if (strlen(fields[0]) != 16 || *end != '\0')
+  {
+    fprintf(stderr, "%s:%d: the hash must be 16 hex digits, see --hash\n", path, line_number);
+    return false;
+  }
+  if (!copy_field(entry->title, sizeof(entry->title), fields[1]))
+  {
+    fprintf(stderr,
+            "%s:%d: the title is longer than %d characters\n",
+            path,
+            line_number,
+            CHIRP_ROMDB_TITLE_SIZE - 1);
+    return false;
+  }
+  if (!copy_field(entry->platform, sizeof(entry->platform), fields[2])
+      || (entry->platform[0] != '\0' && strcmp(entry->platform, "chip-8") != 0
+          && strcmp(entry->platform, "schip") != 0 && strcmp(entry->platform, "xo-chip") != 0))
+  {
+    fprintf(stderr, "%s:%d: the platform must be chip-8, schip or xo-chip\n", path, line_number);
+    return false;
+  }
+
+  const int quirks = parse_quirks(fields[3]);
+  if (quirks < 0)
+  {
+    fprintf(stderr, "%s:%d: unknown quirk\n", path, line_number);
+    return false;
+  }
+  entry->quirks = (uint8_t)quirks;
+
+  const long cpu_speed = strcmp(fields[4], "-") == 0 ? 0 : strtol(fields[4], &end, 10);
+  if ((strcmp(fields[4], "-") != 0 && *end != '\0') || cpu_speed < 0 || cpu_speed > UINT16_MAX)
+  {
+    fprintf(stderr, "%s:%d: the cpu speed must be a number up to %d\n", path, line_number, UINT16_MAX);
+    return false;
+  }
+  entry->cpu_speed = (uint16_t)cpu_speed;
+
+  if (!copy_field(entry->keymap, sizeof(entry->keymap), fields[5])
+      || (entry->keymap[0] != '\0' && strlen(entry->keymap) != CHIRP_ROMDB_KEYMAP_SIZE - 1))
+  {
+    fprintf(stderr, "%s:%d: the keymap must be 16 keys\n", path, line_number);
+    return false;
+  }
+
+  return true;
+}
+
+bool read_source(const char* path, DbEntries* db)
+{
+  FILE* file = fopen(path, "r");
+  if (file == NULL)
+  {
+    fprintf(stderr, "could not open %s\n", path);
+    return false;
+  }
+
+  char line[DB_LINE_SIZE];
+  int line_number = 0;
+  bool is_valid = true;
+  while (fgets(line, sizeof(line), file) != NULL)
+  {
+    line_number++;
+    line[strcspn(line, "\r\n")] = '\0';
+    if (line[0] == '\0' || line[0] == '#')
+    {
+      continue;
+    }
+
+    if (db->count == db->capacity)
+    {
+      db->capacity = db->capacity > 0 ? db->capacity * 2 : 64;
+      db->entries = realloc(db->entries, sizeof(ChirpRomEntry) * db->capacity);
+      if (db->entries == NULL)
+      {
+        fprintf(stderr, "out of memory\n");
+        exit(1);
+      }
+    }
+
+    if (parse_entry(line, &db->entries[db->count], path, line_number))
+    {
+      db->count++;
+    }
+    else
+    {
+      is_valid = false;
+    }
+  }
+
+  fclose(file);
+  return is_valid;
+}
+
+int compare_entries(const void* a, const void* b)
+{
+  const uint64_t left = ((const ChirpRomEntry*)a)->hash;
+  const uint64_t right = ((const ChirpRomEntry*)b)->hash;
+
+  return left < right ? -1 : left > right ? 1 : 0;
+}
+
+int main(int argc, char* argv[])
+{
+  if (argc >= 3 && strcmp(argv[1], "--hash") == 0)
+  {
+    return print_hashes(argc - 2, argv + 2);
+  }
+  if (argc != 3)
+  {
+    usage(argv[0]);
+    return 1;
+  }
+
+  DbEntries db = {NULL, 0, 0};
+  if (!read_source(argv[1], &db))
+  {
+    free(db.entries);
+    return 1;
+  }
+
+  qsort(db.entries, db.count, sizeof(ChirpRomEntry), compare_entries);
+  for (uint32_t i = 1; i < db.count; i++)
+  {
+    if (db.entries[i].hash == db.entries[i - 1].hash)
+    {
+      fprintf(stderr, "%016llx is in %s more than once\n", (unsigned long long)db.entries[i].hash, argv[1]);
+      free(db.entries);
+      return 1;
+    }
+  }
+
+  FILE* out = fopen(argv[2], "wb");
+  if (out == NULL)
+  {
+    fprintf(stderr, "could not open %s\n", argv[2]);
+    free(db.entries);
+    return 1;
+  }
+
+  ChirpRomDbHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, CHIRP_ROMDB_MAGIC, CHIRP_ROMDB_MAGIC_SIZE);
+  header.entry_count = db.count;
+  header.entry_size = sizeof(ChirpRomEntry);
+
+  fwrite(&header, sizeof(header), 1, out);
+  fwrite(db.entries, sizeof(ChirpRomEntry), db.count, out);
+  const bool has_failed = ferror(out) != 0;
+  if (fclose(out) != 0 || has_failed)
+  {
+    fprintf(stderr, "could not write %s\n", argv[2]);
+    free(db.entries);
+    return 1;
+  }
+
+  printf("%u ROMs in %s\n", db.count, argv[2]);
+  free(db.entries);
+  return 0;
+}
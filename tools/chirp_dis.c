@@ -0,0 +1,218 @@
+// static disassembler for CHIP-8 ROMs: lists the code reachable from the entry point next to the data it uses, or
+// prints the control-flow graph in Graphviz DOT
+//
+// build with: make dis
+// run with:   out/chirp-dis roms/pong.ch8
+//             out/chirp-dis --cfg roms/pong.ch8 | dot -Tsvg > pong.svg
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "analysis.h"
+#include "rom.h"
+
+#define DIS_TEXT_SIZE 32
+
+void usage(const char* prog)
+{
+  fprintf(stderr, "usage: %s [--cfg] ROM\n", prog);
+}
+
+void print_label(const ChirpAnalysis* analysis, const uint16_t address)
+{
+  const uint8_t flags = analysis->flags[address];
+  if (address == analysis->entry)
+  {
+    printf("\nentry:\n");
+  }
+  else if ((flags & CHIRP_BYTE_CALL_TARGET) != 0)
+  {
+    printf("\nsub_%03X:\n", address);
+  }
+  else if ((flags & (CHIRP_BYTE_JUMP_TARGET | CHIRP_BYTE_BLOCK_START)) != 0)
+  {
+    printf("L_%03X:\n", address);
+  }
+}
+
+void print_listing(const uint8_t* mem, const uint16_t end, const ChirpAnalysis* analysis)
+{
+  printf("; %d instructions in %d blocks, %d indirect jumps, %d invalid instructions\n",
+         analysis->instruction_count,
+         analysis->block_count,
+         analysis->indirect_jump_count,
+         analysis->invalid_count);
+
+  uint16_t address = CHIRP_INSTRUCTIONS_ADDR_START;
+  while (address < end)
+  {
+    const uint8_t flags = analysis->flags[address];
+    if ((flags & CHIRP_BYTE_CODE) != 0)
+    {
+      char text[DIS_TEXT_SIZE];
+      const ChirpDecoded d = chirp_decode(chirp_decode_at(mem, address));
+      chirp_disassemble(&d, text, sizeof(text));
+
+      print_label(analysis, address);
+      if ((flags & CHIRP_BYTE_WRITTEN) != 0)
+      {
+        printf("  %03X: %04X  %-16s; overwritten by the ROM\n", address, d.instruction, text);
+      }
+      else
+      {
+        printf("  %03X: %04X  %s\n", address, d.instruction, text);
+      }
+      address += 2;
+      continue;
+    }
+
+    // sprites read best as the pixels they draw
+    char pixels[9];
+    for (int bit = 0; bit < 8; bit++)
+    {
+      pixels[bit] = (mem[address] & (0x80 >> bit)) != 0 ? '#' : '.';
+    }
+    pixels[8] = '\0';
+
+    printf("  %03X: %02X    DB 0x%02X         ; %s%s\n",
+           address,
+           mem[address],
+           mem[address],
+           pixels,
+           (flags & CHIRP_BYTE_DATA) != 0 ? "" : " (unreached)");
+    address++;
+  }
+}
+
+void print_edge(const uint16_t from, const uint16_t to, const char* style)
+{
+  printf("  b%03X -> b%03X%s;\n", from, to, style);
+}
+
+/**
+ * Prints one node per basic block, holding its instructions, with edges for every way control can leave it.
+ *
+ * Calls get a dashed edge to the subroutine next to the normal edge to the instruction after them, since that is
+ * where the matching 00EE comes back to.
+ */
+void print_cfg(const uint8_t* mem, const ChirpAnalysis* analysis)
+{
+  printf("digraph chirp {\n");
+  printf("  node [shape=box, fontname=monospace];\n");
+
+  for (int start = 0; start < CHIRP_MEMORY_SIZE; start++)
+  {
+    const uint8_t block = CHIRP_BYTE_CODE | CHIRP_BYTE_BLOCK_START;
+    if ((analysis->flags[start] & block) != block)
+    {
+      continue;
+    }
+
+    printf("  b%03X [label=\"", start);
+    uint16_t address = start;
+    while (true)
+    {
+      char text[DIS_TEXT_SIZE];
+      const ChirpDecoded d = chirp_decode(chirp_decode_at(mem, address));
+      chirp_disassemble(&d, text, sizeof(text));
+      printf("%03X: %s\\l", address, text);
+
+      const uint16_t next = address + 2;
+      if (chirp_op_is_skip(d.op))
+      {
+        printf("\"];\n");
+        print_edge(start, next, " [label=\"no skip\"]");
+        print_edge(start, next + 2, " [label=\"skip\"]");
+        break;
+      }
+      if (d.op == CHIRP_OP_JP || d.op == CHIRP_OP_CALL)
+      {
+        printf("\"];\n");
+        print_edge(start, d.nnn, d.op == CHIRP_OP_CALL ? " [style=dashed]" : "");
+        if (d.op == CHIRP_OP_CALL)
+        {
+          print_edge(start, next, "");
+        }
+        break;
+      }
+      if (chirp_analysis_ends_block(d.op))
+      {
+        printf("\"];\n");
+        for (int i = 0; d.op == CHIRP_OP_JP_V0 && i < analysis->jump_count; i++)
+        {
+          if (analysis->jumps[i].from == address)
+          {
+            print_edge(start, analysis->jumps[i].to, " [style=dotted]");
+          }
+        }
+        break;
+      }
+
+      // falling through into the next block
+      if (next >= CHIRP_MEMORY_SIZE || (analysis->flags[next] & CHIRP_BYTE_CODE) == 0)
+      {
+        printf("\"];\n");
+        break;
+      }
+      if ((analysis->flags[next] & CHIRP_BYTE_BLOCK_START) != 0)
+      {
+        printf("\"];\n");
+        print_edge(start, next, "");
+        break;
+      }
+      address = next;
+    }
+  }
+
+  printf("}\n");
+}
+
+int main(int argc, char* argv[])
+{
+  bool is_cfg = false;
+  const char* path = NULL;
+  for (int i = 1; i < argc; i++)
+  {
+    if (strcmp(argv[i], "--cfg") == 0)
+    {
+      is_cfg = true;
+    }
+    else if (path == NULL)
+    {
+      path = argv[i];
+    }
+    else
+    {
+      usage(argv[0]);
+      return 1;
+    }
+  }
+
+  if (path == NULL)
+  {
+    usage(argv[0]);
+    return 1;
+  }
+
+  static uint8_t mem[CHIRP_MEMORY_SIZE];
+  const uint16_t end = load_rom(path, mem);
+  if (end == 0)
+  {
+    return 1;
+  }
+
+  static ChirpAnalysis analysis;
+  chirp_analyse(mem, CHIRP_INSTRUCTIONS_ADDR_START, &analysis);
+
+  if (is_cfg)
+  {
+    print_cfg(mem, &analysis);
+  }
+  else
+  {
+    print_listing(mem, end, &analysis);
+  }
+
+  return 0;
+}
@@ -0,0 +1,27 @@
+#include "rom.h"
+
+#include <stdio.h>
+#include <string.h>
+
+// loads the ROM at the start of the instruction region of a zeroed image; returns the end of the ROM or 0 on failure
+uint16_t load_rom(const char* path, uint8_t* mem)
+{
+  FILE* file = fopen(path, "rb");
+  if (file == NULL)
+  {
+    fprintf(stderr, "could not open %s\n", path);
+    return 0;
+  }
+
+  memset(mem, 0, CHIRP_MEMORY_SIZE);
+  const size_t size = fread(&mem[CHIRP_INSTRUCTIONS_ADDR_START], 1, CHIRP_INSTRUCTIONS_REGION_SIZE + 1, file);
+  fclose(file);
+
+  if (size > CHIRP_INSTRUCTIONS_REGION_SIZE)
+  {
+    fprintf(stderr, "%s is too large to fit in memory\n", path);
+    return 0;
+  }
+
+  return CHIRP_INSTRUCTIONS_ADDR_START + size;
+}
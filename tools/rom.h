@@ -0,0 +1,12 @@
+#ifndef CHIRP_TOOLS_ROM_H
+#define CHIRP_TOOLS_ROM_H
+
+#include <stdint.h>
+
+#include "memory.h"
+
+// shared by the tools, which work on a bare memory image of the ROM rather than on an instance
+
+uint16_t load_rom(const char* path, uint8_t* mem);
+
+#endif // CHIRP_TOOLS_ROM_H